@@ -1,128 +1,182 @@
-/*
- * 包围盒
- * Axis-Aligned Bounding Box
- */
-#ifndef AABB_H
-#define AABB_H
-
-#include "interval.h"
-#include "ray.h"
-
-class AABB
-{
-    friend AABB operator+(const AABB& bbox, const Vec3& offset);
-    friend AABB operator+(const Vec3& offset, const AABB& bbox);
-
-private:
-    Interval x_, y_, z_;
-
-public:
-    AABB() = default;
-
-    AABB(const Interval& x, const Interval& y, const Interval& z)
-        : x_(x), y_(y), z_(z) {}
-
-    // 包围盒两极值点
-    AABB(const Point3& a, const Point3& b)
-    {
-        x_ = Interval(fmin(a[0], b[0]), fmax(a[0], b[0]));
-        y_ = Interval(fmin(a[1], b[1]), fmax(a[1], b[1]));
-        z_ = Interval(fmin(a[2], b[2]), fmax(a[2], b[2]));
-    }
-
-    // 并集运算
-    AABB(const AABB& box0, const AABB& box1)
-    {
-        x_ = Interval(box0.x_, box1.x_);
-        y_ = Interval(box0.y_, box1.y_);
-        z_ = Interval(box0.z_, box1.z_);
-    }
-
-public:
-    const Interval& axis(int n) 
-        const 
-    {
-        if (n == 0) return x_;
-        if (n == 1) return y_;
-        return z_; // n == 2
-    }
-
-    bool hit(const Ray& r, Interval ray_t) 
-        const
-    {
-        //for (int a = 0; a < 3; ++a)
-        //{
-        //    double t0 = fmin((axis(a).get_min() - r.get_origin()[a]) / r.get_direction()[a],
-        //        (axis(a).get_max() - r.get_origin()[a]) / r.get_direction()[a]);
-        //    double t1 = fmax((axis(a).get_min() - r.get_origin()[a]) / r.get_direction()[a],
-        //        (axis(a).get_max() - r.get_origin()[a]) / r.get_direction()[a]);
-        //    ray_t.set_min(fmax(t0, ray_t.get_min())); // 更新最小值为大者
-        //    ray_t.set_max(fmin(t1, ray_t.get_max())); // 更新最大值为小者
-        //    if (ray_t.get_max() <= ray_t.get_min()) // 没有重合说明光线不与包围盒相交
-        //        return false;
-        //}
-
-        // Andrew Kensler at Pixar
-        for (int a = 0; a < 3; ++a) 
-        {
-            auto invD = 1 / r.get_direction()[a];
-            auto orig = r.get_origin()[a];
-
-            auto t0 = (axis(a).get_min() - orig) * invD;
-            auto t1 = (axis(a).get_max() - orig) * invD;
-
-            if (invD < 0)
-                std::swap(t0, t1);
-
-            if (t0 > ray_t.get_min()) ray_t.set_min(t0);
-            if (t1 < ray_t.get_max()) ray_t.set_max(t1);
-
-            if (ray_t.get_max() <= ray_t.get_min())
-                return false;
-        }
-        return true;
-    }
-
-    // 避免过窄
-    AABB pad()
-    {
-        double delta = 1e-4;
-
-        Interval new_x = (x_.get_size() >= delta) ? x_ : x_.expand(delta);
-        Interval new_y = (y_.get_size() >= delta) ? y_ : y_.expand(delta);
-        Interval new_z = (z_.get_size() >= delta) ? z_ : z_.expand(delta);
-
-        return AABB(new_x, new_y, new_z);
-    }
-
-    Interval x() 
-        const
-    {
-        return x_;
-    }
-
-    Interval y() 
-        const
-    {
-        return y_;
-    }
-
-    Interval z() 
-        const
-    {
-        return z_;
-    }
-};
-
-inline AABB operator+(const AABB& bbox, const Vec3& offset)
-{
-    return AABB(bbox.x_ + offset.x(), bbox.y_ + offset.y(), bbox.z_ + offset.z());
-}
-
-inline AABB operator+(const Vec3& offset, const AABB& bbox)
-{
-    return bbox + offset;
-}
-
-#endif // !AABB_H
-
+/*
+ * 包围盒
+ * Axis-Aligned Bounding Box
+ */
+#ifndef AABB_H
+#define AABB_H
+
+#include "interval.h"
+#include "ray.h"
+
+class AABB
+{
+    friend AABB operator+(const AABB& bbox, const Vec3& offset);
+    friend AABB operator+(const Vec3& offset, const AABB& bbox);
+
+private:
+    Interval x_, y_, z_;
+
+public:
+    AABB() = default;
+
+    AABB(const Interval& x, const Interval& y, const Interval& z)
+        : x_(x), y_(y), z_(z) {}
+
+    // 包围盒两极值点
+    AABB(const Point3& a, const Point3& b)
+    {
+        x_ = Interval(fmin(a[0], b[0]), fmax(a[0], b[0]));
+        y_ = Interval(fmin(a[1], b[1]), fmax(a[1], b[1]));
+        z_ = Interval(fmin(a[2], b[2]), fmax(a[2], b[2]));
+    }
+
+    // 并集运算
+    AABB(const AABB& box0, const AABB& box1)
+    {
+        x_ = Interval(box0.x_, box1.x_);
+        y_ = Interval(box0.y_, box1.y_);
+        z_ = Interval(box0.z_, box1.z_);
+    }
+
+public:
+    const Interval& axis(int n) 
+        const 
+    {
+        if (n == 0) return x_;
+        if (n == 1) return y_;
+        return z_; // n == 2
+    }
+
+    bool hit(const Ray& r, Interval ray_t) 
+        const
+    {
+        //for (int a = 0; a < 3; ++a)
+        //{
+        //    double t0 = fmin((axis(a).get_min() - r.get_origin()[a]) / r.get_direction()[a],
+        //        (axis(a).get_max() - r.get_origin()[a]) / r.get_direction()[a]);
+        //    double t1 = fmax((axis(a).get_min() - r.get_origin()[a]) / r.get_direction()[a],
+        //        (axis(a).get_max() - r.get_origin()[a]) / r.get_direction()[a]);
+        //    ray_t.set_min(fmax(t0, ray_t.get_min())); // 更新最小值为大者
+        //    ray_t.set_max(fmin(t1, ray_t.get_max())); // 更新最大值为小者
+        //    if (ray_t.get_max() <= ray_t.get_min()) // 没有重合说明光线不与包围盒相交
+        //        return false;
+        //}
+
+        // Andrew Kensler at Pixar
+        // 以real计算，离开距离放大1+2*gamma(3)倍，保证舍入误差不会漏掉实际击中的包围盒，参见 PBRT 6.1.2
+        for (int a = 0; a < 3; ++a) 
+        {
+            auto invD = 1 / r.get_direction()[a];
+            auto orig = r.get_origin()[a];
+
+            auto t0 = (axis(a).get_min() - orig) * invD;
+            auto t1 = (axis(a).get_max() - orig) * invD;
+
+            if (invD < 0)
+                std::swap(t0, t1);
+            t1 *= 1 + 2 * error_gamma(3);
+
+            if (t0 > ray_t.get_min()) ray_t.set_min(t0);
+            if (t1 < ray_t.get_max()) ray_t.set_max(t1);
+
+            if (ray_t.get_max() <= ray_t.get_min())
+                return false;
+        }
+        return true;
+    }
+
+    // 避免过窄
+    AABB pad()
+    {
+        real delta = real(1e-4);
+
+        Interval new_x = (x_.get_size() >= delta) ? x_ : x_.expand(delta);
+        Interval new_y = (y_.get_size() >= delta) ? y_ : y_.expand(delta);
+        Interval new_z = (z_.get_size() >= delta) ? z_ : z_.expand(delta);
+
+        return AABB(new_x, new_y, new_z);
+    }
+
+    // 交集运算
+    AABB intersect(const AABB& other)
+        const
+    {
+        return AABB(x_.intersect(other.x_), y_.intersect(other.y_), z_.intersect(other.z_));
+    }
+
+    bool is_empty()
+        const
+    {
+        return x_.get_size() < 0 || y_.get_size() < 0 || z_.get_size() < 0;
+    }
+
+    // 表面积，空包围盒为0
+    double surface_area()
+        const
+    {
+        double dx = x_.get_size(), dy = y_.get_size(), dz = z_.get_size();
+        if (dx < 0 || dy < 0 || dz < 0)
+            return 0;
+        return 2 * (dx * dy + dy * dz + dz * dx);
+    }
+
+    Point3 centroid()
+        const
+    {
+        return Point3(
+            (x_.get_min() + x_.get_max()) * .5,
+            (y_.get_min() + y_.get_max()) * .5,
+            (z_.get_min() + z_.get_max()) * .5);
+    }
+
+    // 点在包围盒内的相对位置，最小点为(0,0,0)，最大点为(1,1,1)
+    Vec3 offset(const Point3& p)
+        const
+    {
+        Vec3 o = p - Point3(x_.get_min(), y_.get_min(), z_.get_min());
+        if (x_.get_size() > 0) o[0] /= x_.get_size();
+        if (y_.get_size() > 0) o[1] /= y_.get_size();
+        if (z_.get_size() > 0) o[2] /= z_.get_size();
+        return o;
+    }
+
+    // 范围最大的轴
+    int longest_axis()
+        const
+    {
+        if (x_.get_size() > y_.get_size())
+            return x_.get_size() > z_.get_size() ? 0 : 2;
+        return y_.get_size() > z_.get_size() ? 1 : 2;
+    }
+
+    Interval x() 
+        const
+    {
+        return x_;
+    }
+
+    Interval y() 
+        const
+    {
+        return y_;
+    }
+
+    Interval z() 
+        const
+    {
+        return z_;
+    }
+};
+
+inline AABB operator+(const AABB& bbox, const Vec3& offset)
+{
+    return AABB(bbox.x_ + offset.x(), bbox.y_ + offset.y(), bbox.z_ + offset.z());
+}
+
+inline AABB operator+(const Vec3& offset, const AABB& bbox)
+{
+    return bbox + offset;
+}
+
+#endif // !AABB_H
+
@@ -1,49 +1,81 @@
-/*
- * 光线类
- */
-#ifndef RAY_H
-#define RAY_H
-
-#include "vec.h"
-
-class Ray
-{
-private:
-	Point3 origin_;
-	Vec3 direction_;
-	double time_;
-
-public:
-	Ray() : origin_(), direction_(), time_(0) {}
-
-	Ray(const Point3& origin, const Vec3& direction, double time = 0) 
-		: origin_(origin), direction_(direction), time_(time) {};
-
-public:
-	// p = o + t * d
-	Point3 at(double t)
-		const
-	{
-		return origin_ + t * direction_;
-	}
-
-	Point3 get_origin()
-		const
-	{
-		return origin_;
-	}
-
-	Vec3 get_direction() 
-		const
-	{
-		return direction_;
-	}
-
-	double get_time() 
-		const
-	{
-		return time_;
-	}
-};
-
-#endif // !RAY_H
+/*
+ * 光线类
+ */
+#ifndef RAY_H
+#define RAY_H
+
+#include "vec.h"
+
+class Ray
+{
+private:
+	Point3 origin_;
+	Vec3 direction_;
+	real time_;
+
+public:
+	Ray() : origin_(), direction_(), time_(0) {}
+
+	Ray(const Point3& origin, const Vec3& direction, double time = 0) 
+		: origin_(origin), direction_(direction), time_(static_cast<real>(time)) {};
+
+public:
+	// p = o + t * d
+	Point3 at(double t)
+		const
+	{
+		return origin_ + t * direction_;
+	}
+
+	Point3 get_origin()
+		const
+	{
+		return origin_;
+	}
+
+	Vec3 get_direction() 
+		const
+	{
+		return direction_;
+	}
+
+	real get_time() 
+		const
+	{
+		return time_;
+	}
+};
+
+// 参见 Woop et al. 2013, Watertight Ray/Triangle Intersection
+// 以方向分量绝对值最大的轴为kz，将三角形平移到光线原点后剪切，使光线沿kz轴，在另外两轴的平面上判定包含
+// 同一光线与各三角形求交时共用，只计算一次
+// 只在求交时临时构造，不占存储带宽，保持双精度，标量求交在双精度下计算
+struct WatertightRay
+{
+	int kx, ky, kz;
+	double ox, oy, oz; // 按kx、ky、kz轴重排的起点
+	double sx, sy, sz;
+
+	WatertightRay() : kx(0), ky(1), kz(2), ox(0), oy(0), oz(0), sx(0), sy(0), sz(1) {}
+
+	explicit WatertightRay(const Ray& r)
+	{
+		Vec3 d = r.get_direction();
+		kz = std::fabs(d[0]) > std::fabs(d[1]) ? (std::fabs(d[0]) > std::fabs(d[2]) ? 0 : 2) : (std::fabs(d[1]) > std::fabs(d[2]) ? 1 : 2);
+		kx = (kz + 1) % 3;
+		ky = (kx + 1) % 3;
+		// 保持三角形的环绕方向
+		if (d[kz] < 0)
+			std::swap(kx, ky);
+		sx = d[kx] / d[kz];
+		sy = d[ky] / d[kz];
+		sz = 1. / d[kz];
+
+		Point3 o = r.get_origin();
+		ox = o[kx];
+		oy = o[ky];
+		oz = o[kz];
+	}
+};
+
+#endif // !RAY_H
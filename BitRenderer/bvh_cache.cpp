@@ -0,0 +1,175 @@
+#include <fstream>
+#include <iomanip>
+
+#include "bvh_builder.h"
+#include "bvh_cache.h"
+
+static_assert(std::is_trivially_copyable_v<BVHBuildNode>, "BVHBuildNode is written to the cache as raw bytes");
+
+// 缓存格式变化时递增
+static const uint kBVHCacheVersion = 1;
+
+// 缓存目录中最多保留的文件数，超出时删除最早写入的
+static const size_t kMaxBVHCacheFiles = 16;
+
+struct BVHCacheHeader
+{
+    char   magic[4];        // "BVHC"
+    uint   version;
+    uint   node_size;       // sizeof(BVHBuildNode)，编译器或节点结构变化时缓存失效
+    uint   pad;
+    ullong key;
+    ullong primitive_count;
+    ullong node_count;
+    ullong index_count;
+};
+
+static std::string cache_file_path(ullong key)
+{
+    std::ostringstream oss;
+    oss << kCachePath << "bvh_" << std::hex << std::setw(16) << std::setfill('0') << key << ".bin";
+    return oss.str();
+}
+
+// 缓存文件可能损坏或被改动，遍历前检查树结构：
+// 节点须按深度优先顺序排列（左子节点紧随父节点，右子节点在左子树之后），每个节点恰好被访问一次，
+// 叶节点深度不超过构建器的上限，叶节点的图元区间和图元索引不越界
+static bool valid_tree(size_t primitive_count, const std::vector<BVHBuildNode>& nodes, const std::vector<uint>& indices)
+{
+    for (uint index : indices)
+    {
+        if (index >= primitive_count)
+            return false;
+    }
+    if (nodes.empty())
+        return primitive_count == 0 && indices.empty();
+
+    struct StackEntry
+    {
+        size_t node;
+        int depth;
+    };
+    std::vector<StackEntry> stack = { { 0, 0 } };
+    size_t next = 0;
+    while (!stack.empty())
+    {
+        StackEntry entry = stack.back();
+        stack.pop_back();
+        if (entry.node != next++ || entry.depth > BVHBuilder::kMaxDepth)
+            return false;
+
+        const BVHBuildNode& node = nodes[entry.node];
+        if (node.count > 0)
+        {
+            if (static_cast<size_t>(node.offset) + node.count > indices.size())
+                return false;
+            continue;
+        }
+
+        if (node.axis < 0 || node.axis > 2 || node.offset <= entry.node + 1 || node.offset >= nodes.size())
+            return false;
+        stack.push_back({ node.offset, entry.depth + 1 });
+        stack.push_back({ entry.node + 1, entry.depth + 1 });
+    }
+    return next == nodes.size();
+}
+
+bool load_bvh_cache(ullong key, size_t primitive_count, std::vector<BVHBuildNode>& nodes, std::vector<uint>& indices)
+{
+    std::string path = cache_file_path(key);
+    std::error_code ec;
+    uintmax_t file_size = fs::file_size(path, ec);
+    if (ec || file_size < sizeof(BVHCacheHeader))
+        return false;
+
+    std::ifstream in(path, std::ios::binary);
+    BVHCacheHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        return false;
+    if (std::memcmp(header.magic, "BVHC", 4) != 0
+        || header.version != kBVHCacheVersion
+        || header.node_size != sizeof(BVHBuildNode)
+        || header.key != key
+        || header.primitive_count != primitive_count)
+        return false;
+
+    // 先按文件大小核对数量，数量被改动时不会按其分配内存
+    if (header.node_count > file_size / sizeof(BVHBuildNode) || header.index_count > file_size / sizeof(uint)
+        || file_size != sizeof(header) + header.node_count * sizeof(BVHBuildNode) + header.index_count * sizeof(uint))
+        return false;
+
+    // 直接读入节点和索引数组，不经过中间缓冲
+    nodes.resize(header.node_count);
+    indices.resize(header.index_count);
+    in.read(reinterpret_cast<char*>(nodes.data()), nodes.size() * sizeof(BVHBuildNode));
+    in.read(reinterpret_cast<char*>(indices.data()), indices.size() * sizeof(uint));
+    if (!in || !valid_tree(primitive_count, nodes, indices))
+    {
+        nodes.clear();
+        indices.clear();
+        add_info("BVH cache " + path + " is corrupt, rebuilding.");
+        return false;
+    }
+    return true;
+}
+
+// 按写入时间只保留最新的kMaxBVHCacheFiles个缓存文件
+static void prune_bvh_cache()
+{
+    std::vector<std::pair<fs::file_time_type, fs::path>> files;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(kCachePath, ec))
+    {
+        const fs::path& path = entry.path();
+        if (path.extension() != ".bin" || path.filename().string().rfind("bvh_", 0) != 0)
+            continue;
+        fs::file_time_type time = fs::last_write_time(path, ec);
+        if (!ec)
+            files.emplace_back(time, path);
+    }
+    if (files.size() <= kMaxBVHCacheFiles)
+        return;
+
+    std::sort(files.begin(), files.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+    for (size_t i = kMaxBVHCacheFiles; i < files.size(); ++i)
+        fs::remove(files[i].second, ec);
+}
+
+void save_bvh_cache(ullong key, size_t primitive_count, const std::vector<BVHBuildNode>& nodes, const std::vector<uint>& indices)
+{
+    std::error_code ec;
+    fs::create_directories(kCachePath, ec);
+
+    BVHCacheHeader header = {};
+    std::memcpy(header.magic, "BVHC", 4);
+    header.version = kBVHCacheVersion;
+    header.node_size = sizeof(BVHBuildNode);
+    header.key = key;
+    header.primitive_count = primitive_count;
+    header.node_count = nodes.size();
+    header.index_count = indices.size();
+
+    std::string path = cache_file_path(key);
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(nodes.data()), nodes.size() * sizeof(BVHBuildNode));
+        out.write(reinterpret_cast<const char*>(indices.data()), indices.size() * sizeof(uint));
+        if (!out)
+        {
+            add_info("Failed to write BVH cache " + temp_path);
+            return;
+        }
+    }
+
+    fs::rename(temp_path, path, ec);
+    if (ec)
+    {
+        fs::remove(temp_path, ec);
+        add_info("Failed to write BVH cache " + path);
+        return;
+    }
+
+    prune_bvh_cache();
+}
@@ -0,0 +1,132 @@
+/*
+* 水密求交测试
+* 光线从网格外的随机位置射向两个面共享的边上的点，两个面都朝向光线同一侧（非轮廓边）时，
+* 光线必定在到达该点之前击中网格，未击中即为从共享边漏过
+*/
+#include <iostream>
+#include <map>
+#include <tuple>
+#include "scene.h"
+
+// 网格中恰由两个面共享的边，按顶点位置匹配，纹理接缝处拆开的顶点视为同一点
+struct SharedEdge
+{
+    Point3 a, b;
+    Vec3 normal0, normal1; // 两个面未归一化的几何法线
+};
+
+std::vector<SharedEdge> shared_edges(const TriangleMesh& mesh)
+{
+    using Key = std::tuple<real, real, real>;
+    std::map<std::pair<Key, Key>, std::vector<uint>> faces;
+    for (uint f = 0; f < mesh.face_count(); ++f)
+    {
+        Point3 v[3];
+        mesh.get_vertices(f, v[0], v[1], v[2]);
+        for (int j = 0; j < 3; ++j)
+        {
+            const Point3& a = v[j];
+            const Point3& b = v[(j + 1) % 3];
+            Key ka(a[0], a[1], a[2]), kb(b[0], b[1], b[2]);
+            if (kb < ka)
+                std::swap(ka, kb);
+            faces[{ ka, kb }].push_back(f);
+        }
+    }
+
+    std::vector<SharedEdge> edges;
+    for (const auto& [key, f] : faces)
+    {
+        if (f.size() != 2)
+            continue;
+
+        SharedEdge edge;
+        edge.a = Point3(std::get<0>(key.first), std::get<1>(key.first), std::get<2>(key.first));
+        edge.b = Point3(std::get<0>(key.second), std::get<1>(key.second), std::get<2>(key.second));
+        Point3 v0, v1, v2;
+        mesh.get_vertices(f[0], v0, v1, v2);
+        edge.normal0 = cross(v1 - v0, v2 - v0);
+        mesh.get_vertices(f[1], v0, v1, v2);
+        edge.normal1 = cross(v1 - v0, v2 - v0);
+        edges.push_back(edge);
+    }
+    return edges;
+}
+
+// 每条共享边发射rays_per_edge条光线，首条对准边的中点，hit和occluded各自统计漏过的光线数
+void leak_count(const Hittable& world, const std::vector<SharedEdge>& edges, int rays_per_edge,
+    ullong& total, ullong& hit_leaks, ullong& occluded_leaks)
+{
+    AABB bbox = world.get_bbox();
+    Point3 center = bbox.centroid();
+    double radius = Vec3(bbox.x().get_size(), bbox.y().get_size(), bbox.z().get_size()).norm() * 2;
+
+    total = hit_leaks = occluded_leaks = 0;
+    for (const SharedEdge& edge : edges)
+    {
+        for (int i = 0; i < rays_per_edge; ++i)
+        {
+            Point3 target = edge.a + (i == 0 ? .5 : random_double()) * (edge.b - edge.a);
+            Point3 origin = center + random_unit_vector() * radius;
+            Vec3 direction = target - origin;
+
+            // 轮廓边处光线可从两面之间穿过；近乎掠射时交点距离对误差敏感，都不计入
+            double s0 = dot(direction, edge.normal0), s1 = dot(direction, edge.normal1);
+            if ((s0 < 0) != (s1 < 0))
+                continue;
+            if (std::fabs(s0) < 1e-3 * direction.norm() * edge.normal0.norm() ||
+                std::fabs(s1) < 1e-3 * direction.norm() * edge.normal1.norm())
+                continue;
+
+            // 方向未归一化，t = 1处恰好到达边上的点
+            // 单精度构建中节点和MeshBVH叶节点以单精度表示光线，算出的距离相对误差可达1e-5，区间上限留出余量；
+            // 从边漏过的光线会击中网格另一侧或完全错过，远在余量之外
+            Ray r(origin, direction, 0);
+            Interval interval(1e-6, 1 + 1e-4);
+            HitRecord rec;
+            ++total;
+            if (!world.hit(r, interval, rec))
+                ++hit_leaks;
+            if (!world.occluded(r, interval))
+                ++occluded_leaks;
+        }
+    }
+}
+
+void leak_test()
+{
+    const char* objs[][2] = {
+        { "spot/spot_triangulated_good.obj", "spot/" },
+        { "barrel_stove_1k/barrel_stove_1k.obj", "barrel_stove_1k/" },
+    };
+
+    for (const auto& obj : objs)
+    {
+        auto obj_path = kLoadPath + std::string(obj[0]);
+        auto base_path = kLoadPath + std::string(obj[1]);
+        if (!load_obj_internal(obj_path.c_str(), base_path.c_str(), true))
+            continue;
+        auto mesh = prepare_trace_data(nullptr);
+        if (mesh == nullptr)
+            continue;
+
+        std::vector<SharedEdge> edges = shared_edges(*mesh);
+
+        // 整个网格一个图元的MeshBVH，以及每个面一个三角形图元的BVH4
+        BVHBuildOption mesh_option;
+        mesh_option.builder.disk_cache = false;
+        BVHBuildOption face_option = mesh_option;
+        face_option.compact_mesh = false;
+        face_option.layout.branching = 4;
+        const char* names[] = { "MeshBVH", "BVH4" };
+        shared_ptr<Hittable> worlds[] = { construct_mesh(mesh, mesh_option), construct_mesh(mesh, face_option) };
+
+        for (int k = 0; k < 2; ++k)
+        {
+            ullong total, hit_leaks, occluded_leaks;
+            leak_count(*worlds[k], edges, 8, total, hit_leaks, occluded_leaks);
+            std::cout << obj[0] << " " << names[k] << ": shared edges " << edges.size() << ", rays " << total
+                << ", hit leaks " << hit_leaks << ", occluded leaks " << occluded_leaks << std::endl;
+        }
+    }
+}
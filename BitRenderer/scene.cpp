@@ -1,512 +1,706 @@
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "tiny_obj_loader.h"
-
-#include "logger.h"
-#include "scene.h"
-#include "triangle_rasterize.h"
-
-std::vector<Point3>    vertices;
-std::vector<Vec3>      normals;
-std::vector<Texcoord2> texcoords;
-
-void scene_rasterize(const Camera& cam, const fs::path& obj_path, const shared_ptr<Material>& material, const int& mode)
-{
-    static std::vector<TriangleRasterize> triangles;
-    static fs::path prev_obj_path;
-    static shared_ptr<Material> prev_material;
-
-    // 避免每帧重复加载
-    bool reload_obj = false;
-    bool reload_material = false;
-
-    if (prev_obj_path != obj_path)
-    {
-        prev_obj_path = obj_path;
-        reload_obj = true;
-    }
-
-    if (prev_material != material)
-    {
-        prev_material = material;
-        reload_material = true;
-    }
-
-    if (reload_obj)
-    {
-        if (!prepare_rasterize_data(obj_path.string().c_str(), obj_path.parent_path().string().c_str(), true, triangles))
-        {
-            add_info(obj_path.string() + " failed to load for rastering.");
-            return;
-        }
-    }
-
-    if (reload_obj || reload_material)
-    {        
-        for(TriangleRasterize& tri : triangles)
-            tri.set_material(material);
-    }
-
-    cam.rasterize(triangles, mode);
-    return;
-}
-
-void scene_trace(const Camera& cam, const fs::path& obj_path, const shared_ptr<Material>& material, const bool& tracing_with_cornell_box)
-{
-    shared_ptr<HittableList> world = make_shared<HittableList>();
-    HittableList triangles;
-
-    if (!prepare_trace_data(triangles, material))
-    {
-        add_info(obj_path.string() + " failed to load for ray tracing.");
-        return;
-    }
-
-    add_info("construct BVH...");
-    auto start = steady_clock::now();
-    world->add(make_shared<BVHNode>(triangles));
-    auto end = steady_clock::now();
-    add_info("BVH elapsed time: "_str + STR(duration_cast<milliseconds>(end - start).count()) + "ms");
-
-    // 光源
-    auto lighting = make_shared<DiffuseLight>(Color3(3, 3, 3));
-    auto quad = make_shared<Quad>(Point3(-.5, 1.9, 2.5), Vec3(0, 0, -1), Vec3(1, 0, 0), lighting);
-    world->add(quad);
-    // 对光源几何体采样
-    shared_ptr<HittableList> light(new HittableList());
-    light->add(quad);
-
-    if (tracing_with_cornell_box)
-    {
-        // 包围盒
-        auto red = make_shared<Lambertian>(Color3(.65, .05, .05));
-        auto white = make_shared<Lambertian>(Color3(.73, .73, .73));
-        auto green = make_shared<Lambertian>(Color3(.12, .45, .15));
-        world->add(make_shared<Quad>(Point3(2, -2, 0), Vec3(0, 4, 0), Vec3(0, 0, 4), green));
-        world->add(make_shared<Quad>(Point3(-2, -2, 0), Vec3(0, 4, 0), Vec3(0, 0, 4), red));
-        world->add(make_shared<Quad>(Point3(-2, -2, 0), Vec3(4, 0, 0), Vec3(0, 0, 4), white));
-        world->add(make_shared<Quad>(Point3(2, 2, 4), Vec3(-4, 0, 0), Vec3(0, 0, -4), white));
-        world->add(make_shared<Quad>(Point3(-2, -2, 4), Vec3(4, 0, 0), Vec3(0, 4, 0), white));
-
-        // 金属球
-        auto metal_sphere = make_shared<Sphere>(Point3(-1, -1, 2), .5, make_shared<Metal>(Color3(1, .84, 0), 0.));
-        // 玻璃球
-        auto glass_sphere = make_shared<Sphere>(Point3(1, 1, 2), .5, make_shared<Dielectric>(1.5));
-        world->add(glass_sphere);
-        world->add(metal_sphere);
-
-        // 对玻璃球采样
-        light->add(glass_sphere);
-    }
-
-    cam.trace(world, light);
-    return;
-}
-
-// 测试三角形
-void scene_test_triangle(const Camera& cam)
-{
-    shared_ptr<HittableList> world = make_shared<HittableList>();
-
-    vertices  = { {0, 0, 1}, {1, 0, 0}, {0, 1, 0} };
-    normals   = { {0, 0, 1}, {0, 0, 1}, {0, 0, 1} };
-    texcoords = { {0, 0}, {1, 0}, {0, 1} };
-    auto earthmap = make_shared<ImageTexture>(kLoadPath + "earthmap.jpg"_str);
-    world->add(make_shared<Triangle>(0, 0, 0, 1, 1, 1, 2, 2, 2, make_shared<Lambertian>(earthmap)));
-
-    cam.trace(world);
-    return;
-}
-
-// 使用tinyobj加载直接获得的数据
-static tinyobj::attrib_t attrib;
-static std::vector<tinyobj::shape_t> shapes;
-static std::vector<tinyobj::material_t> materials;
-static ullong vnum = 0, nnum = 0, tnum = 0, snum = 0, mnum = 0, tot_fnum = 0;
-
-// 加载obj
-bool load_obj_internal(const char* filename, const char* basepath, bool triangulate)
-{
-    std::string warn;
-    std::string err;
-
-    bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err,
-        filename, basepath, triangulate);
-
-    add_info("----------------");
-    add_info("load .obj: "_str + filename);
-
-    if (!warn.empty())
-    {
-        add_info("WARN: " + warn);
-    }
-
-    if (!err.empty())
-    {
-        add_info("ERR: " + err);
-    }
-
-    if (!ret)
-    {
-        add_info("Failed to load/parse .obj.");
-        return false;
-    }
-
-    vnum = attrib.vertices.size() / 3;
-    nnum = attrib.normals.size() / 3;
-    tnum = attrib.texcoords.size() / 2;
-    snum = shapes.size();
-    mnum = materials.size();
-    tot_fnum = 0;
-    for (ullong i = 0; i < snum; i++)
-    {
-        tot_fnum += shapes[i].mesh.num_face_vertices.size();
-    }
-
-    add_info("vertices: "  + STR(vnum));
-    add_info("normals: "   + STR(nnum));
-    add_info("texcoords: " + STR(tnum));
-    add_info("shapes: "    + STR(snum));
-    add_info("faces: "     + STR(tot_fnum));
-    add_info("materials: " + STR(mnum));
-
-    vertices = std::vector<Point3>(vnum);
-    normals = std::vector<Vec3>(nnum);
-    texcoords = std::vector<Texcoord2>(tnum);
-
-    for (ullong v = 0; v < vnum; ++v)
-    {
-        vertices[v] = Point3(
-            static_cast<const double>(attrib.vertices[3 * v + 0]),
-            static_cast<const double>(attrib.vertices[3 * v + 1]),
-            static_cast<const double>(attrib.vertices[3 * v + 2]));
-    }
-
-    for (ullong n = 0; n < nnum; ++n)
-    {
-        normals[n] = Vec3(
-            static_cast<const double>(attrib.normals[3 * n + 0]),
-            static_cast<const double>(attrib.normals[3 * n + 1]),
-            static_cast<const double>(attrib.normals[3 * n + 2]));
-    }
-
-    for (ullong t = 0; t < tnum; ++t)
-    {
-        texcoords[t] = Texcoord2(
-            static_cast<const double>(attrib.texcoords[2 * t + 0]),
-            static_cast<const double>(attrib.texcoords[2 * t + 1]));
-    }
-
-    return true;
-}
-
-// 为光线追踪准备数据
-bool prepare_trace_data(HittableList& triangles, const shared_ptr<Material>& material)
-{
-    // 光栅化预览已加载obj，不必再次加载
-
-    std::vector<shared_ptr<Hittable>> tris = std::vector<shared_ptr<Hittable>>(tot_fnum);
-    ullong tri_index = 0;
-
-    for (ullong i = 0; i < snum; i++)
-    {
-        add_info("shape name: "_str + shapes[i].name);
-        add_info("  mesh indices num: "_str   + STR(shapes[i].mesh.indices.size()));
-        add_info("  lines indices num: "_str  + STR(shapes[i].lines.indices.size()));
-        add_info("  points indices num: "_str + STR(shapes[i].points.indices.size()));
-        
-        ullong fnum = shapes[i].mesh.num_face_vertices.size();
-
-        assert(fnum == shapes[i].mesh.material_ids.size());
-        assert(fnum == shapes[i].mesh.smoothing_group_ids.size());
-
-        add_info("  faces num: "_str + STR(fnum));
-
-        ullong index_offset = 0;
-        for (ullong f = 0; f < fnum; f++)
-        {
-            ullong v_per_f = shapes[i].mesh.num_face_vertices[f];
-            // 每面顶点数必须为3
-            assert(v_per_f == 3);
-
-            tinyobj::index_t idx_a = shapes[i].mesh.indices[index_offset];
-            int a  = idx_a.vertex_index;
-            int an = idx_a.normal_index;
-            int at = idx_a.texcoord_index;
-
-            tinyobj::index_t idx_b = shapes[i].mesh.indices[index_offset + 1];
-            int b  = idx_b.vertex_index;
-            int bn = idx_b.normal_index;
-            int bt = idx_b.texcoord_index;
-
-            tinyobj::index_t idx_c = shapes[i].mesh.indices[index_offset + 2];
-            int c  = idx_c.vertex_index;
-            int cn = idx_c.normal_index;
-            int ct = idx_c.texcoord_index;
-
-            tris[tri_index + f] = make_shared<Triangle>(a, an, at, b, bn, bt, c, cn, ct, material);
-
-            index_offset += v_per_f;
-        }
-        tri_index += fnum;
-    }
-
-    triangles = std::move(tris);
-
-    return true;
-}
-
-// 为光栅化准备数据
-bool prepare_rasterize_data(const char* filename, const char* basepath, bool triangulate, std::vector<TriangleRasterize>& triangles)
-{
-    if (!load_obj_internal(filename, basepath, triangulate))
-    {
-        return false;
-    }
-
-    std::vector<TriangleRasterize> tris = std::vector<TriangleRasterize>(tot_fnum);
-    ullong tri_index = 0;
-
-    for (ullong i = 0; i < snum; i++)
-    {
-        ullong fnum = shapes[i].mesh.num_face_vertices.size();
-
-        assert(fnum == shapes[i].mesh.material_ids.size());
-        assert(fnum == shapes[i].mesh.smoothing_group_ids.size());
-
-        ullong index_offset = 0;
-        for (ullong f = 0; f < fnum; f++)
-        {
-            ullong v_per_f = shapes[i].mesh.num_face_vertices[f];
-            // 每面顶点数必须为3
-            assert(v_per_f == 3);
-
-            tinyobj::index_t idx_a = shapes[i].mesh.indices[index_offset];
-            int a  = idx_a.vertex_index;
-            int an = idx_a.normal_index;
-            int at = idx_a.texcoord_index;
-
-            tinyobj::index_t idx_b = shapes[i].mesh.indices[index_offset + 1];
-            int b  = idx_b.vertex_index;
-            int bn = idx_b.normal_index;
-            int bt = idx_b.texcoord_index;
-
-            tinyobj::index_t idx_c = shapes[i].mesh.indices[index_offset + 2];
-            int c  = idx_c.vertex_index;
-            int cn = idx_c.normal_index;
-            int ct = idx_c.texcoord_index;
-
-            //根据索引存储三角形
-            TriangleRasterize tri;
-            tri.set_vertex(vertices[a], vertices[b], vertices[c]);
-            tri.set_normal(normals[an], normals[bn], normals[cn]);
-            tri.set_texcoord(texcoords[at], texcoords[bt], texcoords[ct]);
-
-            tris[tri_index + f] = tri;
-
-            index_offset += v_per_f;
-        }
-        tri_index += fnum;
-    }
-
-    triangles = tris;
-
-    return true;
-}
-
-// 预置场景：棋盘格球
-void scene_checker(const Camera& cam)
-{
-    shared_ptr<HittableList> world = make_shared<HittableList>();
-
-    auto checker = make_shared<CheckerTexture>(0.8, Color3(.2, .3, .1), Color3(.9, .9, .9));
-
-    world->add(make_shared<Sphere>(Point3(0, -10, 0), 10, make_shared<Lambertian>(checker)));
-    world->add(make_shared<Sphere>(Point3(0, 10, 0), 10, make_shared<Lambertian>(checker)));
-
-    cam.trace(world);
-    return;
-}
-
-// 预置场景：康奈尔盒
-void scene_cornell_box(const Camera& cam)
-{
-    shared_ptr<HittableList> world = make_shared<HittableList>();
-
-    // 材质
-    auto red   = make_shared<Lambertian>(Color3(.65, .05, .05));
-    auto white = make_shared<Lambertian>(Color3(.73, .73, .73));
-    auto green = make_shared<Lambertian>(Color3(.12, .45, .15));
-    auto lighting = make_shared<DiffuseLight>(Color3(15, 15, 15));
-    auto aluminum = make_shared<Metal>(Color3(.8, .85, .88), 0.);
-
-    // 包围盒
-    world->add(make_shared<Quad>(Point3(555, 0, 0), Vec3(0, 555, 0), Vec3(0, 0, 555), green));
-    world->add(make_shared<Quad>(Point3(0, 0, 0), Vec3(0, 555, 0), Vec3(0, 0, 555), red));
-    world->add(make_shared<Quad>(Point3(0, 0, 0), Vec3(555, 0, 0), Vec3(0, 0, 555), white));
-    world->add(make_shared<Quad>(Point3(555, 555, 555), Vec3(-555, 0, 0), Vec3(0, 0, -555), white));
-    world->add(make_shared<Quad>(Point3(0, 0, 555), Vec3(555, 0, 0), Vec3(0, 555, 0), white));
-
-    // 长方体
-    shared_ptr<Hittable> box1 = construct_box(Point3(0, 0, 0), Point3(165, 180, 165), aluminum);
-    box1 = make_shared<RotateY>(box1, 45);
-    box1 = make_shared<Translate>(box1, Vec3(240, 0, 240));
-    world->add(box1);
-
-    // 玻璃球
-    auto glass_sphere = make_shared<Sphere>(Point3(180, 160, 190), 90, make_shared<Dielectric>(1.5));
-    world->add(glass_sphere);
-
-    // 光源
-    auto quad = make_shared<Quad>(Point3(343, 554, 332), Vec3(-130, 0, 0), Vec3(0, 0, -105), lighting);
-    world->add(quad);
-
-    // 对光源几何体采样
-    shared_ptr<HittableList> light(new HittableList());
-    light->add(quad);
-    // 对玻璃球采样
-    light->add(glass_sphere);
-
-    cam.trace(world, light);
-    return;
-}
-
-// 预置场景：多球组合
-void scene_composite1(const Camera& cam)
-{
-    shared_ptr<HittableList> world = make_shared<HittableList>();
-    HittableList list;
-
-    auto ground_material = make_shared<Lambertian>(Color3(0.5, 0.5, 0.5));
-    list.add(make_shared<Sphere>(Point3(0, -1000, 0), 1000, ground_material));
-
-    for (int a = -11; a < 11; ++a)
-    {
-        for (int b = -11; b < 11; ++b)
-        {
-            auto choose_mat = random_double();
-            Point3 center(a + 0.9 * random_double(), 0.2, b + 0.9 * random_double());
-
-            if ((center - Point3(4, 0.2, 0)).norm() > 0.9)
-            {
-                shared_ptr<Material> sphere_material;
-
-                if (choose_mat < 0.8)
-                {
-                    auto albedo = Color3::random() * Color3::random();
-                    sphere_material = make_shared<Lambertian>(albedo);
-                    // 在0~1时间内从center运动到center_end，随机向上弹跳
-                    //auto center_end = center + Vec3(0, random_double(0, .5), 0);
-                    //list.add(make_shared<Sphere>(center, center_end, 0.2, sphere_material));
-                    list.add(make_shared<Sphere>(center, 0.2, sphere_material));
-                }
-                else if (choose_mat < 0.95)
-                {
-                    auto albedo = Color3::random(0.5, 1);
-                    auto fuzz = random_double(0, 0.5);
-                    sphere_material = make_shared<Metal>(albedo, fuzz);
-                    list.add(make_shared<Sphere>(center, 0.2, sphere_material));
-                }
-                else
-                {
-                    sphere_material = make_shared<Dielectric>(1.5);
-                    list.add(make_shared<Sphere>(center, 0.2, sphere_material));
-                }
-            }
-        }
-    }
-    // 折射
-    auto material1 = make_shared<Dielectric>(1.5);
-    list.add(make_shared<Sphere>(Point3(0, 1, 0), 1.0, material1));
-    // 漫反射
-    auto material2 = make_shared<Lambertian>(Color3(0.4, 0.2, 0.1));
-    list.add(make_shared<Sphere>(Point3(-4, 1, 0), 1.0, material2));
-    // 高光
-    auto material3 = make_shared<Metal>(Color3(0.7, 0.6, 0.5), 0.0);
-    list.add(make_shared<Sphere>(Point3(4, 1, 0), 1.0, material3));
-
-    world->add(make_shared<BVHNode>(list));
-
-    cam.trace(world);
-    return;
-}
-
-// 预置场景：多物体组合
-void scene_composite2(const Camera& cam)
-{
-    shared_ptr<HittableList> world = make_shared<HittableList>();
-
-    // 立方体组成的地板
-    HittableList boxes1;
-    auto ground_mat = make_shared<Lambertian>(Color3(0.48, 0.83, 0.53));
-    int boxes_per_side = 20;
-    for (int i = 0; i < boxes_per_side; ++i)
-    {
-        for (int j = 0; j < boxes_per_side; ++j)
-        {
-            auto w = 100.;
-            auto x0 = -1000. + i * w;
-            auto z0 = -1000. + j * w;
-            auto y0 = 0.;
-            auto x1 = x0 + w;
-            auto y1 = random_double(1, 101);
-            auto z1 = z0 + w;
-
-            boxes1.add(construct_box(Point3(x0, y0, z0), Point3(x1, y1, z1), ground_mat));
-        }
-    }
-    world->add(make_shared<BVHNode>(boxes1));
-
-    // 运动球
-    auto center1 = Point3(400, 400, 200);
-    auto center2 = center1 + Vec3(30, 0, 0);
-    auto sphere_mat = make_shared<Lambertian>(Color3(0.7, 0.3, 0.1));
-    world->add(make_shared<Sphere>(center1, center2, 50, sphere_mat));
-
-    // 玻璃球
-    world->add(make_shared<Sphere>(Point3(260, 150, 45), 50, make_shared<Dielectric>(1.5)));
-    // 金属球
-    world->add(make_shared<Sphere>(Point3(0, 150, 145), 50, make_shared<Metal>(Color3(0.8, 0.8, 0.9), 1.0)));
-
-    // 内含蓝色雾效的玻璃球
-    auto boundary = make_shared<Sphere>(Point3(360, 150, 145), 70, make_shared<Dielectric>(1.5));
-    world->add(boundary);
-    world->add(make_shared<ConstantMedium>(boundary, 0.2, Color3(0.2, 0.4, 0.9)));
-
-    // 全场景雾效
-    boundary = make_shared<Sphere>(Point3(0, 0, 0), 5000, make_shared<Dielectric>(1.5));
-    world->add(make_shared<ConstantMedium>(boundary, .0001, Color3(1, 1, 1)));
-
-    // 地球
-    auto earthmap = make_shared<Lambertian>(make_shared<ImageTexture>(kLoadPath + "earthmap.jpg"_str));
-    world->add(make_shared<Sphere>(Point3(400, 200, 400), 100, earthmap));
-
-    // 柏林噪声球
-    auto pertext = make_shared<NoiseTexture>(0.1);
-    world->add(make_shared<Sphere>(Point3(220, 280, 300), 80, make_shared<Lambertian>(pertext)));
-
-    // 球组成的立方体
-    HittableList boxes2;
-    auto white = make_shared<Lambertian>(Color3(.73, .73, .73));
-    int ns = 1000;
-    for (int j = 0; j < ns; j++)
-    {
-        boxes2.add(make_shared<Sphere>(Point3::random(0, 165), 10, white));
-    }
-    world->add(
-        make_shared<Translate>(
-            make_shared<RotateY>(make_shared<BVHNode>(boxes2), 15),
-            Vec3(-100, 270, 395))
-    );
-
-    // 光源
-    auto lighting = make_shared<DiffuseLight>(Color3(7, 7, 7));
-    world->add(make_shared<Quad>(Point3(123, 554, 147), Vec3(300, 0, 0), Vec3(0, 0, 265), lighting));
-
-    // 对光源几何体采样
-    shared_ptr<HittableList> light(new HittableList());
-    auto m = shared_ptr<Material>();
-    light->add(make_shared<Quad>(Point3(123, 554, 147), Vec3(300, 0, 0), Vec3(0, 0, 265), m));
-
-    cam.trace(world, light);
-    return;
-}
\ No newline at end of file
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+
+#include "logger.h"
+#include "scene.h"
+#include "triangle_rasterize.h"
+
+// 最近一次加载的obj（无论成功与否），避免每帧重复加载
+static fs::path loaded_obj_path;
+
+void scene_rasterize(const Camera& cam, const fs::path& obj_path, const shared_ptr<Material>& material, const int& mode)
+{
+    static std::vector<TriangleRasterize> triangles;
+    static shared_ptr<Material> prev_material;
+
+    // 避免每帧重复加载
+    // 预置场景也可能加载obj，因此与最近一次加载的obj比较
+    bool reload_obj = false;
+    bool reload_material = false;
+
+    if (loaded_obj_path != obj_path)
+    {
+        reload_obj = true;
+    }
+
+    if (prev_material != material)
+    {
+        prev_material = material;
+        reload_material = true;
+    }
+
+    if (reload_obj)
+    {
+        if (!prepare_rasterize_data(obj_path.string().c_str(), obj_path.parent_path().string().c_str(), true, triangles))
+        {
+            add_info(obj_path.string() + " failed to load for rastering.");
+            return;
+        }
+    }
+
+    if (reload_obj || reload_material)
+    {        
+        for(TriangleRasterize& tri : triangles)
+            tri.set_material(material);
+    }
+
+    cam.rasterize(triangles, mode);
+    return;
+}
+
+void scene_trace(const Camera& cam, const fs::path& obj_path, const shared_ptr<Material>& material, const bool& tracing_with_cornell_box, const BVHBuildOption& bvh_option)
+{
+    shared_ptr<HittableList> world = make_shared<HittableList>();
+    auto mesh = prepare_trace_data(material);
+    if (mesh == nullptr)
+    {
+        add_info(obj_path.string() + " failed to load for ray tracing.");
+        return;
+    }
+
+    BVHBuildOption mesh_option = bvh_option;
+    mesh_option.builder.mesh_hash = mesh_hash();
+
+    add_info("construct BVH ("_str + bvh_build_name(bvh_option) + ")...");
+    auto start = steady_clock::now();
+    world->add(construct_mesh(mesh, mesh_option));
+    auto end = steady_clock::now();
+    add_info("BVH elapsed time: "_str + STR(duration_cast<milliseconds>(end - start).count()) + "ms");
+
+    // 光源
+    auto lighting = make_shared<DiffuseLight>(Color3(3, 3, 3));
+    auto quad = make_shared<Quad>(Point3(-.5, 1.9, 2.5), Vec3(0, 0, -1), Vec3(1, 0, 0), lighting);
+    world->add(quad);
+    // 对光源几何体采样
+    shared_ptr<HittableList> light(new HittableList());
+    light->add(quad);
+
+    if (tracing_with_cornell_box)
+    {
+        // 包围盒
+        auto red = make_shared<Lambertian>(Color3(.65, .05, .05));
+        auto white = make_shared<Lambertian>(Color3(.73, .73, .73));
+        auto green = make_shared<Lambertian>(Color3(.12, .45, .15));
+        world->add(make_shared<Quad>(Point3(2, -2, 0), Vec3(0, 4, 0), Vec3(0, 0, 4), green));
+        world->add(make_shared<Quad>(Point3(-2, -2, 0), Vec3(0, 4, 0), Vec3(0, 0, 4), red));
+        world->add(make_shared<Quad>(Point3(-2, -2, 0), Vec3(4, 0, 0), Vec3(0, 0, 4), white));
+        world->add(make_shared<Quad>(Point3(2, 2, 4), Vec3(-4, 0, 0), Vec3(0, 0, -4), white));
+        world->add(make_shared<Quad>(Point3(-2, -2, 4), Vec3(4, 0, 0), Vec3(0, 4, 0), white));
+
+        // 金属球
+        auto metal_sphere = make_shared<Sphere>(Point3(-1, -1, 2), .5, make_shared<Metal>(Color3(1, .84, 0), 0.));
+        // 玻璃球
+        auto glass_sphere = make_shared<Sphere>(Point3(1, 1, 2), .5, make_shared<Dielectric>(1.5));
+        world->add(glass_sphere);
+        world->add(metal_sphere);
+
+        // 对玻璃球采样
+        light->add(glass_sphere);
+    }
+
+    cam.trace(world, light);
+    return;
+}
+
+// 测试三角形
+void scene_test_triangle(const Camera& cam)
+{
+    shared_ptr<HittableList> world = make_shared<HittableList>();
+
+    auto earthmap = make_shared<ImageTexture>(kLoadPath + "earthmap.jpg"_str);
+    auto mesh = make_shared<TriangleMesh>(
+        std::vector<float>{ 0, 0, 1, 1, 0, 0, 0, 1, 0 },
+        std::vector<float>{ 0, 0, 1, 0, 0, 1, 0, 0, 1 },
+        std::vector<float>{ 0, 0, 1, 0, 0, 1 },
+        std::vector<uint>{ 0, 1, 2 },
+        make_shared<Lambertian>(earthmap));
+    world->add(make_shared<Triangle>(mesh, 0));
+
+    cam.trace(world);
+    return;
+}
+
+// 使用tinyobj加载直接获得的数据
+static tinyobj::attrib_t attrib;
+static std::vector<tinyobj::shape_t> shapes;
+static std::vector<tinyobj::material_t> materials;
+static ullong vnum = 0, nnum = 0, tnum = 0, snum = 0, mnum = 0, tot_fnum = 0;
+
+// obj中第i个顶点位置、法线和纹理坐标，索引为负（缺少该属性）时为0
+static Point3 obj_position(int i)
+{
+    return i < 0 ? Point3() : Point3(attrib.vertices[3 * i + 0], attrib.vertices[3 * i + 1], attrib.vertices[3 * i + 2]);
+}
+
+static Vec3 obj_normal(int i)
+{
+    return i < 0 ? Vec3() : Vec3(attrib.normals[3 * i + 0], attrib.normals[3 * i + 1], attrib.normals[3 * i + 2]);
+}
+
+static Texcoord2 obj_texcoord(int i)
+{
+    return i < 0 ? Texcoord2() : Texcoord2(attrib.texcoords[2 * i + 0], attrib.texcoords[2 * i + 1]);
+}
+
+// 加载obj
+bool load_obj_internal(const char* filename, const char* basepath, bool triangulate)
+{
+    std::string warn;
+    std::string err;
+
+    bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err,
+        filename, basepath, triangulate);
+    loaded_obj_path = filename;
+
+    add_info("----------------");
+    add_info("load .obj: "_str + filename);
+
+    if (!warn.empty())
+    {
+        add_info("WARN: " + warn);
+    }
+
+    if (!err.empty())
+    {
+        add_info("ERR: " + err);
+    }
+
+    if (!ret)
+    {
+        add_info("Failed to load/parse .obj.");
+        return false;
+    }
+
+    vnum = attrib.vertices.size() / 3;
+    nnum = attrib.normals.size() / 3;
+    tnum = attrib.texcoords.size() / 2;
+    snum = shapes.size();
+    mnum = materials.size();
+    tot_fnum = 0;
+    for (ullong i = 0; i < snum; i++)
+    {
+        tot_fnum += shapes[i].mesh.num_face_vertices.size();
+    }
+
+    add_info("vertices: "  + STR(vnum));
+    add_info("normals: "   + STR(nnum));
+    add_info("texcoords: " + STR(tnum));
+    add_info("shapes: "    + STR(snum));
+    add_info("faces: "     + STR(tot_fnum));
+    add_info("materials: " + STR(mnum));
+
+    return true;
+}
+
+// 为光线追踪准备数据
+// obj的位置、法线、纹理坐标各自索引，三者索引都相同的顶点合并为一个，所有面组成一个网格
+shared_ptr<TriangleMesh> prepare_trace_data(const shared_ptr<Material>& material)
+{
+    // 光栅化预览已加载obj，不必再次加载
+
+    struct IndexHash
+    {
+        size_t operator()(const tinyobj::index_t& index) const
+        {
+            return static_cast<size_t>(hash_bytes(&index, sizeof(index)));
+        }
+    };
+    struct IndexEqual
+    {
+        bool operator()(const tinyobj::index_t& a, const tinyobj::index_t& b) const
+        {
+            return a.vertex_index == b.vertex_index && a.normal_index == b.normal_index && a.texcoord_index == b.texcoord_index;
+        }
+    };
+    std::unordered_map<tinyobj::index_t, uint, IndexHash, IndexEqual> vertex_ids;
+
+    std::vector<float> positions, mesh_normals, mesh_texcoords;
+    std::vector<uint> indices;
+    indices.reserve(tot_fnum * 3);
+    bool has_normals = nnum > 0, has_texcoords = tnum > 0;
+
+    for (ullong i = 0; i < snum; i++)
+    {
+        add_info("shape name: "_str + shapes[i].name);
+        add_info("  mesh indices num: "_str   + STR(shapes[i].mesh.indices.size()));
+        add_info("  lines indices num: "_str  + STR(shapes[i].lines.indices.size()));
+        add_info("  points indices num: "_str + STR(shapes[i].points.indices.size()));
+
+        ullong fnum = shapes[i].mesh.num_face_vertices.size();
+
+        assert(fnum == shapes[i].mesh.material_ids.size());
+        assert(fnum == shapes[i].mesh.smoothing_group_ids.size());
+
+        add_info("  faces num: "_str + STR(fnum));
+
+        for (ullong f = 0; f < fnum; f++)
+        {
+            // 每面顶点数必须为3
+            assert(shapes[i].mesh.num_face_vertices[f] == 3);
+        }
+
+        for (const tinyobj::index_t& index : shapes[i].mesh.indices)
+        {
+            auto [it, inserted] = vertex_ids.try_emplace(index, static_cast<uint>(vertex_ids.size()));
+            indices.push_back(it->second);
+            if (!inserted)
+                continue;
+
+            Point3 p = obj_position(index.vertex_index);
+            Vec3 n = obj_normal(index.normal_index);
+            Texcoord2 t = obj_texcoord(index.texcoord_index);
+            positions.insert(positions.end(), { static_cast<float>(p[0]), static_cast<float>(p[1]), static_cast<float>(p[2]) });
+            mesh_normals.insert(mesh_normals.end(), { static_cast<float>(n[0]), static_cast<float>(n[1]), static_cast<float>(n[2]) });
+            mesh_texcoords.insert(mesh_texcoords.end(), { static_cast<float>(t.u()), static_cast<float>(t.v()) });
+            // 部分顶点缺少法线或纹理坐标时整个网格都不使用
+            has_normals = has_normals && index.normal_index >= 0;
+            has_texcoords = has_texcoords && index.texcoord_index >= 0;
+        }
+    }
+
+    if (!has_normals)
+        mesh_normals.clear();
+    if (!has_texcoords)
+        mesh_texcoords.clear();
+    add_info("mesh vertices: "_str + format_num(positions.size() / 3));
+    if (indices.empty())
+        return nullptr;
+
+    return make_shared<TriangleMesh>(positions, mesh_normals, mesh_texcoords, std::move(indices), material);
+}
+
+// 三角形由顶点位置和顶点索引决定，法线和纹理坐标不影响BVH
+ullong mesh_hash()
+{
+    ullong hash = hash_bytes(attrib.vertices.data(), attrib.vertices.size() * sizeof(tinyobj::real_t));
+    for (const auto& shape : shapes)
+    {
+        for (const auto& index : shape.mesh.indices)
+            hash = hash_bytes(&index.vertex_index, sizeof(index.vertex_index), hash);
+    }
+    return hash;
+}
+
+// 为光栅化准备数据
+bool prepare_rasterize_data(const char* filename, const char* basepath, bool triangulate, std::vector<TriangleRasterize>& triangles)
+{
+    if (!load_obj_internal(filename, basepath, triangulate))
+    {
+        return false;
+    }
+
+    std::vector<TriangleRasterize> tris = std::vector<TriangleRasterize>(tot_fnum);
+    ullong tri_index = 0;
+
+    for (ullong i = 0; i < snum; i++)
+    {
+        ullong fnum = shapes[i].mesh.num_face_vertices.size();
+
+        assert(fnum == shapes[i].mesh.material_ids.size());
+        assert(fnum == shapes[i].mesh.smoothing_group_ids.size());
+
+        ullong index_offset = 0;
+        for (ullong f = 0; f < fnum; f++)
+        {
+            ullong v_per_f = shapes[i].mesh.num_face_vertices[f];
+            // 每面顶点数必须为3
+            assert(v_per_f == 3);
+
+            tinyobj::index_t idx_a = shapes[i].mesh.indices[index_offset];
+            int a  = idx_a.vertex_index;
+            int an = idx_a.normal_index;
+            int at = idx_a.texcoord_index;
+
+            tinyobj::index_t idx_b = shapes[i].mesh.indices[index_offset + 1];
+            int b  = idx_b.vertex_index;
+            int bn = idx_b.normal_index;
+            int bt = idx_b.texcoord_index;
+
+            tinyobj::index_t idx_c = shapes[i].mesh.indices[index_offset + 2];
+            int c  = idx_c.vertex_index;
+            int cn = idx_c.normal_index;
+            int ct = idx_c.texcoord_index;
+
+            //根据索引存储三角形
+            TriangleRasterize tri;
+            tri.set_vertex(obj_position(a), obj_position(b), obj_position(c));
+            tri.set_normal(obj_normal(an), obj_normal(bn), obj_normal(cn));
+            tri.set_texcoord(obj_texcoord(at), obj_texcoord(bt), obj_texcoord(ct));
+
+            tris[tri_index + f] = tri;
+
+            index_offset += v_per_f;
+        }
+        tri_index += fnum;
+    }
+
+    triangles = tris;
+
+    return true;
+}
+
+// 预置场景：棋盘格球
+void scene_checker(const Camera& cam)
+{
+    shared_ptr<HittableList> world = make_shared<HittableList>();
+
+    auto checker = make_shared<CheckerTexture>(0.8, Color3(.2, .3, .1), Color3(.9, .9, .9));
+
+    world->add(make_shared<Sphere>(Point3(0, -10, 0), 10, make_shared<Lambertian>(checker)));
+    world->add(make_shared<Sphere>(Point3(0, 10, 0), 10, make_shared<Lambertian>(checker)));
+
+    cam.trace(world);
+    return;
+}
+
+// 预置场景：康奈尔盒
+void scene_cornell_box(const Camera& cam)
+{
+    shared_ptr<HittableList> world = make_shared<HittableList>();
+
+    // 材质
+    auto red   = make_shared<Lambertian>(Color3(.65, .05, .05));
+    auto white = make_shared<Lambertian>(Color3(.73, .73, .73));
+    auto green = make_shared<Lambertian>(Color3(.12, .45, .15));
+    auto lighting = make_shared<DiffuseLight>(Color3(15, 15, 15));
+    auto aluminum = make_shared<Metal>(Color3(.8, .85, .88), 0.);
+
+    // 包围盒
+    world->add(make_shared<Quad>(Point3(555, 0, 0), Vec3(0, 555, 0), Vec3(0, 0, 555), green));
+    world->add(make_shared<Quad>(Point3(0, 0, 0), Vec3(0, 555, 0), Vec3(0, 0, 555), red));
+    world->add(make_shared<Quad>(Point3(0, 0, 0), Vec3(555, 0, 0), Vec3(0, 0, 555), white));
+    world->add(make_shared<Quad>(Point3(555, 555, 555), Vec3(-555, 0, 0), Vec3(0, 0, -555), white));
+    world->add(make_shared<Quad>(Point3(0, 0, 555), Vec3(555, 0, 0), Vec3(0, 555, 0), white));
+
+    // 长方体
+    shared_ptr<Hittable> box1 = construct_box(Point3(0, 0, 0), Point3(165, 180, 165), aluminum);
+    box1 = make_shared<RotateY>(box1, 45);
+    box1 = make_shared<Translate>(box1, Vec3(240, 0, 240));
+    world->add(box1);
+
+    // 玻璃球
+    auto glass_sphere = make_shared<Sphere>(Point3(180, 160, 190), 90, make_shared<Dielectric>(1.5));
+    world->add(glass_sphere);
+
+    // 光源
+    auto quad = make_shared<Quad>(Point3(343, 554, 332), Vec3(-130, 0, 0), Vec3(0, 0, -105), lighting);
+    world->add(quad);
+
+    // 对光源几何体采样
+    shared_ptr<HittableList> light(new HittableList());
+    light->add(quad);
+    // 对玻璃球采样
+    light->add(glass_sphere);
+
+    cam.trace(world, light);
+    return;
+}
+
+// 构建加速结构并输出构建时间，name为场景中该部分的名称
+// 再从包围盒外随机射向包围盒内的光线逐条求交，输出追踪时间，便于比较不同加速结构
+static shared_ptr<Hittable> construct_bvh_timed(const HittableList& list, const BVHBuildOption& bvh_option, const std::string& name)
+{
+    const int kTraceRays = 1 << 16;
+
+    add_info("construct "_str + name + " (" + bvh_build_name(bvh_option) + ")...");
+    auto start = steady_clock::now();
+    auto bvh = construct_bvh(list, bvh_option);
+    auto end = steady_clock::now();
+    add_info(name + " elapsed time: " + STR(duration_cast<microseconds>(end - start).count()) + "us");
+
+    AABB bbox = bvh->get_bbox();
+    Point3 center = bbox.centroid();
+    double radius = Vec3(bbox.x().get_size(), bbox.y().get_size(), bbox.z().get_size()).norm();
+    std::vector<Ray> rays(kTraceRays);
+    for (Ray& r : rays)
+    {
+        Point3 origin = center + random_unit_vector() * radius;
+        Point3 target(
+            random_double(bbox.x().get_min(), bbox.x().get_max()),
+            random_double(bbox.y().get_min(), bbox.y().get_max()),
+            random_double(bbox.z().get_min(), bbox.z().get_max()));
+        r = Ray(origin, target - origin, 0);
+    }
+
+    ullong hits = 0;
+    start = steady_clock::now();
+    for (const Ray& r : rays)
+    {
+        HitRecord rec;
+        hits += bvh->hit(r, Interval(0, kInfinitDouble), rec);
+    }
+    end = steady_clock::now();
+    traversal_stats = TraversalStats(); // 计时光线不计入渲染的节点访问统计
+    add_info(name + " trace time: " + STR(duration_cast<microseconds>(end - start).count()) + "us for "
+        + format_num(kTraceRays) + " rays, " + format_num(hits) + " hits");
+    return bvh;
+}
+
+// 预置场景：多球组合
+void scene_composite1(const Camera& cam, const BVHBuildOption& bvh_option)
+{
+    shared_ptr<HittableList> world = make_shared<HittableList>();
+    HittableList list;
+
+    auto ground_material = make_shared<Lambertian>(Color3(0.5, 0.5, 0.5));
+    list.add(make_shared<Sphere>(Point3(0, -1000, 0), 1000, ground_material));
+
+    for (int a = -11; a < 11; ++a)
+    {
+        for (int b = -11; b < 11; ++b)
+        {
+            auto choose_mat = random_double();
+            Point3 center(a + 0.9 * random_double(), 0.2, b + 0.9 * random_double());
+
+            if ((center - Point3(4, 0.2, 0)).norm() > 0.9)
+            {
+                shared_ptr<Material> sphere_material;
+
+                if (choose_mat < 0.8)
+                {
+                    auto albedo = Color3::random() * Color3::random();
+                    sphere_material = make_shared<Lambertian>(albedo);
+                    // 在0~1时间内从center运动到center_end，随机向上弹跳
+                    //auto center_end = center + Vec3(0, random_double(0, .5), 0);
+                    //list.add(make_shared<Sphere>(center, center_end, 0.2, sphere_material));
+                    list.add(make_shared<Sphere>(center, 0.2, sphere_material));
+                }
+                else if (choose_mat < 0.95)
+                {
+                    auto albedo = Color3::random(0.5, 1);
+                    auto fuzz = random_double(0, 0.5);
+                    sphere_material = make_shared<Metal>(albedo, fuzz);
+                    list.add(make_shared<Sphere>(center, 0.2, sphere_material));
+                }
+                else
+                {
+                    sphere_material = make_shared<Dielectric>(1.5);
+                    list.add(make_shared<Sphere>(center, 0.2, sphere_material));
+                }
+            }
+        }
+    }
+    // 折射
+    auto material1 = make_shared<Dielectric>(1.5);
+    list.add(make_shared<Sphere>(Point3(0, 1, 0), 1.0, material1));
+    // 漫反射
+    auto material2 = make_shared<Lambertian>(Color3(0.4, 0.2, 0.1));
+    list.add(make_shared<Sphere>(Point3(-4, 1, 0), 1.0, material2));
+    // 高光
+    auto material3 = make_shared<Metal>(Color3(0.7, 0.6, 0.5), 0.0);
+    list.add(make_shared<Sphere>(Point3(4, 1, 0), 1.0, material3));
+
+    world->add(construct_bvh_timed(list, bvh_option, "sphere field"));
+
+    cam.trace(world);
+    return;
+}
+
+// 预置场景：运动模糊
+// 小球在0~1时间内随机向上弹跳，中央的大球静止作为对照，用于检验运动BVH
+void scene_motion_blur(const Camera& cam, const BVHBuildOption& bvh_option)
+{
+    shared_ptr<HittableList> world = make_shared<HittableList>();
+    HittableList list;
+
+    auto ground_material = make_shared<Lambertian>(Color3(0.5, 0.5, 0.5));
+    list.add(make_shared<Sphere>(Point3(0, -1000, 0), 1000, ground_material));
+
+    for (int a = -11; a < 11; ++a)
+    {
+        for (int b = -11; b < 11; ++b)
+        {
+            Point3 center(a + 0.9 * random_double(), 0.2, b + 0.9 * random_double());
+            if ((center - Point3(0, 0.2, 0)).norm() > 1.2)
+            {
+                auto albedo = Color3::random() * Color3::random();
+                auto sphere_material = make_shared<Lambertian>(albedo);
+                auto center_end = center + Vec3(0, random_double(0, .5), 0);
+                list.add(make_shared<Sphere>(center, center_end, 0.2, sphere_material));
+            }
+        }
+    }
+    auto material = make_shared<Lambertian>(Color3(0.4, 0.2, 0.1));
+    list.add(make_shared<Sphere>(Point3(0, 1, 0), 1.0, material));
+
+    world->add(construct_bvh_timed(list, bvh_option, "moving spheres"));
+
+    cam.trace(world);
+    return;
+}
+
+// 预置场景：多物体组合
+void scene_composite2(const Camera& cam, const BVHBuildOption& bvh_option)
+{
+    shared_ptr<HittableList> world = make_shared<HittableList>();
+
+    // 立方体组成的地板
+    HittableList boxes1;
+    auto ground_mat = make_shared<Lambertian>(Color3(0.48, 0.83, 0.53));
+    int boxes_per_side = 20;
+    for (int i = 0; i < boxes_per_side; ++i)
+    {
+        for (int j = 0; j < boxes_per_side; ++j)
+        {
+            auto w = 100.;
+            auto x0 = -1000. + i * w;
+            auto z0 = -1000. + j * w;
+            auto y0 = 0.;
+            auto x1 = x0 + w;
+            auto y1 = random_double(1, 101);
+            auto z1 = z0 + w;
+
+            boxes1.add(construct_box(Point3(x0, y0, z0), Point3(x1, y1, z1), ground_mat));
+        }
+    }
+    world->add(construct_bvh_timed(boxes1, bvh_option, "box floor"));
+
+    // 运动球
+    auto center1 = Point3(400, 400, 200);
+    auto center2 = center1 + Vec3(30, 0, 0);
+    auto sphere_mat = make_shared<Lambertian>(Color3(0.7, 0.3, 0.1));
+    world->add(make_shared<Sphere>(center1, center2, 50, sphere_mat));
+
+    // 玻璃球
+    world->add(make_shared<Sphere>(Point3(260, 150, 45), 50, make_shared<Dielectric>(1.5)));
+    // 金属球
+    world->add(make_shared<Sphere>(Point3(0, 150, 145), 50, make_shared<Metal>(Color3(0.8, 0.8, 0.9), 1.0)));
+
+    // 内含蓝色雾效的玻璃球
+    auto boundary = make_shared<Sphere>(Point3(360, 150, 145), 70, make_shared<Dielectric>(1.5));
+    world->add(boundary);
+    world->add(make_shared<ConstantMedium>(boundary, 0.2, Color3(0.2, 0.4, 0.9)));
+
+    // 全场景雾效
+    boundary = make_shared<Sphere>(Point3(0, 0, 0), 5000, make_shared<Dielectric>(1.5));
+    world->add(make_shared<ConstantMedium>(boundary, .0001, Color3(1, 1, 1)));
+
+    // 地球
+    auto earthmap = make_shared<Lambertian>(make_shared<ImageTexture>(kLoadPath + "earthmap.jpg"_str));
+    world->add(make_shared<Sphere>(Point3(400, 200, 400), 100, earthmap));
+
+    // 柏林噪声球
+    auto pertext = make_shared<NoiseTexture>(0.1);
+    world->add(make_shared<Sphere>(Point3(220, 280, 300), 80, make_shared<Lambertian>(pertext)));
+
+    // 球组成的立方体
+    HittableList boxes2;
+    auto white = make_shared<Lambertian>(Color3(.73, .73, .73));
+    int ns = 1000;
+    for (int j = 0; j < ns; j++)
+    {
+        boxes2.add(make_shared<Sphere>(Point3::random(0, 165), 10, white));
+    }
+    world->add(
+        make_shared<Translate>(
+            make_shared<RotateY>(construct_bvh_timed(boxes2, bvh_option, "sphere cube"), 15),
+            Vec3(-100, 270, 395))
+    );
+
+    // 光源
+    auto lighting = make_shared<DiffuseLight>(Color3(7, 7, 7));
+    world->add(make_shared<Quad>(Point3(123, 554, 147), Vec3(300, 0, 0), Vec3(0, 0, 265), lighting));
+
+    // 对光源几何体采样
+    shared_ptr<HittableList> light(new HittableList());
+    auto m = shared_ptr<Material>();
+    light->add(make_shared<Quad>(Point3(123, 554, 147), Vec3(300, 0, 0), Vec3(0, 0, 265), m));
+
+    cam.trace(world, light);
+    return;
+}
+
+// 预置场景：实例化
+// 所有spot共享同一个底层BVH，顶层BVH只包含实例
+void scene_instances(const Camera& cam, const BVHBuildOption& bvh_option)
+{
+    shared_ptr<HittableList> world = make_shared<HittableList>();
+
+    auto obj_path = kLoadPath + "spot/spot_triangulated_good.obj"_str;
+    auto base_path = kLoadPath + "spot/"_str;
+    if (!load_obj_internal(obj_path.c_str(), base_path.c_str(), true))
+        return;
+
+    auto spot_mat = make_shared<Lambertian>(make_shared<ImageTexture>(kLoadPath + "spot/spot_texture.png"_str));
+    auto mesh = prepare_trace_data(spot_mat);
+    if (mesh == nullptr)
+    {
+        add_info(obj_path + " failed to load for ray tracing.");
+        return;
+    }
+
+    add_info("construct BVH ("_str + bvh_build_name(bvh_option) + ")...");
+    auto start = steady_clock::now();
+
+    // 底层BVH
+    BVHBuildOption mesh_option = bvh_option;
+    mesh_option.builder.mesh_hash = mesh_hash();
+    auto blas = construct_mesh(mesh, mesh_option);
+
+    // 实例，少数实例覆盖材质
+    HittableList instances;
+    std::vector<Mat<3, 3>> linears;
+    std::vector<Vec3> translations;
+    auto metal = make_shared<Metal>(Color3(.8, .85, .88), .1);
+    auto glass = make_shared<Dielectric>(1.5);
+    int spots_per_side = 48;
+    double spacing = 2.5;
+    for (int i = 0; i < spots_per_side; ++i)
+    {
+        for (int j = 0; j < spots_per_side; ++j)
+        {
+            auto scale = random_double(.7, 1.3);
+            auto linear = rotate_matrix(Vec3(0, 1, 0), random_double(0, 360)) * scale_matrix(Vec3(scale, scale, scale));
+            Vec3 translation(
+                (i - spots_per_side * .5) * spacing + random_double(-.5, .5),
+                .737 * scale,
+                (j - spots_per_side * .5) * spacing + random_double(-.5, .5));
+
+            auto choose_mat = random_double();
+            shared_ptr<Material> material = choose_mat < .9 ? nullptr : (choose_mat < .97 ? shared_ptr<Material>(metal) : shared_ptr<Material>(glass));
+            linears.emplace_back(linear);
+            translations.emplace_back(translation);
+            instances.add(make_shared<Instance>(blas, make_affine(linear, translation), material));
+        }
+    }
+
+    // 顶层BVH
+    auto tlas = construct_bvh(instances, bvh_option);
+    world->add(tlas);
+
+    auto end = steady_clock::now();
+    add_info("BVH elapsed time: "_str + STR(duration_cast<milliseconds>(end - start).count()) + "ms");
+
+    // 模拟一帧动画：在实例和顶层BVH的副本上让每个实例原地转动，顶层BVH保持结构只更新包围盒，渲染的场景不变
+    if (bvh_option.refit_benchmark)
+    {
+        HittableList copies;
+        std::vector<shared_ptr<Instance>> spots;
+        for (size_t i = 0; i < linears.size(); ++i)
+        {
+            spots.emplace_back(make_shared<Instance>(blas, make_affine(linears[i], translations[i])));
+            copies.add(spots.back());
+        }
+        auto copy_tlas = construct_bvh(copies, bvh_option);
+
+        start = steady_clock::now();
+        auto turn = rotate_matrix(Vec3(0, 1, 0), 30);
+        for (size_t i = 0; i < spots.size(); ++i)
+            spots[i]->set_transform(make_affine(turn * linears[i], translations[i]));
+        copy_tlas->refit();
+        end = steady_clock::now();
+        add_info("BVH refit elapsed time: "_str + STR(duration_cast<microseconds>(end - start).count()) + "us");
+    }
+
+    ullong instance_count = instances.get_objects().size();
+    ullong triangle_count = mesh->face_count();
+    add_info("instances: "_str + format_num(instance_count) + ", triangles per instance: " + format_num(triangle_count));
+    add_info("instanced triangles: "_str + format_num(instance_count * triangle_count) + ", stored triangles: " + format_num(triangle_count));
+    add_info("instance bytes: "_str + format_num(instance_count * sizeof(Instance)));
+
+    // 地面
+    world->add(make_shared<Sphere>(Point3(0, -1000, 0), 1000, make_shared<Lambertian>(Color3(.5, .5, .5))));
+
+    cam.trace(world);
+    return;
+}
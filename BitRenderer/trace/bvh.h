@@ -0,0 +1,60 @@
+/*
+ * BVH构建入口
+ * 按构建参数选择BVH的节点布局，或以kd树、均匀网格代替BVH
+ */
+#ifndef BVH_H
+#define BVH_H
+
+#include "grid.h"
+#include "kd_tree.h"
+#include "mesh_bvh.h"
+#include "motion_bvh.h"
+#include "triangle.h"
+#include "wide_bvh.h"
+
+// 构建BVH，按参数选择kd树、网格、运动BVH、指针树、二叉线性布局或多叉线性布局
+// kd树和网格按运动物体整个时间段的包围盒构建
+inline shared_ptr<Hittable> construct_bvh(const HittableList& list, const BVHBuildOption& option)
+{
+    if (option.accelerator & AcceleratorFlags_KdTree)
+        return make_shared<KdTree>(list, option);
+    if (option.accelerator & AcceleratorFlags_Grid)
+        return make_shared<Grid>(list, option);
+
+    if (option.motion.enabled)
+    {
+        auto objects = list.get_objects();
+        if (std::any_of(objects.begin(), objects.end(), [](const shared_ptr<Hittable>& object) { return object->is_moving(); }))
+            return make_shared<MotionBVH>(list, option);
+    }
+
+    if (!option.layout.linear_layout)
+        return make_shared<BVHNode>(list, option);
+
+    switch (option.layout.branching)
+    {
+    case 4:
+        if (option.layout.quantized)
+            return make_shared<WideBVH<4, true>>(list, option);
+        return make_shared<WideBVH<4>>(list, option);
+    case 8:
+        if (option.layout.quantized)
+            return make_shared<WideBVH<8, true>>(list, option);
+        return make_shared<WideBVH<8>>(list, option);
+    default: return make_shared<LinearBVH>(list, option);
+    }
+}
+
+// 构建三角形网格的加速结构
+// 使用BVH且不做空间划分时整个网格由MeshBVH按面编号求交，否则为每个面创建三角形图元再构建
+inline shared_ptr<Hittable> construct_mesh(const shared_ptr<const TriangleMesh>& mesh, const BVHBuildOption& option)
+{
+    if (option.compact_mesh && (option.accelerator & AcceleratorFlags_BVH) && !option.builder.spatial_splits)
+        return make_shared<MeshBVH>(mesh, option);
+
+    HittableList triangles;
+    add_triangles(mesh, triangles);
+    return construct_bvh(triangles, option);
+}
+
+#endif // !BVH_H
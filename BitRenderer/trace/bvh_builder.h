@@ -0,0 +1,1298 @@
+/*
+ * BVH构建器
+ * 预先计算并缓存图元包围盒和质心，在同一个图元引用数组上原地划分，不复制图元数组
+ * 构建结果为深度优先顺序的节点数组，供BVHNode和LinearBVH生成各自的节点
+ */
+#ifndef BVH_BUILDER_H
+#define BVH_BUILDER_H
+
+#include "bvh_cache.h"
+#include "hittable.h"
+#include "morton.h"
+
+// 二叉BVH构建器（BVHBuilder）的参数，各种BVH节点布局共用
+struct BVHBuilderOption
+{
+    int    build_flag     = BVHBuildFlags_SAH; // 构建方式
+    int    bin_count      = 16; // SAH分桶数
+    double traversal_cost = 1.; // 遍历一次节点的代价（以求交一次图元的代价为1），划分代价高于建叶节点代价时建叶节点
+    int    max_leaf_size  = 4;  // 叶节点最多图元数
+    int    morton_bits    = 30; // LBVH的Morton码位数，30或63
+    bool   treelet_optimization = false; // LBVH是否按Morton码高位分组，在组之上用SAH构建顶层
+    bool   spatial_splits = false;  // SAH是否同时考虑空间划分（SBVH）
+    double overlap_budget = 1e-5;   // 物体划分的左右子节点重叠面积与根节点表面积之比超过此值时才尝试空间划分
+    double duplication_budget = .5; // 空间划分最多复制的引用数与图元数之比
+    bool   disk_cache     = false; // 是否将网格的构建结果缓存到磁盘
+    ullong mesh_hash      = 0;    // 网格内容哈希，非0时与构建参数一起作为磁盘缓存的键
+};
+
+// BVH节点布局与遍历的参数
+struct BVHLayoutOption
+{
+    bool   ordered_traversal = true; // 遍历二叉BVH时是否按光线方向在划分轴上的符号先访问近处子节点
+    bool   linear_layout  = true; // 是否压缩为线性BVH
+    int    branching      = 4;    // 线性BVH的分支数，2、4或8
+    bool   quantized      = false; // 多叉BVH的子节点包围盒是否量化为8位
+    double refit_threshold = 1.5; // refit后SAH代价超过构建时的此倍数时完全重建
+    bool   simd_triangles = true;  // 网格BVH的叶节点是否用SIMD一次与4或8个三角形求交，否则逐个三角形执行相同的运算
+};
+
+// 运动BVH的参数
+struct MotionBVHOption
+{
+    bool enabled         = true;  // 含运动物体时是否构建运动BVH，节点存储0、1时刻的包围盒并按光线时刻插值
+    bool temporal_splits = false; // 是否按运动幅度将时间划分为多段，每段各建一棵树
+};
+
+// 均匀网格的参数
+struct GridOption
+{
+    bool hashed = false; // 是否只存储非空单元，按单元编号在哈希表中查找
+};
+
+// 加速结构的参数，各加速结构只读取自己的部分
+struct BVHBuildOption
+{
+    int    accelerator    = AcceleratorFlags_BVH; // 加速结构
+    bool   compact_mesh   = true;  // 三角形网格是否作为一个图元按面编号求交，不为每个三角形创建图元对象；kd树、网格和SBVH不使用
+    bool   quality_report = false; // 构建后是否输出树的质量统计
+    bool   refit_benchmark = false; // 实例场景渲染前是否在顶层BVH的副本上模拟一帧动画，输出refit用时
+    BVHBuilderOption builder;
+    BVHLayoutOption  layout;
+    MotionBVHOption  motion;
+    GridOption       grid;
+};
+
+// BVH构建方式或加速结构名称，用于输出信息
+inline std::string bvh_build_name(const BVHBuildOption& option)
+{
+    if (option.accelerator & AcceleratorFlags_KdTree)
+        return "SAH kd-tree";
+    if (option.accelerator & AcceleratorFlags_Grid)
+        return option.grid.hashed ? "hashed grid" : "uniform grid";
+    if (option.builder.build_flag & BVHBuildFlags_SAH)
+        return option.builder.spatial_splits ? "SBVH" : "SAH";
+    if (option.builder.build_flag & BVHBuildFlags_LBVH)
+        return "LBVH "_str + std::to_string(option.builder.morton_bits) + "-bit" + (option.builder.treelet_optimization ? " + treelet" : "");
+    return "median";
+}
+
+// 构建结果节点
+// 深度优先顺序下左子节点紧随父节点之后，只需记录右子节点索引
+struct BVHBuildNode
+{
+    AABB bbox;
+    uint offset; // 内部节点：右子节点索引；叶节点：首个图元在索引数组中的位置
+    uint count;  // 叶节点图元数，内部节点为0
+    int  axis;   // 划分轴
+};
+
+class BVHBuilder
+{
+public:
+    // 叶节点的最大深度，二叉BVH遍历时栈中最多有kMaxDepth项
+    // 接近此深度时不再按SAH或Morton码划分，改为建叶节点或中位数划分，保证各种节点布局的遍历栈不会溢出
+    static const int kMaxDepth = 63;
+
+private:
+    static const int kMaxBinCount = 64;
+    // 以下阈值只与图元数有关，与线程数无关，保证构建结果确定
+    static const uint kParallelSize = 1 << 16; // 图元数不少于此值的节点并行计算包围盒、分桶和划分
+    static const uint kChunkSize    = 1 << 14; // 并行时每块的图元数
+    static const uint kTaskSize     = 1 << 14; // 左右子树图元数都不少于此值时右子树可作为并行任务构建，是否新开线程另由任务层数决定
+
+    // 图元引用，连续存放以便顺序访问
+    struct Reference
+    {
+        AABB bbox;
+        Point3 centroid;
+        uint index;
+    };
+
+    struct Bin
+    {
+        uint count = 0;
+        AABB bbox;
+    };
+
+    using Bins = std::array<std::array<Bin, kMaxBinCount>, 3>;
+
+    // LBVH中Morton码高位相同的一组图元，各组分别构建子树
+    struct Treelet
+    {
+        uint start, end;
+        AABB bbox;
+        Point3 centroid;
+        std::vector<BVHBuildNode> nodes;
+    };
+
+    static const int kTreeletBits = 12; // 分组所用的Morton码高位数
+
+    // SBVH空间划分的桶，记录从该桶进入和离开的引用数
+    struct SpatialBin
+    {
+        uint enter = 0, exit = 0;
+        AABB bbox;
+    };
+
+    using SpatialBins = std::array<std::array<SpatialBin, kMaxBinCount>, 3>;
+
+    static const int kMaxSpatialDepth = 48; // 超过此深度不再空间划分，限制树深
+
+    BVHBuilderOption option_;
+    const std::vector<shared_ptr<Hittable>>* objects_ = nullptr; // 图元，SBVH用于裁剪引用
+    std::vector<Reference> refs_; // 原地划分的图元引用
+    std::vector<ullong> morton_codes_; // LBVH中与refs_一一对应的Morton码
+    std::vector<uint> indices_;   // 按叶节点顺序排列的图元索引
+    std::vector<BVHBuildNode> nodes_;
+    size_t primitive_count_ = 0;
+
+public:
+    BVHBuilder(const std::vector<AABB>& bboxes, const BVHBuilderOption& option)
+        : BVHBuilder(bboxes, option, nullptr) {}
+
+    // 由图元构建，SBVH需要图元的几何信息裁剪引用
+    BVHBuilder(const std::vector<shared_ptr<Hittable>>& objects, const BVHBuilderOption& option)
+        : BVHBuilder(collect_bboxes(objects), option, &objects) {}
+
+    BVHBuilder(const BVHBuilder&) = delete;
+    BVHBuilder& operator=(const BVHBuilder&) = delete;
+
+    BVHBuilder(BVHBuilder&&) = delete;
+    BVHBuilder& operator=(BVHBuilder&&) = delete;
+
+public:
+    const std::vector<BVHBuildNode>& get_nodes()
+        const
+    {
+        return nodes_;
+    }
+
+    const std::vector<uint>& get_indices()
+        const
+    {
+        return indices_;
+    }
+
+    // 参见 PBRT 4.3.2
+    // 整棵树的SAH代价：内部节点计遍历代价，叶节点计图元数，均以相对根节点的表面积加权
+    double sah_cost()
+        const
+    {
+        if (nodes_.empty() || nodes_[0].bbox.surface_area() <= 0)
+            return 0.;
+
+        double cost = 0.;
+        for (const BVHBuildNode& node : nodes_)
+            cost += node.bbox.surface_area() * (node.count > 0 ? node.count : option_.traversal_cost);
+        return cost / nodes_[0].bbox.surface_area();
+    }
+
+    // 输出树的质量统计：SAH代价、叶节点深度与图元数分布、兄弟节点重叠、节点内存
+    // layout为节点布局名称，memory_bytes为该布局节点和叶节点数据占用的字节数
+    void report_quality(const std::string& layout, size_t memory_bytes)
+        const
+    {
+        if (nodes_.empty())
+            return;
+
+        static const int kDepthBucket = 4;   // 深度分布每组的层数
+        static const int kMaxLeafBucket = 8; // 图元数不少于此值的叶节点合为一组
+
+        std::vector<int> depths(nodes_.size(), 0);
+        std::vector<uint> depth_histogram;
+        std::array<uint, kMaxLeafBucket + 1> leaf_histogram = {};
+        uint leaf_count = 0;
+        int max_depth = 0;
+        double overlap_sum = 0.;   // 各内部节点的子节点重叠面积与自身表面积之比之和
+        double overlap_area = 0.;  // 子节点重叠面积之和
+        double root_area = nodes_[0].bbox.surface_area();
+
+        for (size_t i = 0; i < nodes_.size(); ++i)
+        {
+            const BVHBuildNode& node = nodes_[i];
+            if (node.count > 0)
+            {
+                ++leaf_count;
+                max_depth = std::max(max_depth, depths[i]);
+                size_t bucket = depths[i] / kDepthBucket;
+                if (depth_histogram.size() <= bucket)
+                    depth_histogram.resize(bucket + 1, 0);
+                ++depth_histogram[bucket];
+                ++leaf_histogram[std::min<uint>(node.count, kMaxLeafBucket)];
+                continue;
+            }
+
+            depths[i + 1] = depths[node.offset] = depths[i] + 1;
+            double area = nodes_[i + 1].bbox.intersect(nodes_[node.offset].bbox).surface_area();
+            overlap_area += area;
+            if (node.bbox.surface_area() > 0)
+                overlap_sum += area / node.bbox.surface_area();
+        }
+
+        uint interior_count = static_cast<uint>(nodes_.size()) - leaf_count;
+        std::ostringstream depth_info, leaf_info;
+        for (size_t b = 0; b < depth_histogram.size(); ++b)
+        {
+            if (depth_histogram[b] > 0)
+                depth_info << " [" << b * kDepthBucket << "," << (b + 1) * kDepthBucket - 1 << "]:" << depth_histogram[b];
+        }
+        for (int s = 1; s <= kMaxLeafBucket; ++s)
+            leaf_info << " " << s << (s == kMaxLeafBucket ? "+:" : ":") << leaf_histogram[s];
+
+        double primitive_count = static_cast<double>(std::max<size_t>(primitive_count_, 1));
+        add_info(layout + " quality: SAH cost " + STR(sah_cost())
+            + ", " + format_num(nodes_.size()) + " nodes, " + format_num(leaf_count) + " leaves, "
+            + STR(indices_.size() / primitive_count) + " references per primitive");
+        add_info("  leaf depth (max " + STR(max_depth) + "):" + depth_info.str());
+        add_info("  leaf size:" + leaf_info.str());
+        add_info("  child overlap: average " + STR(interior_count > 0 ? overlap_sum / interior_count : 0.)
+            + " of parent area, total " + STR(root_area > 0 ? overlap_area / root_area : 0.) + " of root area");
+        add_info("  memory: " + format_num(memory_bytes) + " bytes, " + STR(memory_bytes / primitive_count) + " bytes per primitive");
+    }
+
+private:
+    BVHBuilder(const std::vector<AABB>& bboxes, const BVHBuilderOption& option, const std::vector<shared_ptr<Hittable>>* objects)
+        : option_(option), objects_(objects), primitive_count_(bboxes.size())
+    {
+        option_.bin_count = std::clamp(option_.bin_count, 2, kMaxBinCount);
+        option_.max_leaf_size = std::max(1, option_.max_leaf_size);
+
+        bool use_cache = option_.disk_cache && option_.mesh_hash != 0;
+        if (use_cache && load_bvh_cache(cache_key(), bboxes.size(), nodes_, indices_))
+        {
+            add_info("BVH loaded from cache.");
+            return;
+        }
+
+        refs_.resize(bboxes.size());
+        int size = static_cast<int>(bboxes.size());
+#pragma omp parallel for
+        for (int i = 0; i < size; ++i)
+        {
+            refs_[i].bbox = bboxes[i];
+            refs_[i].centroid = bboxes[i].centroid();
+            refs_[i].index = static_cast<uint>(i);
+        }
+
+        // 二叉树节点数不超过2n-1
+        nodes_.reserve(bboxes.empty() ? 0 : 2 * bboxes.size() - 1);
+        if (!bboxes.empty())
+        {
+            if (option_.build_flag & BVHBuildFlags_LBVH)
+                build_lbvh();
+            else if ((option_.build_flag & BVHBuildFlags_SAH) && option_.spatial_splits && objects_ != nullptr)
+                build_spatial();
+            else
+                build_recursive(0, static_cast<uint>(bboxes.size()), 0, nodes_);
+        }
+
+        // SBVH中引用可能被复制，数量多于图元数
+        size = static_cast<int>(refs_.size());
+        indices_.resize(refs_.size());
+#pragma omp parallel for
+        for (int i = 0; i < size; ++i)
+            indices_[i] = refs_[i].index;
+
+        if (use_cache)
+            save_bvh_cache(cache_key(), bboxes.size(), nodes_, indices_);
+    }
+
+    // 磁盘缓存的键：网格内容哈希与影响构建结果的参数
+    ullong cache_key()
+        const
+    {
+        const double settings[] = {
+            static_cast<double>(option_.build_flag),
+            static_cast<double>(option_.bin_count),
+            option_.traversal_cost,
+            static_cast<double>(option_.max_leaf_size),
+            static_cast<double>(option_.morton_bits),
+            static_cast<double>(option_.treelet_optimization),
+            static_cast<double>(option_.spatial_splits),
+            option_.overlap_budget,
+            option_.duplication_budget };
+        return hash_bytes(settings, sizeof(settings), option_.mesh_hash);
+    }
+
+    static std::vector<AABB> collect_bboxes(const std::vector<shared_ptr<Hittable>>& objects)
+    {
+        std::vector<AABB> bboxes(objects.size());
+        for (size_t i = 0; i < objects.size(); ++i)
+            bboxes[i] = objects[i]->get_bbox();
+        return bboxes;
+    }
+
+    // 节点按深度优先顺序追加到nodes，右子树作为并行任务时先构建到局部数组，再接在左子树之后
+    void build_recursive(uint start, uint end, int depth, std::vector<BVHBuildNode>& nodes)
+    {
+        uint index = static_cast<uint>(nodes.size());
+        nodes.emplace_back();
+
+        AABB bbox, centroid_bbox;
+        compute_bounds(refs_, start, end, bbox, centroid_bbox);
+        nodes[index].bbox = bbox;
+
+        int axis = 0;
+        uint mid;
+        if (depth_limited(depth, end - start))
+            mid = split_limited(refs_, start, end, centroid_bbox, axis);
+        else if (option_.build_flag & BVHBuildFlags_SAH)
+            mid = split_sah(start, end, bbox, centroid_bbox, axis);
+        else
+            mid = split_median(refs_, start, end, centroid_bbox, axis);
+
+        // 建叶节点
+        if (mid == start || mid == end)
+        {
+            nodes[index].offset = start;
+            nodes[index].count = end - start;
+            nodes[index].axis = 0;
+            return;
+        }
+
+        nodes[index].count = 0;
+        nodes[index].axis = axis;
+        build_children(nodes, index, mid - start >= kTaskSize && end - mid >= kTaskSize,
+            [this, start, mid, depth](std::vector<BVHBuildNode>& n) { build_recursive(start, mid, depth + 1, n); },
+            [this, mid, end, depth](std::vector<BVHBuildNode>& n) { build_recursive(mid, end, depth + 1, n); });
+    }
+
+    // 先构建左子树再构建右子树，parallel为true时右子树作为并行任务构建到局部数组，再接在左子树之后
+    // 左右子树的图元区间互不重叠，可同时构建；任务层数已足够占满所有核心时在当前线程构建，结果相同
+    template <typename Left, typename Right>
+    static void build_children(std::vector<BVHBuildNode>& nodes, uint index, bool parallel, Left build_left, Right build_right)
+    {
+        if (!parallel || task_level() >= max_task_level())
+        {
+            build_left(nodes);
+            nodes[index].offset = static_cast<uint>(nodes.size());
+            build_right(nodes);
+            return;
+        }
+
+        int level = task_level() + 1;
+        auto right_task = std::async(std::launch::async, [&build_right, level]()
+            {
+                TaskScope scope(level);
+                std::vector<BVHBuildNode> right_nodes;
+                build_right(right_nodes);
+                return right_nodes;
+            });
+        {
+            TaskScope scope(level);
+            build_left(nodes);
+        }
+        nodes[index].offset = append_nodes(nodes, right_task.get());
+    }
+
+    // 当前线程所在子树任务的层数，0表示只有当前线程在构建
+    // 子树任务之间已经并行，任务内的包围盒、分桶和划分不再开启OpenMP线程组，避免每个任务各开一组线程
+    static int& task_level()
+    {
+        static thread_local int level = 0;
+        return level;
+    }
+
+    // 子树任务最多的层数，2^层数不少于硬件线程数
+    static int max_task_level()
+    {
+        static const int level = ceil_log2(std::max(1u, std::thread::hardware_concurrency()));
+        return level;
+    }
+
+    // 在作用域内设置当前线程的子树任务层数
+    struct TaskScope
+    {
+        int saved;
+
+        explicit TaskScope(int level) : saved(task_level()) { task_level() = level; }
+        ~TaskScope() { task_level() = saved; }
+    };
+
+    // 将局部数组接在nodes之后，右子节点索引随之平移，返回局部数组根节点的索引
+    static uint append_nodes(std::vector<BVHBuildNode>& nodes, const std::vector<BVHBuildNode>& sub_nodes)
+    {
+        uint base = static_cast<uint>(nodes.size());
+        for (BVHBuildNode node : sub_nodes)
+        {
+            if (node.count == 0)
+                node.offset += base;
+            nodes.emplace_back(node);
+        }
+        return base;
+    }
+
+    static int chunk_count(uint start, uint end)
+    {
+        return static_cast<int>((end - start + kChunkSize - 1) / kChunkSize);
+    }
+
+    // 分块并行执行f(chunk, chunk_start, chunk_end)，分块方式只取决于图元数
+    template <typename F>
+    static void parallel_chunks(uint start, uint end, F f)
+    {
+        int chunks = chunk_count(start, end);
+#pragma omp parallel for if(task_level() == 0)
+        for (int c = 0; c < chunks; ++c)
+        {
+            uint chunk_start = start + c * kChunkSize;
+            f(c, chunk_start, std::min(end, chunk_start + kChunkSize));
+        }
+    }
+
+    // 计算图元包围盒和质心包围盒
+    void compute_bounds(const std::vector<Reference>& refs, uint start, uint end, AABB& bbox, AABB& centroid_bbox)
+        const
+    {
+        auto bound = [&](uint s, uint e, AABB& b, AABB& cb)
+            {
+                for (uint i = s; i < e; ++i)
+                {
+                    const Reference& p = refs[i];
+                    b = AABB(b, p.bbox);
+                    cb = AABB(cb, AABB(p.centroid, p.centroid));
+                }
+            };
+
+        if (end - start < kParallelSize)
+        {
+            bound(start, end, bbox, centroid_bbox);
+            return;
+        }
+
+        std::vector<AABB> chunk_bboxes(chunk_count(start, end)), chunk_centroid_bboxes(chunk_count(start, end));
+        parallel_chunks(start, end, [&](int c, uint s, uint e) { bound(s, e, chunk_bboxes[c], chunk_centroid_bboxes[c]); });
+        for (size_t c = 0; c < chunk_bboxes.size(); ++c)
+        {
+            bbox = AABB(bbox, chunk_bboxes[c]);
+            centroid_bbox = AABB(centroid_bbox, chunk_centroid_bboxes[c]);
+        }
+    }
+
+    // 深度为depth、含count个图元的节点划分后，子树按中位数划分也可能超过max_depth时返回true
+    // 中位数划分的子树深度不超过ceil(log2(count))，只在此时改用中位数划分即可保证叶节点深度不超过max_depth
+    static bool depth_limited(int depth, uint count, int max_depth = kMaxDepth)
+    {
+        return depth + 1 + ceil_log2(count) > max_depth;
+    }
+
+    static int ceil_log2(uint n)
+    {
+        int log = 0;
+        while (log < 32 && (1ull << log) < n)
+            ++log;
+        return log;
+    }
+
+    // 深度受限时图元数不超过叶节点上限则建叶节点，否则中位数划分
+    uint split_limited(std::vector<Reference>& refs, uint start, uint end, const AABB& centroid_bbox, int& axis)
+        const
+    {
+        if (end - start <= static_cast<uint>(option_.max_leaf_size))
+            return start;
+        return split_median(refs, start, end, centroid_bbox, axis);
+    }
+
+    // 按质心范围最大的轴取中位数划分，只划分到单个图元
+    static uint split_median(std::vector<Reference>& refs, uint start, uint end, const AABB& centroid_bbox, int& axis)
+    {
+        if (end - start == 1)
+            return start;
+
+        axis = centroid_bbox.longest_axis();
+        uint mid = start + (end - start) / 2;
+        std::nth_element(refs.begin() + start, refs.begin() + mid, refs.begin() + end,
+            [&](const Reference& a, const Reference& b)
+            {
+                return a.centroid[axis] < b.centroid[axis];
+            });
+        return mid;
+    }
+
+    // 参见 PBRT 4.3.2
+    // 将图元质心按各轴分桶，在桶边界处估计SAH代价，选代价最小的轴和位置划分
+    // 返回划分位置，返回start表示建叶节点
+    uint split_sah(uint start, uint end, const AABB& bbox, const AABB& centroid_bbox, int& axis)
+    {
+        uint object_span = end - start;
+        if (object_span == 1)
+            return start;
+
+        int bin_count = option_.bin_count;
+        Bins bins;
+        compute_bins(refs_, start, end, centroid_bbox, bins);
+
+        int best_axis = -1;
+        int best_split = 0; // 桶[0, best_split]划入左子树
+        double best_cost = find_best_split(bins, bbox, centroid_bbox, best_axis, best_split);
+
+        // 直接建叶节点的代价为图元数
+        double leaf_cost = static_cast<double>(object_span);
+        if (object_span <= static_cast<uint>(option_.max_leaf_size) && leaf_cost <= best_cost)
+            return start;
+
+        // 所有质心重合时无法分桶，从中间划分
+        if (best_axis == -1)
+        {
+            axis = 0;
+            return start + object_span / 2;
+        }
+
+        axis = best_axis;
+        double min = centroid_bbox.axis(axis).get_min();
+        double scale = bin_count / centroid_bbox.axis(axis).get_size();
+        return partition(refs_, start, end, [&](const Reference& p)
+            {
+                return std::min(static_cast<int>((p.centroid[axis] - min) * scale), bin_count - 1) <= best_split;
+            });
+    }
+
+    // 在各轴桶边界处估计SAH代价，返回最小代价，best_axis为-1表示没有可划分的轴
+    double find_best_split(const Bins& bins, const AABB& bbox, const AABB& centroid_bbox, int& best_axis, int& best_split)
+        const
+    {
+        int bin_count = option_.bin_count;
+        double right_area[kMaxBinCount];
+        uint right_count[kMaxBinCount];
+
+        double best_cost = kInfinitDouble;
+        double inv_area = 1. / bbox.surface_area();
+
+        for (int a = 0; a < 3; ++a)
+        {
+            if (centroid_bbox.axis(a).get_size() <= 0)
+                continue;
+
+            // 从右向左累计，再从左向右扫描
+            AABB acc_bbox;
+            uint acc_count = 0;
+            for (int b = bin_count - 1; b > 0; --b)
+            {
+                acc_bbox = AABB(acc_bbox, bins[a][b].bbox);
+                acc_count += bins[a][b].count;
+                right_area[b] = acc_bbox.surface_area();
+                right_count[b] = acc_count;
+            }
+
+            acc_bbox = AABB();
+            acc_count = 0;
+            for (int b = 0; b < bin_count - 1; ++b)
+            {
+                acc_bbox = AABB(acc_bbox, bins[a][b].bbox);
+                acc_count += bins[a][b].count;
+                if (acc_count == 0 || right_count[b + 1] == 0)
+                    continue;
+
+                double cost = option_.traversal_cost
+                    + (acc_count * acc_bbox.surface_area() + right_count[b + 1] * right_area[b + 1]) * inv_area;
+                if (cost < best_cost)
+                {
+                    best_cost = cost;
+                    best_axis = a;
+                    best_split = b;
+                }
+            }
+        }
+
+        return best_cost;
+    }
+
+    // 三个轴同时分桶，并行时各块分别分桶后按块顺序合并
+    void compute_bins(const std::vector<Reference>& refs, uint start, uint end, const AABB& centroid_bbox, Bins& bins)
+        const
+    {
+        int bin_count = option_.bin_count;
+        double min[3], scale[3];
+        for (int a = 0; a < 3; ++a)
+        {
+            min[a] = centroid_bbox.axis(a).get_min();
+            double size = centroid_bbox.axis(a).get_size();
+            scale[a] = size > 0 ? bin_count / size : 0.;
+        }
+
+        auto bin = [&](uint s, uint e, Bins& b)
+            {
+                for (uint i = s; i < e; ++i)
+                {
+                    const Reference& p = refs[i];
+                    for (int a = 0; a < 3; ++a)
+                    {
+                        Bin& target = b[a][std::min(static_cast<int>((p.centroid[a] - min[a]) * scale[a]), bin_count - 1)];
+                        ++target.count;
+                        target.bbox = AABB(target.bbox, p.bbox);
+                    }
+                }
+            };
+
+        if (end - start < kParallelSize)
+        {
+            bin(start, end, bins);
+            return;
+        }
+
+        std::vector<Bins> chunk_bins(chunk_count(start, end));
+        parallel_chunks(start, end, [&](int c, uint s, uint e) { bin(s, e, chunk_bins[c]); });
+        for (const Bins& b : chunk_bins)
+        {
+            for (int a = 0; a < 3; ++a)
+            {
+                for (int i = 0; i < bin_count; ++i)
+                {
+                    bins[a][i].count += b[a][i].count;
+                    bins[a][i].bbox = AABB(bins[a][i].bbox, b[a][i].bbox);
+                }
+            }
+        }
+    }
+
+    // 划分图元引用，返回右半部分起点
+    // 并行时各块先统计左半部分数量，再按块顺序稳定地分散到临时数组
+    template <typename Pred>
+    static uint partition(std::vector<Reference>& refs, uint start, uint end, Pred pred)
+    {
+        if (end - start < kParallelSize)
+        {
+            auto it = std::partition(refs.begin() + start, refs.begin() + end, pred);
+            return static_cast<uint>(it - refs.begin());
+        }
+
+        int chunks = chunk_count(start, end);
+        std::vector<uint> left_counts(chunks, 0);
+        parallel_chunks(start, end, [&](int c, uint s, uint e)
+            {
+                for (uint i = s; i < e; ++i)
+                    left_counts[c] += pred(refs[i]) ? 1 : 0;
+            });
+
+        // 各块左右两部分在临时数组中的起点
+        std::vector<uint> left_offsets(chunks), right_offsets(chunks);
+        uint left_total = 0;
+        for (int c = 0; c < chunks; ++c)
+        {
+            left_offsets[c] = left_total;
+            left_total += left_counts[c];
+        }
+        for (int c = 0; c < chunks; ++c)
+            right_offsets[c] = left_total + c * kChunkSize - left_offsets[c];
+
+        std::vector<Reference> temp(end - start);
+        parallel_chunks(start, end, [&](int c, uint s, uint e)
+            {
+                uint l = left_offsets[c], r = right_offsets[c];
+                for (uint i = s; i < e; ++i)
+                    temp[pred(refs[i]) ? l++ : r++] = refs[i];
+            });
+        parallel_chunks(start, end, [&](int, uint s, uint e)
+            {
+                std::copy(temp.begin() + (s - start), temp.begin() + (e - start), refs.begin() + s);
+            });
+
+        return start + left_total;
+    }
+
+    // 构建SBVH，每个节点在物体划分、空间划分与建叶节点中选代价最小者
+    void build_spatial()
+    {
+        uint size = static_cast<uint>(refs_.size());
+        AABB bbox, centroid_bbox;
+        compute_bounds(refs_, 0, size, bbox, centroid_bbox);
+
+        std::vector<Reference> refs;
+        refs.swap(refs_);
+        uint budget = static_cast<uint>(std::max(0., option_.duplication_budget) * size);
+        build_sbvh(std::move(refs), budget, bbox.surface_area(), 0, nodes_, refs_);
+        add_info("SBVH SAH cost: "_str + STR(sah_cost()) + ", references: " + format_num(size) + " -> " + format_num(refs_.size()));
+    }
+
+    // 参见 Stich et al. 2009, Spatial Splits in Bounding Volume Hierarchies
+    // 每个节点单独持有图元引用，空间划分时跨越划分平面的引用被裁剪为左右两个
+    // 叶节点引用按深度优先顺序追加到leaf_refs；budget为子树还可复制的引用数，返回未用完的数量
+    // 顺序构建时左子树剩余的额度留给右子树，并行构建时按引用数比例分配，结果与线程数无关
+    uint build_sbvh(std::vector<Reference> refs, uint budget, double root_area, int depth,
+        std::vector<BVHBuildNode>& nodes, std::vector<Reference>& leaf_refs)
+    {
+        uint index = static_cast<uint>(nodes.size());
+        nodes.emplace_back();
+        uint size = static_cast<uint>(refs.size());
+
+        AABB bbox, centroid_bbox;
+        compute_bounds(refs, 0, size, bbox, centroid_bbox);
+        nodes[index].bbox = bbox;
+
+        int bin_count = option_.bin_count;
+        Bins bins;
+        compute_bins(refs, 0, size, centroid_bbox, bins);
+
+        int object_axis = -1;
+        int object_split = 0;
+        double object_cost = find_best_split(bins, bbox, centroid_bbox, object_axis, object_split);
+
+        // 物体划分的左右子节点重叠较多时才尝试空间划分，深度受限时只做中位数划分
+        bool limited = depth_limited(depth, size);
+        int spatial_axis = -1;
+        double spatial_pos = 0.;
+        double spatial_cost = kInfinitDouble;
+        if (!limited && size > 1 && budget > 0 && depth < kMaxSpatialDepth)
+        {
+            double overlap = 0.;
+            if (object_axis != -1)
+            {
+                AABB left, right;
+                for (int b = 0; b < bin_count; ++b)
+                {
+                    AABB& side = (b <= object_split) ? left : right;
+                    side = AABB(side, bins[object_axis][b].bbox);
+                }
+                overlap = left.intersect(right).surface_area();
+            }
+
+            if (object_axis == -1 || overlap > option_.overlap_budget * root_area)
+                spatial_cost = find_spatial_split(refs, bbox, spatial_axis, spatial_pos);
+        }
+
+        // 建叶节点
+        double leaf_cost = static_cast<double>(size);
+        if (size == 1 || (size <= static_cast<uint>(option_.max_leaf_size) && (limited || leaf_cost <= std::min(object_cost, spatial_cost))))
+        {
+            nodes[index].offset = static_cast<uint>(leaf_refs.size());
+            nodes[index].count = size;
+            nodes[index].axis = 0;
+            leaf_refs.insert(leaf_refs.end(), refs.begin(), refs.end());
+            return budget;
+        }
+
+        std::vector<Reference> left_refs, right_refs;
+        int axis = 0;
+        if (spatial_axis != -1 && spatial_cost < object_cost)
+        {
+            // 桶内估计的代价与裁剪、取消裁剪后的实际划分不同，按实际左右包围盒重新计算代价后再与物体划分比较
+            split_references(refs, spatial_axis, spatial_pos, left_refs, right_refs);
+            uint duplicated = static_cast<uint>(left_refs.size() + right_refs.size()) - size;
+            if (left_refs.empty() || right_refs.empty() || duplicated > budget
+                || split_cost(left_refs, right_refs, bbox) >= object_cost)
+            {
+                left_refs.clear();
+                right_refs.clear();
+            }
+            else
+            {
+                axis = spatial_axis;
+                budget -= duplicated;
+            }
+        }
+
+        // 物体划分，所有质心重合时从中间划分
+        if (left_refs.empty())
+        {
+            uint mid = size / 2;
+            if (limited)
+            {
+                mid = split_median(refs, 0, size, centroid_bbox, axis);
+            }
+            else if (object_axis != -1)
+            {
+                axis = object_axis;
+                double min = centroid_bbox.axis(axis).get_min();
+                double scale = bin_count / centroid_bbox.axis(axis).get_size();
+                mid = partition(refs, 0, size, [&](const Reference& p)
+                    {
+                        return std::min(static_cast<int>((p.centroid[axis] - min) * scale), bin_count - 1) <= object_split;
+                    });
+            }
+            left_refs.assign(refs.begin(), refs.begin() + mid);
+            right_refs.assign(refs.begin() + mid, refs.end());
+        }
+        std::vector<Reference>().swap(refs);
+
+        uint left_size = static_cast<uint>(left_refs.size());
+        uint right_size = static_cast<uint>(right_refs.size());
+
+        nodes[index].count = 0;
+        nodes[index].axis = axis;
+
+        if (left_size < kTaskSize || right_size < kTaskSize)
+        {
+            budget = build_sbvh(std::move(left_refs), budget, root_area, depth + 1, nodes, leaf_refs);
+            nodes[index].offset = static_cast<uint>(nodes.size());
+            return build_sbvh(std::move(right_refs), budget, root_area, depth + 1, nodes, leaf_refs);
+        }
+
+        uint left_budget = static_cast<uint>(static_cast<ullong>(budget) * left_size / (left_size + right_size));
+        uint right_budget = budget - left_budget;
+
+        // 右子树的节点和叶节点引用都构建到局部数组，再接在左子树之后
+        // 任务层数已足够时在当前线程依次构建，额度仍按比例分配
+        std::vector<BVHBuildNode> right_nodes;
+        std::vector<Reference> right_leaf_refs;
+        if (task_level() >= max_task_level())
+        {
+            left_budget = build_sbvh(std::move(left_refs), left_budget, root_area, depth + 1, nodes, leaf_refs);
+            right_budget = build_sbvh(std::move(right_refs), right_budget, root_area, depth + 1, right_nodes, right_leaf_refs);
+        }
+        else
+        {
+            int level = task_level() + 1;
+            auto right_task = std::async(std::launch::async, [&, right_budget, level]()
+                {
+                    TaskScope scope(level);
+                    return build_sbvh(std::move(right_refs), right_budget, root_area, depth + 1, right_nodes, right_leaf_refs);
+                });
+            {
+                TaskScope scope(level);
+                left_budget = build_sbvh(std::move(left_refs), left_budget, root_area, depth + 1, nodes, leaf_refs);
+            }
+            right_budget = right_task.get();
+        }
+
+        uint leaf_base = static_cast<uint>(leaf_refs.size());
+        for (BVHBuildNode& node : right_nodes)
+        {
+            if (node.count > 0)
+                node.offset += leaf_base;
+        }
+        leaf_refs.insert(leaf_refs.end(), right_leaf_refs.begin(), right_leaf_refs.end());
+        nodes[index].offset = append_nodes(nodes, right_nodes);
+        return left_budget + right_budget;
+    }
+
+    // 按节点包围盒将各轴等分为桶，跨越多个桶的引用在每个桶内裁剪后计入该桶包围盒
+    // 在桶边界处估计SAH代价，返回最小代价，best_axis为-1表示没有可划分的轴
+    double find_spatial_split(const std::vector<Reference>& refs, const AABB& bbox, int& best_axis, double& best_pos)
+        const
+    {
+        int bin_count = option_.bin_count;
+        uint size = static_cast<uint>(refs.size());
+
+        auto bin = [&](uint s, uint e, SpatialBins& b)
+            {
+                for (int a = 0; a < 3; ++a)
+                {
+                    double min = bbox.axis(a).get_min();
+                    double extent = bbox.axis(a).get_size();
+                    if (extent <= 0)
+                        continue;
+
+                    double scale = bin_count / extent;
+                    for (uint i = s; i < e; ++i)
+                    {
+                        const Reference& p = refs[i];
+                        int first = std::clamp(static_cast<int>((p.bbox.axis(a).get_min() - min) * scale), 0, bin_count - 1);
+                        int last = std::clamp(static_cast<int>((p.bbox.axis(a).get_max() - min) * scale), first, bin_count - 1);
+
+                        for (int k = first; k <= last; ++k)
+                        {
+                            AABB clipped = (first == last) ? p.bbox
+                                : clip_reference(p, a, min + extent * k / bin_count, min + extent * (k + 1) / bin_count);
+                            b[a][k].bbox = AABB(b[a][k].bbox, clipped);
+                        }
+                        ++b[a][first].enter;
+                        ++b[a][last].exit;
+                    }
+                }
+            };
+
+        SpatialBins bins;
+        if (size < kParallelSize)
+        {
+            bin(0, size, bins);
+        }
+        else
+        {
+            std::vector<SpatialBins> chunk_bins(chunk_count(0, size));
+            parallel_chunks(0, size, [&](int c, uint s, uint e) { bin(s, e, chunk_bins[c]); });
+            for (const SpatialBins& b : chunk_bins)
+            {
+                for (int a = 0; a < 3; ++a)
+                {
+                    for (int k = 0; k < bin_count; ++k)
+                    {
+                        bins[a][k].enter += b[a][k].enter;
+                        bins[a][k].exit += b[a][k].exit;
+                        bins[a][k].bbox = AABB(bins[a][k].bbox, b[a][k].bbox);
+                    }
+                }
+            }
+        }
+
+        double right_area[kMaxBinCount];
+        uint right_count[kMaxBinCount];
+        double best_cost = kInfinitDouble;
+        double inv_area = 1. / bbox.surface_area();
+
+        for (int a = 0; a < 3; ++a)
+        {
+            if (bbox.axis(a).get_size() <= 0)
+                continue;
+
+            // 右侧为离开桶在划分平面之后的引用，左侧为进入桶在划分平面之前的引用
+            AABB acc_bbox;
+            uint acc_count = 0;
+            for (int b = bin_count - 1; b > 0; --b)
+            {
+                acc_bbox = AABB(acc_bbox, bins[a][b].bbox);
+                acc_count += bins[a][b].exit;
+                right_area[b] = acc_bbox.surface_area();
+                right_count[b] = acc_count;
+            }
+
+            acc_bbox = AABB();
+            acc_count = 0;
+            for (int b = 0; b < bin_count - 1; ++b)
+            {
+                acc_bbox = AABB(acc_bbox, bins[a][b].bbox);
+                acc_count += bins[a][b].enter;
+                if (acc_count == 0 || right_count[b + 1] == 0)
+                    continue;
+
+                double cost = option_.traversal_cost
+                    + (acc_count * acc_bbox.surface_area() + right_count[b + 1] * right_area[b + 1]) * inv_area;
+                if (cost < best_cost)
+                {
+                    best_cost = cost;
+                    best_axis = a;
+                    best_pos = bbox.axis(a).get_min() + bbox.axis(a).get_size() * (b + 1) / bin_count;
+                }
+            }
+        }
+
+        return best_cost;
+    }
+
+    // 按axis轴上的平面pos划分引用，跨越平面的引用裁剪为两个
+    // 参见 Stich et al. 2009 4.4，整个放入一侧代价更低的引用不裁剪，左右包围盒取裁剪后的结果近似
+    void split_references(const std::vector<Reference>& refs, int axis, double pos,
+        std::vector<Reference>& left_refs, std::vector<Reference>& right_refs)
+        const
+    {
+        struct Straddle
+        {
+            uint ref;
+            AABB left, right;
+        };
+        std::vector<Straddle> straddles;
+        AABB left_bbox, right_bbox;
+        for (uint i = 0; i < refs.size(); ++i)
+        {
+            const Reference& p = refs[i];
+            const Interval& extent = p.bbox.axis(axis);
+            if (extent.get_max() <= pos)
+            {
+                left_refs.emplace_back(p);
+                left_bbox = AABB(left_bbox, p.bbox);
+            }
+            else if (extent.get_min() >= pos)
+            {
+                right_refs.emplace_back(p);
+                right_bbox = AABB(right_bbox, p.bbox);
+            }
+            else
+            {
+                AABB left = clip_reference(p, axis, extent.get_min(), pos);
+                AABB right = clip_reference(p, axis, pos, extent.get_max());
+                if (!left.is_empty() && !right.is_empty())
+                {
+                    straddles.push_back({ i, left, right });
+                    left_bbox = AABB(left_bbox, left);
+                    right_bbox = AABB(right_bbox, right);
+                }
+                else if (!right.is_empty())
+                {
+                    right_refs.push_back({ right, right.centroid(), p.index });
+                    right_bbox = AABB(right_bbox, right);
+                }
+                else if (!left.is_empty())
+                {
+                    left_refs.push_back({ left, left.centroid(), p.index });
+                    left_bbox = AABB(left_bbox, left);
+                }
+                else
+                {
+                    left_refs.emplace_back(p);
+                    left_bbox = AABB(left_bbox, p.bbox);
+                }
+            }
+        }
+
+        double left_count = static_cast<double>(left_refs.size() + straddles.size());
+        double right_count = static_cast<double>(right_refs.size() + straddles.size());
+        double left_area = left_bbox.surface_area();
+        double right_area = right_bbox.surface_area();
+        for (const Straddle& e : straddles)
+        {
+            const Reference& p = refs[e.ref];
+            double split = left_area * left_count + right_area * right_count;
+            double to_left = AABB(left_bbox, p.bbox).surface_area() * left_count + right_area * (right_count - 1);
+            double to_right = left_area * (left_count - 1) + AABB(right_bbox, p.bbox).surface_area() * right_count;
+            if (to_left < split && to_left <= to_right)
+            {
+                left_refs.emplace_back(p);
+            }
+            else if (to_right < split)
+            {
+                right_refs.emplace_back(p);
+            }
+            else
+            {
+                left_refs.push_back({ e.left, e.left.centroid(), p.index });
+                right_refs.push_back({ e.right, e.right.centroid(), p.index });
+            }
+        }
+    }
+
+    // 按左右引用的实际包围盒计算划分的SAH代价
+    double split_cost(const std::vector<Reference>& left_refs, const std::vector<Reference>& right_refs, const AABB& bbox)
+        const
+    {
+        AABB left, right, centroid_bbox;
+        compute_bounds(left_refs, 0, static_cast<uint>(left_refs.size()), left, centroid_bbox);
+        compute_bounds(right_refs, 0, static_cast<uint>(right_refs.size()), right, centroid_bbox);
+        return option_.traversal_cost
+            + (left_refs.size() * left.surface_area() + right_refs.size() * right.surface_area()) / bbox.surface_area();
+    }
+
+    // 图元在引用包围盒中axis轴[min, max]部分的包围盒
+    AABB clip_reference(const Reference& p, int axis, double min, double max)
+        const
+    {
+        Interval clip_range(std::max<double>(min, p.bbox.axis(axis).get_min()), std::min<double>(max, p.bbox.axis(axis).get_max()));
+        AABB region(
+            axis == 0 ? clip_range : p.bbox.axis(0),
+            axis == 1 ? clip_range : p.bbox.axis(1),
+            axis == 2 ? clip_range : p.bbox.axis(2));
+        return (*objects_)[p.index]->clip_bbox(region);
+    }
+
+    // 参见 PBRT(3rd) 4.3.3
+    // 质心按Morton码基数排序后，自高位向低位在码值变化处划分，每个节点只需一次二分查找
+    void build_lbvh()
+    {
+        uint size = static_cast<uint>(refs_.size());
+        AABB bbox, centroid_bbox;
+        compute_bounds(refs_, 0, size, bbox, centroid_bbox);
+
+        int bits = (option_.morton_bits == 63) ? 63 : 30;
+        std::vector<MortonPrimitive> prims(size);
+#pragma omp parallel for
+        for (int i = 0; i < static_cast<int>(size); ++i)
+        {
+            prims[i].code = encode_morton3(centroid_bbox.offset(refs_[i].centroid), bits);
+            prims[i].index = i;
+        }
+        radix_sort(prims, bits);
+
+        std::vector<Reference> sorted_refs(size);
+        morton_codes_.resize(size);
+#pragma omp parallel for
+        for (int i = 0; i < static_cast<int>(size); ++i)
+        {
+            sorted_refs[i] = refs_[prims[i].index];
+            morton_codes_[i] = prims[i].code;
+        }
+        refs_.swap(sorted_refs);
+
+        if (!option_.treelet_optimization)
+        {
+            emit_lbvh(0, size, bits - 1, 0, nodes_);
+            return;
+        }
+
+        // 参见 PBRT(3rd) 4.3.3 HLBVH
+        // 高kTreeletBits位相同的图元为一组，组内用LBVH构建，顶层再用SAH改善树的质量
+        std::vector<Treelet> treelets;
+        ullong mask = ((1ull << kTreeletBits) - 1) << (bits - kTreeletBits);
+        for (uint start = 0, end = 0; start < size; start = end)
+        {
+            for (end = start + 1; end < size && (morton_codes_[start] & mask) == (morton_codes_[end] & mask); ++end) {}
+            treelets.push_back({ start, end, AABB(), Point3(), {} });
+        }
+
+        // 各组已由OpenMP线程并行构建，组内不再开启子树任务
+#pragma omp parallel for schedule(dynamic)
+        for (int i = 0; i < static_cast<int>(treelets.size()); ++i)
+        {
+            TaskScope scope(max_task_level());
+            Treelet& t = treelets[i];
+            emit_lbvh(t.start, t.end, bits - 1 - kTreeletBits, kTreeletBits, t.nodes);
+            t.bbox = t.nodes[0].bbox;
+            t.centroid = t.bbox.centroid();
+        }
+
+        // 组数不超过2^kTreeletBits，组内子树按深度kTreeletBits起算，顶层叶节点深度不超过max_depth即可
+        int treelet_depth = 0;
+        for (const Treelet& t : treelets)
+            treelet_depth = std::max(treelet_depth, tree_depth(t.nodes));
+
+        std::vector<uint> order(treelets.size());
+        for (uint i = 0; i < order.size(); ++i)
+            order[i] = i;
+        build_upper(treelets, order, 0, static_cast<uint>(order.size()), 0, kMaxDepth - treelet_depth, nodes_);
+    }
+
+    // 按morton_codes_在[start, end)上生成子树，bit为当前比较的最高位
+    void emit_lbvh(uint start, uint end, int bit, int depth, std::vector<BVHBuildNode>& nodes)
+    {
+        uint index = static_cast<uint>(nodes.size());
+        nodes.emplace_back();
+
+        // 码值已排序，第bit位为1的图元在后，二分查找划分位置；深度受限时从中间划分
+        uint mid = start;
+        if (end - start > static_cast<uint>(option_.max_leaf_size) && depth_limited(depth, end - start))
+        {
+            mid = start + (end - start) / 2;
+        }
+        else if (end - start > static_cast<uint>(option_.max_leaf_size))
+        {
+            for (; bit >= 0; --bit)
+            {
+                ullong mask = 1ull << bit;
+                if ((morton_codes_[start] & mask) == (morton_codes_[end - 1] & mask))
+                    continue;
+
+                auto it = std::partition_point(morton_codes_.begin() + start, morton_codes_.begin() + end,
+                    [mask](ullong code) { return (code & mask) == 0; });
+                mid = static_cast<uint>(it - morton_codes_.begin());
+                break;
+            }
+
+            // 码值全部相同时从中间划分
+            if (bit < 0)
+                mid = start + (end - start) / 2;
+        }
+
+        // 建叶节点
+        if (mid == start)
+        {
+            AABB bbox;
+            for (uint i = start; i < end; ++i)
+                bbox = AABB(bbox, refs_[i].bbox);
+            nodes[index] = { bbox, start, end - start, 0 };
+            return;
+        }
+
+        int next_bit = std::max(bit - 1, -1);
+        nodes[index].count = 0;
+        nodes[index].axis = (bit >= 0) ? morton_axis(bit) : 0;
+        build_children(nodes, index, mid - start >= kTaskSize && end - mid >= kTaskSize,
+            [this, start, mid, next_bit, depth](std::vector<BVHBuildNode>& n) { emit_lbvh(start, mid, next_bit, depth + 1, n); },
+            [this, mid, end, next_bit, depth](std::vector<BVHBuildNode>& n) { emit_lbvh(mid, end, next_bit, depth + 1, n); });
+
+        // 自底向上合并子节点包围盒
+        nodes[index].bbox = AABB(nodes[index + 1].bbox, nodes[nodes[index].offset].bbox);
+    }
+
+    // 在各组子树之上用SAH构建顶层，order为组的索引，原地划分
+    // 顶层叶节点即各组子树的根，深度不超过max_depth
+    void build_upper(std::vector<Treelet>& treelets, std::vector<uint>& order, uint start, uint end, int depth, int max_depth,
+        std::vector<BVHBuildNode>& nodes)
+    {
+        if (end - start == 1)
+        {
+            append_nodes(nodes, treelets[order[start]].nodes);
+            return;
+        }
+
+        uint index = static_cast<uint>(nodes.size());
+        nodes.emplace_back();
+
+        AABB bbox, centroid_bbox;
+        for (uint i = start; i < end; ++i)
+        {
+            const Treelet& t = treelets[order[i]];
+            bbox = AABB(bbox, t.bbox);
+            centroid_bbox = AABB(centroid_bbox, AABB(t.centroid, t.centroid));
+        }
+
+        // 以组内图元数为权重分桶
+        int bin_count = option_.bin_count;
+        Bins bins;
+        for (int a = 0; a < 3; ++a)
+        {
+            double min = centroid_bbox.axis(a).get_min();
+            double size = centroid_bbox.axis(a).get_size();
+            double scale = size > 0 ? bin_count / size : 0.;
+            for (uint i = start; i < end; ++i)
+            {
+                const Treelet& t = treelets[order[i]];
+                Bin& target = bins[a][std::min(static_cast<int>((t.centroid[a] - min) * scale), bin_count - 1)];
+                target.count += t.end - t.start;
+                target.bbox = AABB(target.bbox, t.bbox);
+            }
+        }
+
+        int best_axis = -1;
+        int best_split = 0;
+        find_best_split(bins, bbox, centroid_bbox, best_axis, best_split);
+
+        uint mid = start + (end - start) / 2;
+        if (depth_limited(depth, end - start, max_depth))
+        {
+            best_axis = centroid_bbox.longest_axis();
+            std::nth_element(order.begin() + start, order.begin() + mid, order.begin() + end, [&](uint a, uint b)
+                {
+                    return treelets[a].centroid[best_axis] < treelets[b].centroid[best_axis];
+                });
+        }
+        else if (best_axis != -1)
+        {
+            double min = centroid_bbox.axis(best_axis).get_min();
+            double scale = bin_count / centroid_bbox.axis(best_axis).get_size();
+            auto it = std::partition(order.begin() + start, order.begin() + end, [&](uint i)
+                {
+                    return std::min(static_cast<int>((treelets[i].centroid[best_axis] - min) * scale), bin_count - 1) <= best_split;
+                });
+            mid = static_cast<uint>(it - order.begin());
+        }
+
+        nodes[index] = { bbox, 0, 0, std::max(best_axis, 0) };
+        build_upper(treelets, order, start, mid, depth + 1, max_depth, nodes);
+        nodes[index].offset = static_cast<uint>(nodes.size());
+        build_upper(treelets, order, mid, end, depth + 1, max_depth, nodes);
+    }
+
+    // 深度优先顺序的子树中叶节点的最大深度，根节点深度为0
+    static int tree_depth(const std::vector<BVHBuildNode>& nodes)
+    {
+        std::vector<int> depths(nodes.size(), 0);
+        int max_depth = 0;
+        for (size_t i = 0; i < nodes.size(); ++i)
+        {
+            max_depth = std::max(max_depth, depths[i]);
+            if (nodes[i].count == 0)
+                depths[i + 1] = depths[nodes[i].offset] = depths[i] + 1;
+        }
+        return max_depth;
+    }
+};
+
+// refit线性BVH叶节点中的图元
+// SBVH中同一图元可能被多个叶节点引用，此时串行refit，避免多个线程同时写入同一图元
+inline void refit_objects(const std::vector<shared_ptr<Hittable>>& objects, bool duplicated)
+{
+    int size = static_cast<int>(objects.size());
+    if (duplicated)
+    {
+        for (int i = 0; i < size; ++i)
+            objects[i]->refit();
+        return;
+    }
+
+#pragma omp parallel for
+    for (int i = 0; i < size; ++i)
+        objects[i]->refit();
+}
+
+// 去除重复引用，保持首次出现的顺序，用于refit后完全重建
+inline std::vector<shared_ptr<Hittable>> unique_objects(const std::vector<shared_ptr<Hittable>>& objects)
+{
+    std::vector<shared_ptr<Hittable>> unique;
+    std::unordered_set<const Hittable*> seen;
+    for (const auto& object : objects)
+    {
+        if (seen.insert(object.get()).second)
+            unique.emplace_back(object);
+    }
+    return unique;
+}
+
+#endif // !BVH_BUILDER_H
@@ -1,110 +1,262 @@
-/*
- * BVH树节点类
- */
-#ifndef BVH_NODE_H
-#define BVH_NODE_H
-
-#include "hittable_list.h"
-
-class BVHNode : public Hittable
-{
-private:
-    shared_ptr<Hittable> left_, right_;
-    AABB bbox_;
-
-public:
-    BVHNode() = delete;
-
-    BVHNode(const HittableList& list) 
-        : BVHNode(list.get_objects(), 0, list.get_objects().size()) {}
-
-    BVHNode(const std::vector<shared_ptr<Hittable>>& src_objects, size_t start, size_t end)
-    {
-        int axis = random_int(0, 2);
-        auto comparator = (axis == 0) ? box_x_compare
-            : (axis == 1) ? box_y_compare
-            : box_z_compare;
-
-        size_t object_span = end - start;
-
-        if (object_span == 1)
-        {
-            left_ = right_ = src_objects[start];
-        }
-        else if (object_span == 2) 
-        {
-            if (comparator(src_objects[start], src_objects[start + 1]))
-            {
-                left_ = src_objects[start];
-                right_ = src_objects[start + 1];
-            }
-            else
-            {
-                left_ = src_objects[start + 1];
-                right_ = src_objects[start];
-            }
-        }
-        else 
-        {
-            auto objects = src_objects;
-            std::sort(objects.begin() + start, objects.begin() + end, comparator);
-
-            auto mid = start + object_span / 2;
-            left_ = std::make_shared<BVHNode>(objects, start, mid);
-            right_ = std::make_shared<BVHNode>(objects, mid, end);
-        }
-
-        bbox_ = AABB(left_->get_bbox(), right_->get_bbox());
-    }
-
-    BVHNode(const BVHNode&) = delete;
-    BVHNode& operator=(const BVHNode&) = delete;
-
-    BVHNode(BVHNode&&) = delete;
-    BVHNode& operator=(BVHNode&&) = delete;
-
-public:
-    bool hit(const Ray& r, const Interval& interval, HitRecord& rec) 
-        const override
-    {
-        if (!bbox_.hit(r, interval))
-            return false;
-
-        bool hit_left = left_->hit(r, interval, rec);
-        // 若击中左节点，更新击中时光线位置t为光线的最大击中距离，再算击中右节点
-        bool hit_right = right_->hit(r, Interval(interval.get_min(), hit_left ? rec.t : interval.get_max()), rec);
-
-        return hit_left || hit_right;
-    }
-
-    AABB get_bbox() 
-        const override
-    {
-        return bbox_; 
-    }
-
-private:
-    static bool box_compare(const shared_ptr<Hittable> a, const shared_ptr<Hittable> b, 
-        int axis_index)
-    {
-        return a->get_bbox().axis(axis_index).get_min() < b->get_bbox().axis(axis_index).get_min();
-    }
-
-    static bool box_x_compare(const shared_ptr<Hittable> a, const shared_ptr<Hittable> b)
-    {
-        return box_compare(a, b, 0);
-    }
-
-    static bool box_y_compare(const shared_ptr<Hittable> a, const shared_ptr<Hittable> b)
-    {
-        return box_compare(a, b, 1);
-    }
-
-    static bool box_z_compare(const shared_ptr<Hittable> a, const shared_ptr<Hittable> b)
-    {
-        return box_compare(a, b, 2);
-    }
-};
-
-#endif // !BVH_NODE_H
-
+/*
+ * BVH树节点类
+ */
+#ifndef BVH_NODE_H
+#define BVH_NODE_H
+
+#include "bvh_builder.h"
+#include "hittable_list.h"
+
+class BVHNode : public Hittable
+{
+private:
+    static const int kStackSize = BVHBuilder::kMaxDepth + 1; // 树由BVHBuilder构建，深度受限，栈不会溢出
+    static const int kRefitTaskDepth = 3; // refit时此深度以上的右子树作为并行任务
+
+    shared_ptr<Hittable> left_, right_; // 叶节点right_为空
+    uint left_count_ = 0, right_count_ = 0; // 叶子子节点的图元数，内部子节点（BVHNode）为0，遍历时不经过虚函数直接展开
+    AABB bbox_;
+    int axis_ = 0; // 划分轴
+    bool ordered_ = true;
+    bool duplicated_ = false; // SBVH中图元可能被多个叶节点引用
+
+public:
+    BVHNode() = delete;
+
+    BVHNode(const HittableList& list, const BVHBuildOption& option = BVHBuildOption())
+        : ordered_(option.layout.ordered_traversal)
+    {
+        auto objects = list.get_objects();
+        BVHBuilder builder(objects, option.builder);
+        build(builder, objects, 0);
+
+        // 内部节点为BVHNode，多图元叶节点为HittableList
+        if (option.quality_report)
+        {
+            size_t leaf_lists = 0, interior_count = 0;
+            for (const BVHBuildNode& node : builder.get_nodes())
+            {
+                interior_count += node.count == 0;
+                leaf_lists += node.count > 1;
+            }
+            builder.report_quality("BVH", interior_count * sizeof(BVHNode) + leaf_lists * sizeof(HittableList)
+                + builder.get_indices().size() * sizeof(shared_ptr<Hittable>));
+        }
+    }
+
+    // 由构建结果中index处的节点生成子树
+    BVHNode(const BVHBuilder& builder, const std::vector<shared_ptr<Hittable>>& objects, uint index, bool ordered)
+        : ordered_(ordered)
+    {
+        build(builder, objects, index);
+    }
+
+    BVHNode(const BVHNode&) = delete;
+    BVHNode& operator=(const BVHNode&) = delete;
+
+    BVHNode(BVHNode&&) = delete;
+    BVHNode& operator=(BVHNode&&) = delete;
+
+public:
+    // 用栈迭代遍历，只有叶节点的图元经过虚函数求交
+    // 内部节点沿划分轴按光线方向先访问近处子节点，远处子节点压栈，出栈时以当前最近交点裁剪
+    bool hit(const Ray& r, const Interval& interval, HitRecord& rec)
+        const override
+    {
+        struct StackEntry
+        {
+            const Hittable* object;
+            uint count; // 叶子的图元数，0表示BVHNode
+        };
+
+        double closest_so_far = interval.get_max();
+        bool hit_anything = false;
+        DeferredHit deferred;
+        ullong visited = 0, tested = 0;
+
+        StackEntry stack[kStackSize];
+        int top = 0;
+        StackEntry entry = { this, 0 };
+
+        while (true)
+        {
+            if (entry.count == 0)
+            {
+                const BVHNode* node = static_cast<const BVHNode*>(entry.object);
+                ++visited;
+                if (node->bbox_.hit(r, Interval(interval.get_min(), closest_so_far)))
+                {
+                    // 只有根节点可能是叶节点
+                    if (node->right_ == nullptr)
+                    {
+                        entry = { node->left_.get(), node->left_count_ };
+                        continue;
+                    }
+
+                    StackEntry first = { node->left_.get(), node->left_count_ };
+                    StackEntry second = { node->right_.get(), node->right_count_ };
+                    if (ordered_ && r.get_direction()[node->axis_] < 0)
+                        std::swap(first, second);
+
+                    stack[top++] = second;
+                    entry = first;
+                    continue;
+                }
+            }
+            else
+            {
+                tested += entry.count;
+                if (entry.object->intersect(r, Interval(interval.get_min(), closest_so_far), deferred, rec))
+                {
+                    hit_anything = true;
+                    closest_so_far = deferred.t;
+                }
+            }
+
+            if (top == 0)
+                break;
+            entry = stack[--top];
+        }
+
+        record_traversal(visited, tested);
+        if (hit_anything)
+            resolve(r, deferred, rec);
+        return hit_anything;
+    }
+
+    // 找到任意交点即返回，不需要按远近顺序访问子节点
+    bool occluded(const Ray& r, const Interval& interval)
+        const override
+    {
+        const BVHNode* stack[kStackSize];
+        int top = 0;
+        const BVHNode* node = this;
+        ullong visited = 0, tested = 0;
+        bool hit_anything = false;
+
+        while (true)
+        {
+            ++visited;
+            if (node->bbox_.hit(r, interval))
+            {
+                // 叶子子节点直接求交，内部子节点压栈
+                if (node->left_count_ > 0)
+                {
+                    tested += node->left_count_;
+                    hit_anything = node->left_->occluded(r, interval);
+                    if (hit_anything)
+                        break;
+                }
+                if (node->right_count_ > 0)
+                {
+                    tested += node->right_count_;
+                    hit_anything = node->right_->occluded(r, interval);
+                    if (hit_anything)
+                        break;
+                }
+
+                if (node->right_ != nullptr && node->right_count_ == 0)
+                    stack[top++] = static_cast<const BVHNode*>(node->right_.get());
+                if (node->left_count_ == 0)
+                {
+                    node = static_cast<const BVHNode*>(node->left_.get());
+                    continue;
+                }
+            }
+
+            if (top == 0)
+                break;
+            node = stack[--top];
+        }
+
+        record_traversal(visited, tested);
+        return hit_anything;
+    }
+
+    AABB get_bbox()
+        const override
+    {
+        return bbox_;
+    }
+
+    // 保持树结构，先refit子节点再合并包围盒
+    void refit()
+        override
+    {
+        refit_node(0);
+    }
+
+private:
+    // 图元被多个叶节点引用时并行refit会同时写同一图元，只在无重复引用时将上层右子树作为并行任务
+    void refit_node(int depth)
+    {
+        if (right_ == nullptr)
+        {
+            left_->refit();
+            bbox_ = left_->get_bbox();
+            return;
+        }
+
+        if (!duplicated_ && depth < kRefitTaskDepth)
+        {
+            auto right = std::async(std::launch::async, [this, depth] { refit_child(right_, depth + 1); });
+            refit_child(left_, depth + 1);
+            right.get();
+        }
+        else
+        {
+            refit_child(left_, depth + 1);
+            refit_child(right_, depth + 1);
+        }
+        bbox_ = AABB(left_->get_bbox(), right_->get_bbox());
+    }
+
+    static void refit_child(const shared_ptr<Hittable>& child, int depth)
+    {
+        if (auto node = dynamic_cast<BVHNode*>(child.get()))
+            node->refit_node(depth);
+        else
+            child->refit();
+    }
+
+    void build(const BVHBuilder& builder, const std::vector<shared_ptr<Hittable>>& objects, uint index)
+    {
+        const BVHBuildNode& node = builder.get_nodes()[index];
+        bbox_ = node.bbox;
+        axis_ = node.axis;
+        duplicated_ = builder.get_indices().size() > objects.size();
+
+        // 只有根节点可能是叶节点
+        if (node.count > 0)
+        {
+            left_ = make_child(builder, objects, index, ordered_);
+            left_count_ = node.count;
+            return;
+        }
+
+        left_ = make_child(builder, objects, index + 1, ordered_);
+        right_ = make_child(builder, objects, node.offset, ordered_);
+        left_count_ = builder.get_nodes()[index + 1].count;
+        right_count_ = builder.get_nodes()[node.offset].count;
+    }
+
+    // 单个图元的叶节点直接指向图元，多个图元的叶节点为图元列表
+    static shared_ptr<Hittable> make_child(const BVHBuilder& builder, const std::vector<shared_ptr<Hittable>>& objects, uint index, bool ordered)
+    {
+        const BVHBuildNode& node = builder.get_nodes()[index];
+        const auto& indices = builder.get_indices();
+
+        if (node.count == 0)
+            return make_shared<BVHNode>(builder, objects, index, ordered);
+
+        if (node.count == 1)
+            return objects[indices[node.offset]];
+
+        auto leaf = make_shared<HittableList>();
+        for (uint i = node.offset; i < node.offset + node.count; ++i)
+            leaf->add(objects[indices[i]]);
+        return leaf;
+    }
+};
+
+#endif // !BVH_NODE_H
@@ -0,0 +1,487 @@
+/*
+ * 均匀网格类
+ * 将图元所在空间划分为等大的单元，图元登记到与其包围盒相交的所有单元，光线用3D-DDA由近及远逐个单元前进
+ * 稀疏模式只存储非空单元，按单元编号在哈希表中查找，内存与非空单元数成正比
+ * 适合大小相近、分布均匀的小图元，如大量随机分布的球
+ */
+#ifndef GRID_H
+#define GRID_H
+
+#include "bvh_builder.h"
+#include "hittable_list.h"
+#include "leaf_primitives.h"
+
+class Grid : public Hittable
+{
+private:
+    static constexpr double kDensity = 8.;  // 平均每个图元对应的单元数
+    static const int   kMaxResolution = 1024;      // 每轴最多单元数
+    static const ullong kMaxDenseCells = 1ull << 24; // 非稀疏模式最多单元数，超过时按比例降低分辨率
+    static const ullong kEmptyCell = ~0ull;
+
+    // 稀疏模式的哈希表项，开放寻址、线性探测
+    struct HashCell
+    {
+        ullong cell = kEmptyCell; // 单元编号
+        uint   offset = 0;        // 首个图元编号在cell_objects_中的位置
+        uint   count = 0;
+    };
+
+    std::vector<shared_ptr<Hittable>> objects_;
+    std::vector<uint> large_;        // 包围盒至少两个轴超过场景一半的图元，不登记到单元，每条光线单独求交
+    std::vector<uint> cell_objects_; // 各单元的图元编号，按单元顺序连续存储
+    std::vector<uint> cell_offsets_; // 非稀疏模式：单元i的图元为cell_objects_[cell_offsets_[i], cell_offsets_[i + 1])
+    std::vector<HashCell> table_;    // 稀疏模式：非空单元的哈希表
+    ullong table_mask_ = 0;
+    LeafPrimitives leaves_; // 三角形的SoA数据，按图元编号排列
+    AABB bbox_;   // 所有图元的包围盒
+    AABB bounds_; // 网格范围，不含大图元
+    int resolution_[3] = { 0, 0, 0 };
+    Vec3 cell_size_;
+    Vec3 inv_cell_size_;
+    bool hashed_ = false;
+    bool quality_report_ = false;
+
+public:
+    Grid() = delete;
+
+    Grid(const HittableList& list, const BVHBuildOption& option)
+        : objects_(list.get_objects()), hashed_(option.grid.hashed), quality_report_(option.quality_report)
+    {
+        build();
+    }
+
+    Grid(const Grid&) = delete;
+    Grid& operator=(const Grid&) = delete;
+
+    Grid(Grid&&) = delete;
+    Grid& operator=(Grid&&) = delete;
+
+public:
+    // 参见 Amanatides & Woo 1987, A Fast Voxel Traversal Algorithm for Ray Tracing
+    // 单元内找到的交点不超过光线离开该单元的距离时即为最近交点，不再前进
+    // 图元可登记在多个单元中，用信箱跳过已测试的图元
+    bool hit(const Ray& r, const Interval& interval, HitRecord& rec)
+        const override
+    {
+        const WatertightRay watertight(r);
+        double closest_so_far = interval.get_max();
+        bool hit_anything = false;
+        DeferredHit deferred;
+        ullong visited = 0, tested = 0;
+
+        auto test = [&](uint object)
+            {
+                ++tested;
+                if (leaves_.intersect(objects_, object, r, watertight, Interval(interval.get_min(), closest_so_far), deferred, rec))
+                {
+                    hit_anything = true;
+                    closest_so_far = deferred.t;
+                }
+            };
+
+        for (uint object : large_)
+            test(object);
+
+        int cell[3], step[3], out[3];
+        double t_next[3], t_delta[3], t_exit;
+        if (setup_dda(r, interval.get_min(), closest_so_far, cell, step, out, t_next, t_delta, t_exit))
+        {
+            Mailbox mailbox;
+            while (true)
+            {
+                ++visited;
+                const uint* begin;
+                const uint* end;
+                cell_range(cell, begin, end);
+                for (const uint* object = begin; object != end; ++object)
+                {
+                    if (!mailbox.test_and_set(*object))
+                        test(*object);
+                }
+
+                int axis = next_axis(t_next);
+                if (closest_so_far <= t_next[axis] || t_next[axis] > t_exit)
+                    break;
+                cell[axis] += step[axis];
+                if (cell[axis] == out[axis])
+                    break;
+                t_next[axis] += t_delta[axis];
+            }
+        }
+
+        record_traversal(visited, tested);
+        if (hit_anything)
+            resolve(r, deferred, rec);
+        return hit_anything;
+    }
+
+    // 找到任意交点即返回
+    bool occluded(const Ray& r, const Interval& interval)
+        const override
+    {
+        const WatertightRay watertight(r);
+        ullong visited = 0, tested = 0;
+        bool hit_anything = false;
+
+        auto test = [&](uint object)
+            {
+                ++tested;
+                hit_anything = leaves_.is_triangle(object) ? leaves_.intersect(object, watertight, interval) : objects_[object]->occluded(r, interval);
+                return hit_anything;
+            };
+
+        for (uint object : large_)
+        {
+            if (test(object))
+                break;
+        }
+
+        int cell[3], step[3], out[3];
+        double t_next[3], t_delta[3], t_exit;
+        if (!hit_anything && setup_dda(r, interval.get_min(), interval.get_max(), cell, step, out, t_next, t_delta, t_exit))
+        {
+            while (!hit_anything)
+            {
+                ++visited;
+                const uint* begin;
+                const uint* end;
+                cell_range(cell, begin, end);
+                for (const uint* object = begin; object != end && !test(*object); ++object) {}
+
+                int axis = next_axis(t_next);
+                if (t_next[axis] > t_exit)
+                    break;
+                cell[axis] += step[axis];
+                if (cell[axis] == out[axis])
+                    break;
+                t_next[axis] += t_delta[axis];
+            }
+        }
+
+        record_traversal(visited, tested);
+        return hit_anything;
+    }
+
+    AABB get_bbox()
+        const override
+    {
+        return bbox_;
+    }
+
+    // 单元划分随图元范围变化，refit图元后重建
+    void refit()
+        override
+    {
+        for (const auto& object : objects_)
+            object->refit();
+        build();
+    }
+
+private:
+    void build()
+    {
+        large_.clear();
+        cell_objects_.clear();
+        cell_offsets_.clear();
+        table_.clear();
+        leaves_.build(objects_, std::vector<uint>(), false);
+
+        bbox_ = AABB();
+        for (const auto& object : objects_)
+            bbox_ = AABB(bbox_, object->get_bbox());
+
+        // 地面等大图元会把网格撑大到使其余图元挤在少数单元中，单独求交
+        // 只在一个轴上超过一半的细长图元（如高柱）只登记到一列单元，仍按单元登记
+        std::vector<uint> small;
+        bounds_ = AABB();
+        for (uint i = 0; i < objects_.size(); ++i)
+        {
+            AABB bbox = objects_[i]->get_bbox();
+            int large_axes = 0;
+            for (int a = 0; a < 3; ++a)
+                large_axes += bbox.axis(a).get_size() > .5 * bbox_.axis(a).get_size();
+            if (large_axes >= 2 && objects_.size() > 1)
+            {
+                large_.push_back(i);
+                continue;
+            }
+            small.push_back(i);
+            bounds_ = AABB(bounds_, bbox);
+        }
+        if (small.empty())
+            return;
+        bounds_ = bounds_.pad();
+
+        choose_resolution(small.size());
+        if (hashed_)
+            build_hashed(small);
+        else
+            build_dense(small);
+
+        if (quality_report_)
+            report_quality(small.size());
+    }
+
+    // 参见 Wald et al. 2006, Ray Tracing Animated Scenes using Coherent Grid Traversal
+    // 各轴单元数与该轴长度成正比，总数约为图元数的kDensity倍
+    void choose_resolution(size_t count)
+    {
+        double extent[3], max_extent = 0.;
+        for (int a = 0; a < 3; ++a)
+        {
+            extent[a] = bounds_.axis(a).get_size();
+            max_extent = std::max(max_extent, extent[a]);
+        }
+        // 平面场景某轴长度接近0，以最长轴的千分之一计算体积
+        double volume = 1.;
+        for (int a = 0; a < 3; ++a)
+            volume *= std::max(extent[a], max_extent * 1e-3);
+        double cells_per_unit = std::cbrt(kDensity * count / volume);
+
+        ullong total = 1;
+        for (int a = 0; a < 3; ++a)
+        {
+            resolution_[a] = std::clamp(static_cast<int>(std::round(extent[a] * cells_per_unit)), 1, kMaxResolution);
+            total *= resolution_[a];
+        }
+
+        if (!hashed_ && total > kMaxDenseCells)
+        {
+            double scale = std::cbrt(static_cast<double>(kMaxDenseCells) / total);
+            for (int a = 0; a < 3; ++a)
+                resolution_[a] = std::max(1, static_cast<int>(resolution_[a] * scale));
+        }
+
+        for (int a = 0; a < 3; ++a)
+        {
+            cell_size_[a] = extent[a] / resolution_[a];
+            inv_cell_size_[a] = cell_size_[a] > 0 ? 1. / cell_size_[a] : 0.;
+        }
+    }
+
+    // 图元包围盒覆盖的单元范围
+    void cell_bounds(const AABB& bbox, int lo[3], int hi[3])
+        const
+    {
+        for (int a = 0; a < 3; ++a)
+        {
+            lo[a] = position_to_cell(bbox.axis(a).get_min(), a);
+            hi[a] = position_to_cell(bbox.axis(a).get_max(), a);
+        }
+    }
+
+    int position_to_cell(double position, int axis)
+        const
+    {
+        int cell = static_cast<int>((position - bounds_.axis(axis).get_min()) * inv_cell_size_[axis]);
+        return std::clamp(cell, 0, resolution_[axis] - 1);
+    }
+
+    ullong cell_index(int x, int y, int z)
+        const
+    {
+        return static_cast<ullong>(x) + static_cast<ullong>(resolution_[0]) * (y + static_cast<ullong>(resolution_[1]) * z);
+    }
+
+    // 先统计各单元图元数，前缀和得到起始位置，再写入图元编号
+    void build_dense(const std::vector<uint>& small)
+    {
+        ullong cell_count = static_cast<ullong>(resolution_[0]) * resolution_[1] * resolution_[2];
+        cell_offsets_.assign(cell_count + 1, 0);
+
+        int lo[3], hi[3];
+        for (uint i : small)
+        {
+            cell_bounds(objects_[i]->get_bbox(), lo, hi);
+            for (int z = lo[2]; z <= hi[2]; ++z)
+                for (int y = lo[1]; y <= hi[1]; ++y)
+                    for (int x = lo[0]; x <= hi[0]; ++x)
+                        ++cell_offsets_[cell_index(x, y, z) + 1];
+        }
+        for (ullong c = 0; c < cell_count; ++c)
+            cell_offsets_[c + 1] += cell_offsets_[c];
+
+        cell_objects_.resize(cell_offsets_[cell_count]);
+        std::vector<uint> fill(cell_offsets_.begin(), cell_offsets_.end() - 1);
+        for (uint i : small)
+        {
+            cell_bounds(objects_[i]->get_bbox(), lo, hi);
+            for (int z = lo[2]; z <= hi[2]; ++z)
+                for (int y = lo[1]; y <= hi[1]; ++y)
+                    for (int x = lo[0]; x <= hi[0]; ++x)
+                        cell_objects_[fill[cell_index(x, y, z)]++] = i;
+        }
+    }
+
+    // 单元编号和图元编号成对排序，连续相同的单元合为一个哈希表项
+    void build_hashed(const std::vector<uint>& small)
+    {
+        std::vector<std::pair<ullong, uint>> pairs;
+        int lo[3], hi[3];
+        for (uint i : small)
+        {
+            cell_bounds(objects_[i]->get_bbox(), lo, hi);
+            for (int z = lo[2]; z <= hi[2]; ++z)
+                for (int y = lo[1]; y <= hi[1]; ++y)
+                    for (int x = lo[0]; x <= hi[0]; ++x)
+                        pairs.emplace_back(cell_index(x, y, z), i);
+        }
+        std::sort(pairs.begin(), pairs.end());
+
+        size_t nonempty = 0;
+        for (size_t p = 0; p < pairs.size(); ++p)
+            nonempty += p == 0 || pairs[p].first != pairs[p - 1].first;
+
+        // 装载率不超过一半
+        size_t table_size = 1;
+        while (table_size < nonempty * 2)
+            table_size <<= 1;
+        table_.assign(table_size, HashCell());
+        table_mask_ = table_size - 1;
+
+        cell_objects_.resize(pairs.size());
+        for (size_t p = 0; p < pairs.size(); ++p)
+        {
+            cell_objects_[p] = pairs[p].second;
+            if (p > 0 && pairs[p].first == pairs[p - 1].first)
+                continue;
+
+            ullong slot = hash_cell(pairs[p].first) & table_mask_;
+            while (table_[slot].cell != kEmptyCell)
+                slot = (slot + 1) & table_mask_;
+            table_[slot].cell = pairs[p].first;
+            table_[slot].offset = static_cast<uint>(p);
+        }
+        for (const auto& pair : pairs)
+        {
+            ullong slot = hash_cell(pair.first) & table_mask_;
+            while (table_[slot].cell != pair.first)
+                slot = (slot + 1) & table_mask_;
+            ++table_[slot].count;
+        }
+    }
+
+    static ullong hash_cell(ullong cell)
+    {
+        // splitmix64的混合步骤，相邻单元分散到不同的槽
+        cell = (cell ^ (cell >> 30)) * 0xbf58476d1ce4e5b9ull;
+        cell = (cell ^ (cell >> 27)) * 0x94d049bb133111ebull;
+        return cell ^ (cell >> 31);
+    }
+
+    // 单元内的图元编号范围，空单元时begin == end
+    void cell_range(const int cell[3], const uint*& begin, const uint*& end)
+        const
+    {
+        ullong index = cell_index(cell[0], cell[1], cell[2]);
+        begin = end = cell_objects_.data();
+        if (!hashed_)
+        {
+            begin += cell_offsets_[index];
+            end += cell_offsets_[index + 1];
+            return;
+        }
+
+        for (ullong slot = hash_cell(index) & table_mask_; table_[slot].cell != kEmptyCell; slot = (slot + 1) & table_mask_)
+        {
+            if (table_[slot].cell == index)
+            {
+                begin += table_[slot].offset;
+                end = begin + table_[slot].count;
+                return;
+            }
+        }
+    }
+
+    // 光线进入网格处的单元，以及各轴到下一个单元边界的距离和跨过一个单元的距离
+    // 光线在区间内不经过网格时返回false
+    bool setup_dda(const Ray& r, double t_min, double t_max,
+        int cell[3], int step[3], int out[3], double t_next[3], double t_delta[3], double& t_exit)
+        const
+    {
+        if (cell_objects_.empty())
+            return false;
+
+        Point3 origin = r.get_origin();
+        Vec3 direction = r.get_direction();
+        double t_enter = t_min;
+        t_exit = t_max;
+        for (int a = 0; a < 3; ++a)
+        {
+            double inv_dir = 1. / direction[a];
+            double t0 = (bounds_.axis(a).get_min() - origin[a]) * inv_dir;
+            double t1 = (bounds_.axis(a).get_max() - origin[a]) * inv_dir;
+            if (inv_dir < 0)
+                std::swap(t0, t1);
+            if (t0 > t_enter) t_enter = t0;
+            if (t1 < t_exit) t_exit = t1;
+            if (t_exit < t_enter)
+                return false;
+        }
+
+        for (int a = 0; a < 3; ++a)
+        {
+            double min = bounds_.axis(a).get_min();
+            cell[a] = position_to_cell(origin[a] + t_enter * direction[a], a);
+            if (direction[a] > 0)
+            {
+                step[a] = 1;
+                out[a] = resolution_[a];
+                t_next[a] = (min + (cell[a] + 1) * cell_size_[a] - origin[a]) / direction[a];
+                t_delta[a] = cell_size_[a] / direction[a];
+            }
+            else if (direction[a] < 0)
+            {
+                step[a] = -1;
+                out[a] = -1;
+                t_next[a] = (min + cell[a] * cell_size_[a] - origin[a]) / direction[a];
+                t_delta[a] = -cell_size_[a] / direction[a];
+            }
+            else
+            {
+                step[a] = 0;
+                out[a] = -1;
+                t_next[a] = kInfinitDouble;
+                t_delta[a] = kInfinitDouble;
+            }
+        }
+        return true;
+    }
+
+    static int next_axis(const double t_next[3])
+    {
+        if (t_next[0] < t_next[1])
+            return t_next[0] < t_next[2] ? 0 : 2;
+        return t_next[1] < t_next[2] ? 1 : 2;
+    }
+
+    void report_quality(size_t count)
+        const
+    {
+        ullong cell_count = static_cast<ullong>(resolution_[0]) * resolution_[1] * resolution_[2];
+        ullong nonempty = 0;
+        if (hashed_)
+        {
+            for (const HashCell& cell : table_)
+                nonempty += cell.cell != kEmptyCell;
+        }
+        else
+        {
+            for (ullong c = 0; c < cell_count; ++c)
+                nonempty += cell_offsets_[c + 1] > cell_offsets_[c];
+        }
+
+        double primitive_count = static_cast<double>(std::max<size_t>(objects_.size(), 1));
+        size_t memory_bytes = cell_objects_.size() * sizeof(uint) + cell_offsets_.size() * sizeof(uint)
+            + table_.size() * sizeof(HashCell) + large_.size() * sizeof(uint)
+            + leaves_.memory_bytes() + objects_.size() * sizeof(shared_ptr<Hittable>);
+        add_info(std::string(hashed_ ? "hashed grid" : "uniform grid") + " quality: " + STR(resolution_[0]) + "x" + STR(resolution_[1])
+            + "x" + STR(resolution_[2]) + " cells (" + format_num(nonempty) + " non-empty), "
+            + STR(cell_objects_.size() / static_cast<double>(std::max<size_t>(count, 1))) + " references per primitive, "
+            + STR(large_.size()) + " large primitives");
+        add_info("  memory: " + format_num(memory_bytes) + " bytes, " + STR(memory_bytes / primitive_count) + " bytes per primitive");
+    }
+};
+
+#endif // !GRID_H
@@ -1,192 +1,357 @@
-/*
- * 光线可击中物体类
- */
-#ifndef HITTABLE_H
-#define HITTABLE_H
-
-#include "aabb.h"
-
-// 前向声明，避免头文件循环引用
-class Material;
-
-struct HitRecord
-{
-    Point3 p;
-    Vec3 normal;
-    shared_ptr<Material> material;
-    double t;
-    bool front_face;
-    double u, v;
-
-    HitRecord() : p(), normal(), material(), t(0), front_face(false), u(0), v(0) {}
-
-    // 计算是否击中正面，同时确保返回的法线在击中光线的那一边
-    // outward_normal为代表正面的法线
-    void set_face_normal(const Ray& r, const Vec3& outward_normal) 
-    {
-        front_face = dot(r.get_direction(), outward_normal) < 0;
-        normal = front_face ? outward_normal : -outward_normal;
-    }
-};
-
-// 纯虚类
-class Hittable
-{
-public:
-    virtual ~Hittable() = default;
-
-    virtual bool hit(const Ray& r, const Interval& interval, HitRecord& rec) 
-        const = 0;
-    virtual AABB get_bbox() 
-        const = 0;
-
-    virtual double pdf_value(const Point3& o, const Vec3& v) 
-        const
-    {
-        return 0.;
-    }
-
-    virtual Vec3 random(const Vec3& o) 
-        const
-    {
-        return Vec3(1, 0, 0);
-    }
-};
-
-// 参见 RayTracingTheNextWeek 8.1
-// 将对物体的平移等效为对ray的
-class Translate : public Hittable
-{
-private:
-    shared_ptr<Hittable> object_;
-    Vec3 offset_;
-    AABB bbox_;
-
-public:
-    Translate(shared_ptr<Hittable> p, const Vec3& displacement)
-        : object_(p), offset_(displacement)
-    {
-        bbox_ = object_->get_bbox() + offset_;
-    }
-
-    Translate(const Translate&) = delete;
-    Translate& operator=(const Translate&) = delete;
-
-    Translate(Translate&&) = delete;
-    Translate& operator=(Translate&&) = delete;
-
-public:
-    bool hit(const Ray& r, const Interval& interval, HitRecord& rec)
-        const override
-    {
-        // 根据offset反向移动光线
-        Ray offset_r(r.get_origin() - offset_, r.get_direction(), r.get_time());
-
-        if (!object_->hit(offset_r, interval, rec))
-            return false;
-
-        // 将交点根据offset正向移动回去
-        rec.p += offset_;
-        return true;
-    }
-
-    AABB get_bbox() 
-        const override
-    { 
-        return bbox_;
-    }
-};
-
-// 将对物体的绕Y轴转动等效为对ray的
-class RotateY : public Hittable
-{
-private:
-    shared_ptr<Hittable> object_;
-    double sin_theta_, cos_theta_;
-    AABB bbox_;
-
-public:
-    RotateY(shared_ptr<Hittable> p, double angle) : object_(p)
-    {
-        auto radians = degrees_to_radians(angle);
-        sin_theta_ = sin(radians);
-        cos_theta_ = cos(radians);
-        bbox_ = object_->get_bbox();
-
-        Point3 min_p(kInfinitDouble, kInfinitDouble, kInfinitDouble);
-        Point3 max_p(-kInfinitDouble, -kInfinitDouble, -kInfinitDouble);
-
-        for (int i = 0; i < 2; i++)
-        {
-            for (int j = 0; j < 2; j++)
-            {
-                for (int k = 0; k < 2; k++)
-                {
-                    auto x = i * bbox_.x().get_max() + (1 - i) * bbox_.x().get_min();
-                    auto y = j * bbox_.y().get_max() + (1 - j) * bbox_.y().get_min();
-                    auto z = k * bbox_.z().get_max() + (1 - k) * bbox_.z().get_min();
-
-                    auto newx = cos_theta_ * x + sin_theta_ * z;
-                    auto newz = -sin_theta_ * x + cos_theta_ * z;
-
-                    Vec3 tester(newx, y, newz);
-
-                    for (int c = 0; c < 3; c++)
-                    {
-                        min_p[c] = fmin(min_p[c], tester[c]);
-                        max_p[c] = fmax(max_p[c], tester[c]);
-                    }
-                }
-            }
-        }
-
-        bbox_ = AABB(min_p, max_p);
-    }
-
-    RotateY(const RotateY&) = delete;
-    RotateY& operator=(const RotateY&) = delete;
-
-    RotateY(RotateY&&) = delete;
-    RotateY& operator=(RotateY&&) = delete;
-
-public:
-    bool hit(const Ray& r, const Interval& interval, HitRecord& rec)
-        const override
-    {
-        // 将ray从世界空间转换到模型空间
-        auto origin = r.get_origin();
-        auto direction = r.get_direction();
-
-        origin[0] = cos_theta_ * r.get_origin()[0] - sin_theta_ * r.get_origin()[2];
-        origin[2] = sin_theta_ * r.get_origin()[0] + cos_theta_ * r.get_origin()[2];
-
-        direction[0] = cos_theta_ * r.get_direction()[0] - sin_theta_ * r.get_direction()[2];
-        direction[2] = sin_theta_ * r.get_direction()[0] + cos_theta_ * r.get_direction()[2];
-
-        Ray rotated_r(origin, direction, r.get_time());
-
-        if (!object_->hit(rotated_r, interval, rec))
-            return false;
-
-        auto p = rec.p;
-        p[0] = cos_theta_ * rec.p[0] + sin_theta_ * rec.p[2];
-        p[2] = -sin_theta_ * rec.p[0] + cos_theta_ * rec.p[2];
-
-        auto normal = rec.normal;
-        normal[0] = cos_theta_ * rec.normal[0] + sin_theta_ * rec.normal[2];
-        normal[2] = -sin_theta_ * rec.normal[0] + cos_theta_ * rec.normal[2];
-
-        rec.p = p;
-        rec.normal = normal;
-
-        return true;
-    }
-
-    AABB get_bbox() 
-        const override
-    {
-        return bbox_;
-    }
-};
-
-#endif // !HITTABLE_H
+/*
+ * 光线可击中物体类
+ */
+#ifndef HITTABLE_H
+#define HITTABLE_H
+
+#include "aabb.h"
+#include "ray_packet.h"
+
+// 前向声明，避免头文件循环引用
+class Material;
+
+struct HitRecord
+{
+    Point3 p;
+    Vec3 normal;
+    shared_ptr<Material> material;
+    double t;
+    bool front_face;
+    double u, v;
+    Vec3 spawn_offset; // 沿几何法线，长度为p的误差界在法线上的投影，为0时次级光线从p出发
+
+    HitRecord() : p(), normal(), material(), t(0), front_face(false), u(0), v(0), spawn_offset() {}
+
+    // 计算是否击中正面，同时确保返回的法线在击中光线的那一边
+    // outward_normal为代表正面的法线
+    void set_face_normal(const Ray& r, const Vec3& outward_normal) 
+    {
+        front_face = dot(r.get_direction(), outward_normal) < 0;
+        normal = front_face ? outward_normal : -outward_normal;
+    }
+
+    // 参见 PBRT 3.9.5 Robust Spawned Ray Origins
+    // p_error为p各分量的绝对误差界，geometric_normal为几何法线（着色法线可能偏离表面）
+    // 误差盒在法线上的投影之外必然在表面的一侧
+    void set_spawn_offset(const Vec3& p_error, const Vec3& geometric_normal)
+    {
+        Vec3 n = unit_vector(geometric_normal);
+        spawn_offset = dot(abs(n), p_error) * n;
+    }
+
+    // p经过变换后，变换的舍入误差p_error沿spawn_offset的方向累加
+    void add_spawn_error(const Vec3& p_error)
+    {
+        real length = spawn_offset.norm();
+        if (length > 0)
+            spawn_offset *= 1 + dot(abs(spawn_offset), p_error) / (length * length);
+    }
+
+    // 从击中点沿direction生成次级光线，起点移到表面在direction一侧的误差范围外，区间下限可以为0
+    // 加上偏移时也有舍入，各分量再向偏移方向取下一个可表示的数
+    Ray spawn_ray(const Vec3& direction, double time)
+        const
+    {
+        Vec3 offset = dot(direction, spawn_offset) < 0 ? -spawn_offset : spawn_offset;
+        Point3 origin = p + offset;
+        for (int a = 0; a < 3; ++a)
+        {
+            if (offset[a] > 0)
+                origin[a] = std::nextafter(origin[a], std::numeric_limits<real>::infinity());
+            else if (offset[a] < 0)
+                origin[a] = std::nextafter(origin[a], -std::numeric_limits<real>::infinity());
+        }
+        return Ray(origin, direction, time);
+    }
+};
+
+class Hittable;
+
+// 延迟计算属性的交点
+// 遍历时只记录距离、击中的图元和图元内的参数坐标，遍历结束后只为最近交点计算一次位置、法线、纹理坐标和材质
+struct DeferredHit
+{
+    const Hittable* object = nullptr; // 待计算属性的图元，为nullptr时属性已写入HitRecord
+    double t = 0;
+    double b1 = 0, b2 = 0; // 三角形为重心坐标，平行四边形为平面坐标，球不使用
+    uint id = 0;           // 图元内的编号，如网格的面编号
+};
+
+// 纯虚类
+class Hittable
+{
+public:
+    virtual ~Hittable() = default;
+
+    virtual bool hit(const Ray& r, const Interval& interval, HitRecord& rec) 
+        const = 0;
+    virtual AABB get_bbox() 
+        const = 0;
+
+    // 区间内的最近交点，只将距离和参数坐标记入deferred，交点属性由resolve在遍历结束后计算
+    // 未击中时不改写deferred和rec
+    // 默认直接调用hit写入rec并将deferred.object置空，组合物体（列表、变换等）需要在返回前处理交点属性，图元应覆盖
+    virtual bool intersect(const Ray& r, const Interval& interval, DeferredHit& deferred, HitRecord& rec)
+        const
+    {
+        if (!hit(r, interval, rec))
+            return false;
+
+        deferred = { nullptr, rec.t, 0, 0, 0 };
+        return true;
+    }
+
+    // 由intersect记入deferred的距离和参数坐标计算交点属性，只对记录自身的图元调用
+    virtual void set_hit_record(const Ray& /*r*/, const DeferredHit& /*deferred*/, HitRecord& /*rec*/)
+        const
+    {
+    }
+
+    // 遍历结束后为最近交点计算属性，属性已写入rec时不做任何事
+    static void resolve(const Ray& r, const DeferredHit& deferred, HitRecord& rec)
+    {
+        if (deferred.object != nullptr)
+            deferred.object->set_hit_record(r, deferred, rec);
+    }
+
+    // 区间内是否有任意交点，用于可见性测试
+    // 找到第一个交点即返回，不计算交点位置、法线、纹理坐标和材质
+    // 默认退化为最近交点求交，图元和加速结构应覆盖
+    virtual bool occluded(const Ray& r, const Interval& interval)
+        const
+    {
+        HitRecord rec;
+        return hit(r, interval, rec);
+    }
+
+    // 对光线包中的各光线求最近交点，结果写入packet.hits、packet.recs，并缩小packet.t_max
+    // 默认逐条求交，加速结构可覆盖为成组遍历
+    virtual void hit_packet(RayPacket& packet)
+        const
+    {
+        for (int k = 0; k < packet.size; ++k)
+        {
+            if (hit(packet.rays[k], Interval(packet.t_min, packet.t_max[k]), packet.recs[k]))
+            {
+                packet.hits[k] = true;
+                packet.t_max[k] = static_cast<real>(packet.recs[k].t);
+            }
+        }
+    }
+
+    // 物体位于box内部分的包围盒，用于SBVH裁剪图元引用
+    // 默认取包围盒的交集，子类可返回更紧的包围盒
+    virtual AABB clip_bbox(const AABB& box)
+        const
+    {
+        return get_bbox().intersect(box);
+    }
+
+    // 运动物体在time时刻（0~1）的包围盒，用于运动BVH插值
+    // 静止物体即get_bbox()
+    virtual AABB get_bbox_at(double /*time*/)
+        const
+    {
+        return get_bbox();
+    }
+
+    virtual bool is_moving()
+        const
+    {
+        return false;
+    }
+
+    // 几何体移动后更新包围盒
+    // 图元按当前几何重新计算包围盒，组合物体（BVH、列表、变换）先refit子物体再自底向上合并
+    virtual void refit() {}
+
+    virtual double pdf_value(const Point3& o, const Vec3& v) 
+        const
+    {
+        return 0.;
+    }
+
+    virtual Vec3 random(const Vec3& o) 
+        const
+    {
+        return Vec3(1, 0, 0);
+    }
+};
+
+// 参见 RayTracingTheNextWeek 8.1
+// 将对物体的平移等效为对ray的
+class Translate : public Hittable
+{
+private:
+    shared_ptr<Hittable> object_;
+    Vec3 offset_;
+    AABB bbox_;
+
+public:
+    Translate(shared_ptr<Hittable> p, const Vec3& displacement)
+        : object_(p), offset_(displacement)
+    {
+        bbox_ = object_->get_bbox() + offset_;
+    }
+
+    Translate(const Translate&) = delete;
+    Translate& operator=(const Translate&) = delete;
+
+    Translate(Translate&&) = delete;
+    Translate& operator=(Translate&&) = delete;
+
+public:
+    bool hit(const Ray& r, const Interval& interval, HitRecord& rec)
+        const override
+    {
+        // 根据offset反向移动光线
+        Ray offset_r(r.get_origin() - offset_, r.get_direction(), r.get_time());
+
+        if (!object_->hit(offset_r, interval, rec))
+            return false;
+
+        // 将交点根据offset正向移动回去，加法的舍入误差计入偏移
+        rec.p += offset_;
+        rec.add_spawn_error(error_gamma(1) * abs(rec.p));
+        return true;
+    }
+
+    bool occluded(const Ray& r, const Interval& interval)
+        const override
+    {
+        return object_->occluded(Ray(r.get_origin() - offset_, r.get_direction(), r.get_time()), interval);
+    }
+
+    AABB get_bbox() 
+        const override
+    { 
+        return bbox_;
+    }
+
+    void refit()
+        override
+    {
+        object_->refit();
+        bbox_ = object_->get_bbox() + offset_;
+    }
+};
+
+// 将对物体的绕Y轴转动等效为对ray的
+class RotateY : public Hittable
+{
+private:
+    shared_ptr<Hittable> object_;
+    double sin_theta_, cos_theta_;
+    AABB bbox_;
+
+public:
+    RotateY(shared_ptr<Hittable> p, double angle) : object_(p)
+    {
+        auto radians = degrees_to_radians(angle);
+        sin_theta_ = sin(radians);
+        cos_theta_ = cos(radians);
+        bbox_ = rotate_bbox(object_->get_bbox());
+    }
+
+    RotateY(const RotateY&) = delete;
+    RotateY& operator=(const RotateY&) = delete;
+
+    RotateY(RotateY&&) = delete;
+    RotateY& operator=(RotateY&&) = delete;
+
+public:
+    bool hit(const Ray& r, const Interval& interval, HitRecord& rec)
+        const override
+    {
+        if (!object_->hit(rotate_ray(r), interval, rec))
+            return false;
+
+        auto p = rec.p;
+        p[0] = cos_theta_ * rec.p[0] + sin_theta_ * rec.p[2];
+        p[2] = -sin_theta_ * rec.p[0] + cos_theta_ * rec.p[2];
+
+        auto normal = rec.normal;
+        normal[0] = cos_theta_ * rec.normal[0] + sin_theta_ * rec.normal[2];
+        normal[2] = -sin_theta_ * rec.normal[0] + cos_theta_ * rec.normal[2];
+
+        rec.p = p;
+        rec.normal = normal;
+        rec.spawn_offset = Vec3(cos_theta_ * rec.spawn_offset[0] + sin_theta_ * rec.spawn_offset[2], rec.spawn_offset[1],
+            -sin_theta_ * rec.spawn_offset[0] + cos_theta_ * rec.spawn_offset[2]);
+        rec.add_spawn_error(error_gamma(3) * abs(p));
+
+        return true;
+    }
+
+    bool occluded(const Ray& r, const Interval& interval)
+        const override
+    {
+        return object_->occluded(rotate_ray(r), interval);
+    }
+
+    AABB get_bbox() 
+        const override
+    {
+        return bbox_;
+    }
+
+    void refit()
+        override
+    {
+        object_->refit();
+        bbox_ = rotate_bbox(object_->get_bbox());
+    }
+
+private:
+    // 将ray从世界空间转换到模型空间
+    Ray rotate_ray(const Ray& r)
+        const
+    {
+        auto origin = r.get_origin();
+        auto direction = r.get_direction();
+
+        origin[0] = cos_theta_ * r.get_origin()[0] - sin_theta_ * r.get_origin()[2];
+        origin[2] = sin_theta_ * r.get_origin()[0] + cos_theta_ * r.get_origin()[2];
+
+        direction[0] = cos_theta_ * r.get_direction()[0] - sin_theta_ * r.get_direction()[2];
+        direction[2] = sin_theta_ * r.get_direction()[0] + cos_theta_ * r.get_direction()[2];
+
+        return Ray(origin, direction, r.get_time());
+    }
+
+    // 包围盒绕Y轴转动后的包围盒
+    AABB rotate_bbox(const AABB& box)
+        const
+    {
+        Point3 min_p(kInfinitDouble, kInfinitDouble, kInfinitDouble);
+        Point3 max_p(-kInfinitDouble, -kInfinitDouble, -kInfinitDouble);
+
+        for (int i = 0; i < 2; i++)
+        {
+            for (int j = 0; j < 2; j++)
+            {
+                for (int k = 0; k < 2; k++)
+                {
+                    auto x = i * box.x().get_max() + (1 - i) * box.x().get_min();
+                    auto y = j * box.y().get_max() + (1 - j) * box.y().get_min();
+                    auto z = k * box.z().get_max() + (1 - k) * box.z().get_min();
+
+                    auto newx = cos_theta_ * x + sin_theta_ * z;
+                    auto newz = -sin_theta_ * x + cos_theta_ * z;
+
+                    Vec3 tester(newx, y, newz);
+
+                    for (int c = 0; c < 3; c++)
+                    {
+                        min_p[c] = fmin(min_p[c], tester[c]);
+                        max_p[c] = fmax(max_p[c], tester[c]);
+                    }
+                }
+            }
+        }
+
+        return AABB(min_p, max_p);
+    }
+};
+
+#endif // !HITTABLE_H
@@ -1,103 +1,143 @@
-/*
- * 光线可击中物体总列表类
- */
-#ifndef HITTABLE_LIST_H
-#define HITTABLE_LIST_H
-
-#include "hittable.h"
-
-class HittableList : public Hittable
-{
-private:
-    std::vector<shared_ptr<Hittable>> objects_;
-    AABB bbox_;
-
-public:
-    HittableList() = default;
-
-    HittableList(shared_ptr<Hittable> object)
-    {
-        add(object);
-    }
-
-    HittableList& operator=(std::vector<shared_ptr<Hittable>>&& objects)
-    {
-        objects_ = std::move(objects);
-        for(const auto& o : objects_)
-            bbox_ = AABB(bbox_, o->get_bbox());
-        return *this;
-    }
-
-    HittableList(const HittableList&) = delete;
-    HittableList& operator=(const HittableList&) = delete;
-
-    HittableList(HittableList&&) = delete;
-    HittableList& operator=(HittableList&&) = delete;
-
-public:
-    void clear() 
-    { 
-        objects_.clear(); 
-    }
-
-    void add(shared_ptr<Hittable> object)
-    {
-        objects_.emplace_back(object);
-        bbox_ = AABB(bbox_, object->get_bbox()); // 并集运算
-    }
-
-    bool hit(const Ray& r, const Interval& interval, HitRecord& rec)
-        const override
-    {
-        HitRecord temp_rec;
-        bool hit_anything = false;
-        auto closest_so_far = interval.get_max();
-
-        for (const auto& object : objects_)
-        {
-            if (object->hit(r, Interval(interval.get_min(), closest_so_far), temp_rec))
-            {
-                hit_anything = true;
-                closest_so_far = temp_rec.t; // 更新当前击中时候的光线投射距离为下次光线投射的最大距离
-                rec = temp_rec; // 更新击中信息
-            }
-        }
-
-        return hit_anything;
-    }
-
-    std::vector<shared_ptr<Hittable>> get_objects() 
-        const
-    {
-        return objects_;
-    }
-
-    // 多个物体PDF加权
-    double pdf_value(const Point3& o, const Vec3& v) 
-        const override
-    {
-        auto weight = 1. / objects_.size();
-        auto sum = 0.;
-
-        for (const auto& object : objects_)
-            sum += weight * object->pdf_value(o, v);
-
-        return sum;
-    }
-
-    Vec3 random(const Vec3& o) 
-        const override
-    {
-        auto int_size = static_cast<int>(objects_.size());
-        return objects_[random_int(0, int_size - 1)]->random(o);
-    }
-
-    AABB get_bbox() 
-        const override
-    {
-        return bbox_;
-    }
-
-};
-
-#endif // !HITTABLE_LIST_H
+/*
+ * 光线可击中物体总列表类
+ */
+#ifndef HITTABLE_LIST_H
+#define HITTABLE_LIST_H
+
+#include "hittable.h"
+
+class HittableList : public Hittable
+{
+private:
+    std::vector<shared_ptr<Hittable>> objects_;
+    AABB bbox_;
+
+public:
+    HittableList() = default;
+
+    HittableList(shared_ptr<Hittable> object)
+    {
+        add(object);
+    }
+
+    HittableList& operator=(std::vector<shared_ptr<Hittable>>&& objects)
+    {
+        objects_ = std::move(objects);
+        for(const auto& o : objects_)
+            bbox_ = AABB(bbox_, o->get_bbox());
+        return *this;
+    }
+
+    HittableList(const HittableList&) = delete;
+    HittableList& operator=(const HittableList&) = delete;
+
+    HittableList(HittableList&&) = delete;
+    HittableList& operator=(HittableList&&) = delete;
+
+public:
+    void clear() 
+    { 
+        objects_.clear(); 
+    }
+
+    void add(shared_ptr<Hittable> object)
+    {
+        objects_.emplace_back(object);
+        bbox_ = AABB(bbox_, object->get_bbox()); // 并集运算
+    }
+
+    bool hit(const Ray& r, const Interval& interval, HitRecord& rec)
+        const override
+    {
+        DeferredHit deferred;
+        if (!intersect(r, interval, deferred, rec))
+            return false;
+
+        resolve(r, deferred, rec);
+        return true;
+    }
+
+    // 图元只记录交点，不计算属性，其它物体击中时直接写入rec
+    bool intersect(const Ray& r, const Interval& interval, DeferredHit& deferred, HitRecord& rec)
+        const override
+    {
+        bool hit_anything = false;
+        double closest_so_far = interval.get_max();
+
+        for (const auto& object : objects_)
+        {
+            if (object->intersect(r, Interval(interval.get_min(), closest_so_far), deferred, rec))
+            {
+                hit_anything = true;
+                closest_so_far = deferred.t; // 更新当前击中时候的光线投射距离为下次光线投射的最大距离
+            }
+        }
+
+        return hit_anything;
+    }
+
+    bool occluded(const Ray& r, const Interval& interval)
+        const override
+    {
+        for (const auto& object : objects_)
+        {
+            if (object->occluded(r, interval))
+                return true;
+        }
+        return false;
+    }
+
+    // 各物体依次以缩小后的区间上限求交
+    void hit_packet(RayPacket& packet)
+        const override
+    {
+        for (const auto& object : objects_)
+            object->hit_packet(packet);
+    }
+
+    std::vector<shared_ptr<Hittable>> get_objects() 
+        const
+    {
+        return objects_;
+    }
+
+    // 多个物体PDF加权
+    double pdf_value(const Point3& o, const Vec3& v) 
+        const override
+    {
+        auto weight = 1. / objects_.size();
+        auto sum = 0.;
+
+        for (const auto& object : objects_)
+            sum += weight * object->pdf_value(o, v);
+
+        return sum;
+    }
+
+    Vec3 random(const Vec3& o) 
+        const override
+    {
+        auto int_size = static_cast<int>(objects_.size());
+        return objects_[random_int(0, int_size - 1)]->random(o);
+    }
+
+    AABB get_bbox() 
+        const override
+    {
+        return bbox_;
+    }
+
+    void refit()
+        override
+    {
+        bbox_ = AABB();
+        for (const auto& object : objects_)
+        {
+            object->refit();
+            bbox_ = AABB(bbox_, object->get_bbox());
+        }
+    }
+
+};
+
+#endif // !HITTABLE_LIST_H
@@ -0,0 +1,211 @@
+/*
+ * 实例类
+ * 两级加速结构中的顶层图元：引用共享的底层BVH及一个3x4仿射变换
+ */
+#ifndef INSTANCE_H
+#define INSTANCE_H
+
+#include "hittable.h"
+#include "mat.h"
+
+// 3x4仿射变换，前三列为线性部分，第四列为平移
+using Affine = Mat<3, 4>;
+
+// 由线性部分和平移组成仿射变换
+inline Affine make_affine(const Mat<3, 3>& linear, const Vec3& translation)
+{
+    Affine m;
+    for (int i = 0; i < 3; ++i)
+    {
+        for (int j = 0; j < 3; ++j)
+            m[i][j] = linear[i][j];
+        m[i][3] = translation[i];
+    }
+    return m;
+}
+
+// 绕单位轴axis旋转degrees度，参见 PBRT 3.9.6 Rotation Around an Arbitrary Axis
+inline Mat<3, 3> rotate_matrix(const Vec3& axis, double degrees)
+{
+    Vec3 a = unit_vector(axis);
+    double s = sin(degrees_to_radians(degrees));
+    double c = cos(degrees_to_radians(degrees));
+
+    Mat<3, 3> m;
+    m[0] = Vec3(a[0] * a[0] + (1 - a[0] * a[0]) * c, a[0] * a[1] * (1 - c) - a[2] * s, a[0] * a[2] * (1 - c) + a[1] * s);
+    m[1] = Vec3(a[0] * a[1] * (1 - c) + a[2] * s, a[1] * a[1] + (1 - a[1] * a[1]) * c, a[1] * a[2] * (1 - c) - a[0] * s);
+    m[2] = Vec3(a[0] * a[2] * (1 - c) - a[1] * s, a[1] * a[2] * (1 - c) + a[0] * s, a[2] * a[2] + (1 - a[2] * a[2]) * c);
+    return m;
+}
+
+inline Mat<3, 3> scale_matrix(const Vec3& scale)
+{
+    Mat<3, 3> m;
+    for (int i = 0; i < 3; ++i)
+        m[i][i] = scale[i];
+    return m;
+}
+
+// 仿射变换的逆，线性部分用伴随矩阵求逆
+inline Affine invert_affine(const Affine& m)
+{
+    Mat<3, 3> linear;
+    Vec3 translation;
+    for (int i = 0; i < 3; ++i)
+    {
+        for (int j = 0; j < 3; ++j)
+            linear[i][j] = m[i][j];
+        translation[i] = m[i][3];
+    }
+
+    double det = linear.det();
+    assert(det != 0);
+    Mat<3, 3> inv = linear.adjugate().transpose() / det;
+    return make_affine(inv, -(inv * translation));
+}
+
+inline Point3 transform_point(const Affine& m, const Point3& p)
+{
+    return Point3(
+        m[0][0] * p[0] + m[0][1] * p[1] + m[0][2] * p[2] + m[0][3],
+        m[1][0] * p[0] + m[1][1] * p[1] + m[1][2] * p[2] + m[1][3],
+        m[2][0] * p[0] + m[2][1] * p[1] + m[2][2] * p[2] + m[2][3]);
+}
+
+inline Vec3 transform_vector(const Affine& m, const Vec3& v)
+{
+    return Vec3(
+        m[0][0] * v[0] + m[0][1] * v[1] + m[0][2] * v[2],
+        m[1][0] * v[0] + m[1][1] * v[1] + m[1][2] * v[2],
+        m[2][0] * v[0] + m[2][1] * v[1] + m[2][2] * v[2]);
+}
+
+// 法线按逆矩阵的转置变换，参见 PBRT 3.10.3 Normals
+inline Vec3 transform_normal(const Affine& inv, const Vec3& n)
+{
+    return Vec3(
+        inv[0][0] * n[0] + inv[1][0] * n[1] + inv[2][0] * n[2],
+        inv[0][1] * n[0] + inv[1][1] * n[1] + inv[2][1] * n[2],
+        inv[0][2] * n[0] + inv[1][2] * n[1] + inv[2][2] * n[2]);
+}
+
+// 参见 PBRT 4.4.2 Object Instancing
+// 多个实例共享同一个底层BVH，每个实例只存储变换矩阵和包围盒
+// 光线在进入实例时变换到模型空间一次，方向不归一化，因此t在两个空间中相同
+class Instance : public Hittable
+{
+private:
+    shared_ptr<Hittable> object_;      // 共享的底层BVH
+    Affine object_to_world_;
+    Affine world_to_object_;
+    shared_ptr<Material> material_;    // 非空时覆盖底层物体的材质
+    AABB bbox_;
+
+public:
+    Instance(shared_ptr<Hittable> object, const Affine& object_to_world, shared_ptr<Material> material = nullptr)
+        : object_(object), object_to_world_(object_to_world), material_(material)
+    {
+        world_to_object_ = invert_affine(object_to_world_);
+        bbox_ = transform_bbox();
+    }
+
+    Instance(const Instance&) = delete;
+    Instance& operator=(const Instance&) = delete;
+
+    Instance(Instance&&) = delete;
+    Instance& operator=(Instance&&) = delete;
+
+public:
+    bool hit(const Ray& r, const Interval& interval, HitRecord& rec)
+        const override
+    {
+        if (!object_->hit(to_object(r), interval, rec))
+            return false;
+
+        // 交点和法线变换回世界空间，法线朝向与光线的关系在变换前后不变
+        // 偏移作为向量变换，离开表面的距离按变换比例变化，再计入变换的舍入误差，参见 PBRT 3.9.6
+        Point3 object_p = rec.p;
+        rec.p = transform_point(object_to_world_, object_p);
+        rec.normal = unit_vector(transform_normal(world_to_object_, rec.normal));
+        rec.spawn_offset = transform_vector(object_to_world_, rec.spawn_offset);
+        rec.add_spawn_error(error_gamma(3) * transform_error(object_p));
+        if (material_)
+            rec.material = material_;
+
+        return true;
+    }
+
+    bool occluded(const Ray& r, const Interval& interval)
+        const override
+    {
+        return object_->occluded(to_object(r), interval);
+    }
+
+    AABB get_bbox()
+        const override
+    {
+        return bbox_;
+    }
+
+    // 修改变换并立即重新计算包围盒，上层加速结构仍需refit
+    void set_transform(const Affine& object_to_world)
+    {
+        object_to_world_ = object_to_world;
+        world_to_object_ = invert_affine(object_to_world_);
+        bbox_ = transform_bbox();
+    }
+
+    // 底层BVH由多个实例共享，需由使用者先refit一次，此处只重新计算实例的包围盒
+    void refit()
+        override
+    {
+        bbox_ = transform_bbox();
+    }
+
+private:
+    // 将ray从世界空间变换到模型空间，方向不单位化，t值在两个空间中相同
+    Ray to_object(const Ray& r)
+        const
+    {
+        return Ray(
+            transform_point(world_to_object_, r.get_origin()),
+            transform_vector(world_to_object_, r.get_direction()),
+            r.get_time());
+    }
+
+    // 以real计算transform_point时各分量的舍入误差界（不含gamma系数）
+    Vec3 transform_error(const Point3& p)
+        const
+    {
+        const Affine& m = object_to_world_;
+        Vec3 error;
+        for (int i = 0; i < 3; ++i)
+            error[i] = std::abs(m[i][0] * p[0]) + std::abs(m[i][1] * p[1]) + std::abs(m[i][2] * p[2]) + std::abs(m[i][3]);
+        return error;
+    }
+
+    // 变换底层包围盒的8个顶点
+    AABB transform_bbox()
+        const
+    {
+        AABB box = object_->get_bbox();
+        Point3 min_p(kInfinitDouble, kInfinitDouble, kInfinitDouble);
+        Point3 max_p(-kInfinitDouble, -kInfinitDouble, -kInfinitDouble);
+        for (int i = 0; i < 8; ++i)
+        {
+            Point3 corner(
+                (i & 1) ? box.x().get_max() : box.x().get_min(),
+                (i & 2) ? box.y().get_max() : box.y().get_min(),
+                (i & 4) ? box.z().get_max() : box.z().get_min());
+            Point3 p = transform_point(object_to_world_, corner);
+            for (int c = 0; c < 3; ++c)
+            {
+                min_p[c] = fmin(min_p[c], p[c]);
+                max_p[c] = fmax(max_p[c], p[c]);
+            }
+        }
+        return AABB(min_p, max_p).pad();
+    }
+};
+
+#endif // !INSTANCE_H
@@ -0,0 +1,618 @@
+/*
+ * kd树类
+ * 用轴对齐平面递归划分空间，图元按与子空间是否相交分配，跨越平面的图元同时被两侧引用
+ * 遍历时沿光线从近到远访问叶节点，找到交点后不再访问更远的节点
+ */
+#ifndef KD_TREE_H
+#define KD_TREE_H
+
+#include "linear_bvh.h"
+
+// 参见 PBRT(3rd) 4.4
+// 8字节节点
+// 内部节点：下方子节点紧随父节点之后，flags高30位为上方子节点索引
+// 叶节点：flags高30位为图元数，单个图元时直接记录图元编号，否则记录在图元编号数组中的起始位置
+struct KdTreeNode
+{
+    union
+    {
+        float split;     // 内部节点：划分平面位置
+        uint  primitive; // 单图元叶节点：图元编号
+        uint  offset;    // 多图元叶节点：首个图元编号的位置
+    };
+    uint flags; // 低2位：0、1、2为划分轴，3为叶节点
+
+    bool is_leaf()
+        const
+    {
+        return (flags & 3) == 3;
+    }
+
+    int axis()
+        const
+    {
+        return flags & 3;
+    }
+
+    uint count()
+        const
+    {
+        return flags >> 2;
+    }
+
+    uint above_child()
+        const
+    {
+        return flags >> 2;
+    }
+};
+
+static_assert(sizeof(KdTreeNode) == 8, "KdTreeNode should be 8 bytes");
+
+class KdTree : public Hittable
+{
+private:
+    static const int kStackSize = 64;
+    static constexpr double kIntersectCost = 1.;  // 求交一次图元的代价
+    static constexpr double kTraversalCost = .3;  // 经过一个节点的代价，只比较一个平面，远低于BVH节点的包围盒测试
+    static constexpr double kEmptyBonus    = .8;  // 一侧为空的划分代价乘此系数，鼓励尽早切掉空白空间
+
+    // 包围盒在某一轴上的边界事件，同一轴同一位置按结束、平面、开始排序
+    enum EventType : uchar
+    {
+        EventType_End    = 0,
+        EventType_Planar = 1,
+        EventType_Start  = 2,
+    };
+
+    struct Event
+    {
+        double position;
+        uint   primitive;
+        uchar  axis;
+        uchar  type;
+
+        bool operator<(const Event& other)
+            const
+        {
+            if (axis != other.axis)
+                return axis < other.axis;
+            if (position != other.position)
+                return position < other.position;
+            return type < other.type;
+        }
+    };
+
+    // 图元相对划分平面的位置
+    enum Side : uchar
+    {
+        Side_Both  = 0,
+        Side_Left  = 1,
+        Side_Right = 2,
+    };
+
+    struct Split
+    {
+        double cost = kInfinitDouble;
+        double position = 0.;
+        int    axis = 0;
+        bool   planar_left = true; // 位于平面上的图元分到下方
+    };
+
+    std::vector<KdTreeNode> nodes_;
+    std::vector<uint> indices_; // 多图元叶节点的图元编号
+    std::vector<shared_ptr<Hittable>> objects_;
+    LeafPrimitives leaves_; // 三角形的SoA数据，按图元编号排列
+    AABB bbox_;
+    bool quality_report_; // 构建后是否输出树的质量统计
+
+    // 构建时使用
+    std::vector<uchar> sides_;
+    int max_depth_ = 0;
+
+public:
+    KdTree() = delete;
+
+    KdTree(const HittableList& list, const BVHBuildOption& option)
+        : objects_(list.get_objects()), quality_report_(option.quality_report)
+    {
+        build();
+    }
+
+    KdTree(const KdTree&) = delete;
+    KdTree& operator=(const KdTree&) = delete;
+
+    KdTree(KdTree&&) = delete;
+    KdTree& operator=(KdTree&&) = delete;
+
+public:
+    // 参见 PBRT(3rd) 4.4.3
+    // 栈中记录远处子节点和光线在其中的距离范围，不需要叶节点间的邻接指针（ropes）
+    // 图元可被多个叶节点引用，用信箱跳过已测试的图元
+    bool hit(const Ray& r, const Interval& interval, HitRecord& rec)
+        const override
+    {
+        struct StackEntry
+        {
+            uint index;
+            double t_min, t_max;
+        };
+
+        Point3 origin = r.get_origin();
+        Vec3 direction = r.get_direction();
+        Vec3 inv_dir = 1. / direction;
+        double t_min = interval.get_min(), t_max = interval.get_max();
+        if (nodes_.empty() || !clip_ray(origin, inv_dir, t_min, t_max))
+            return false;
+
+        const WatertightRay watertight(r);
+        double closest_so_far = interval.get_max();
+        bool hit_anything = false;
+        DeferredHit deferred;
+        ullong visited = 0, tested = 0;
+        Mailbox mailbox;
+
+        StackEntry stack[kStackSize];
+        int top = 0;
+        uint index = 0;
+
+        while (true)
+        {
+            // 已找到比当前节点更近的交点
+            if (closest_so_far < t_min)
+                break;
+
+            const KdTreeNode& node = nodes_[index];
+            ++visited;
+            if (!node.is_leaf())
+            {
+                int axis = node.axis();
+                double t_plane = (node.split - origin[axis]) * inv_dir[axis];
+
+                // 光线原点所在一侧的子节点较近
+                bool below_first = origin[axis] < node.split || (origin[axis] == node.split && direction[axis] <= 0);
+                uint first = below_first ? index + 1 : node.above_child();
+                uint second = below_first ? node.above_child() : index + 1;
+
+                if (t_plane > t_max || t_plane <= 0)
+                {
+                    index = first;
+                }
+                else if (t_plane < t_min)
+                {
+                    index = second;
+                }
+                else
+                {
+                    stack[top++] = { second, t_plane, t_max };
+                    index = first;
+                    t_max = t_plane;
+                }
+                continue;
+            }
+
+            uint count = node.count();
+            for (uint i = 0; i < count; ++i)
+            {
+                uint object = count == 1 ? node.primitive : indices_[node.offset + i];
+                if (mailbox.test_and_set(object))
+                    continue;
+                ++tested;
+                if (leaves_.intersect(objects_, object, r, watertight, Interval(interval.get_min(), closest_so_far), deferred, rec))
+                {
+                    hit_anything = true;
+                    closest_so_far = deferred.t;
+                }
+            }
+
+            if (top == 0)
+                break;
+            --top;
+            index = stack[top].index;
+            t_min = stack[top].t_min;
+            t_max = stack[top].t_max;
+        }
+
+        record_traversal(visited, tested);
+        if (hit_anything)
+            resolve(r, deferred, rec);
+        return hit_anything;
+    }
+
+    // 找到任意交点即返回
+    bool occluded(const Ray& r, const Interval& interval)
+        const override
+    {
+        struct StackEntry
+        {
+            uint index;
+            double t_min, t_max;
+        };
+
+        Point3 origin = r.get_origin();
+        Vec3 direction = r.get_direction();
+        Vec3 inv_dir = 1. / direction;
+        double t_min = interval.get_min(), t_max = interval.get_max();
+        if (nodes_.empty() || !clip_ray(origin, inv_dir, t_min, t_max))
+            return false;
+
+        const WatertightRay watertight(r);
+        ullong visited = 0, tested = 0;
+        bool hit_anything = false;
+
+        StackEntry stack[kStackSize];
+        int top = 0;
+        uint index = 0;
+
+        while (true)
+        {
+            const KdTreeNode& node = nodes_[index];
+            ++visited;
+            if (!node.is_leaf())
+            {
+                int axis = node.axis();
+                double t_plane = (node.split - origin[axis]) * inv_dir[axis];
+                bool below_first = origin[axis] < node.split || (origin[axis] == node.split && direction[axis] <= 0);
+                uint first = below_first ? index + 1 : node.above_child();
+                uint second = below_first ? node.above_child() : index + 1;
+
+                if (t_plane > t_max || t_plane <= 0)
+                {
+                    index = first;
+                }
+                else if (t_plane < t_min)
+                {
+                    index = second;
+                }
+                else
+                {
+                    stack[top++] = { second, t_plane, t_max };
+                    index = first;
+                    t_max = t_plane;
+                }
+                continue;
+            }
+
+            uint count = node.count();
+            for (uint i = 0; i < count && !hit_anything; ++i, ++tested)
+            {
+                uint object = count == 1 ? node.primitive : indices_[node.offset + i];
+                hit_anything = leaves_.is_triangle(object) ? leaves_.intersect(object, watertight, interval) : objects_[object]->occluded(r, interval);
+            }
+            if (hit_anything || top == 0)
+                break;
+
+            --top;
+            index = stack[top].index;
+            t_min = stack[top].t_min;
+            t_max = stack[top].t_max;
+        }
+
+        record_traversal(visited, tested);
+        return hit_anything;
+    }
+
+    AABB get_bbox()
+        const override
+    {
+        return bbox_;
+    }
+
+    // 划分平面不能随几何移动，refit图元后重建
+    void refit()
+        override
+    {
+        for (const auto& object : objects_)
+            object->refit();
+        build();
+    }
+
+private:
+    // 参见 Wald & Havran 2006, On building fast kd-Trees for Ray Tracing, and on doing that in O(N log N)
+    // 三个轴的边界事件只在根节点排序一次，划分时按原顺序分到两侧，只有跨越平面的图元重新生成事件后归并
+    void build()
+    {
+        nodes_.clear();
+        indices_.clear();
+        sides_.assign(objects_.size(), Side_Both);
+        leaves_.build(objects_, std::vector<uint>(), false);
+
+        std::vector<Event> events;
+        events.reserve(objects_.size() * 6);
+        AABB voxel;
+        for (uint i = 0; i < objects_.size(); ++i)
+        {
+            AABB bbox = round_bbox(objects_[i]->get_bbox());
+            voxel = AABB(voxel, bbox);
+            add_events(events, bbox, i);
+        }
+        std::sort(events.begin(), events.end());
+        bbox_ = voxel;
+
+        // 参见 PBRT(3rd) 4.4.2，最大深度取8+1.3log2(N)
+        max_depth_ = static_cast<int>(std::round(8 + 1.3 * std::log2(std::max<size_t>(objects_.size(), 1))));
+        max_depth_ = std::min(max_depth_, kStackSize - 1);
+        if (!objects_.empty())
+            build_node(events, static_cast<uint>(objects_.size()), voxel, 0);
+        sides_ = std::vector<uchar>();
+
+        if (quality_report_)
+            report_quality();
+    }
+
+    // events为节点内图元的已排序事件，count为图元数
+    void build_node(std::vector<Event>& events, uint count, const AABB& voxel, int depth)
+    {
+        uint index = static_cast<uint>(nodes_.size());
+        nodes_.emplace_back();
+
+        Split split = depth < max_depth_ && count > 1 ? find_split(events, count, voxel) : Split();
+        if (split.cost >= kIntersectCost * count)
+        {
+            make_leaf(index, events, count);
+            return;
+        }
+
+        // 先按事件标记各图元在平面哪一侧，跨越平面的保持Side_Both
+        uint left_count = 0, right_count = 0;
+        for (const Event& e : events)
+        {
+            if (e.axis == 0 && e.type != EventType_End)
+                sides_[e.primitive] = Side_Both;
+        }
+        for (const Event& e : events)
+        {
+            if (e.axis != split.axis)
+                continue;
+            if (e.type == EventType_End && e.position <= split.position)
+                sides_[e.primitive] = Side_Left;
+            else if (e.type == EventType_Start && e.position >= split.position)
+                sides_[e.primitive] = Side_Right;
+            else if (e.type == EventType_Planar)
+            {
+                if (e.position < split.position || (e.position == split.position && split.planar_left))
+                    sides_[e.primitive] = Side_Left;
+                else
+                    sides_[e.primitive] = Side_Right;
+            }
+        }
+
+        AABB left_voxel = voxel, right_voxel = voxel;
+        set_axis(left_voxel, split.axis, voxel.axis(split.axis).get_min(), split.position);
+        set_axis(right_voxel, split.axis, split.position, voxel.axis(split.axis).get_max());
+
+        // 只在一侧的图元事件保持顺序分到该侧，跨越平面的图元裁剪到子空间后重新生成事件
+        std::vector<Event> left_events, right_events, left_new, right_new;
+        for (const Event& e : events)
+        {
+            if (sides_[e.primitive] == Side_Left)
+                left_events.push_back(e);
+            else if (sides_[e.primitive] == Side_Right)
+                right_events.push_back(e);
+            else if (e.axis == 0 && e.type != EventType_End)
+            {
+                AABB left_bbox = clip_to_voxel(objects_[e.primitive]->clip_bbox(left_voxel), left_voxel);
+                AABB right_bbox = clip_to_voxel(objects_[e.primitive]->clip_bbox(right_voxel), right_voxel);
+                // 精确裁剪因舍入误差两侧都为空时，退回按未裁剪的包围盒分到两侧，不丢弃图元
+                // 图元的包围盒跨越划分平面，与两个子空间的交集都不为空
+                if (left_bbox.is_empty() && right_bbox.is_empty())
+                {
+                    AABB bbox = objects_[e.primitive]->get_bbox();
+                    left_bbox = clip_to_voxel(bbox, left_voxel);
+                    right_bbox = clip_to_voxel(bbox, right_voxel);
+                }
+                if (!left_bbox.is_empty())
+                {
+                    add_events(left_new, left_bbox, e.primitive);
+                    ++left_count;
+                }
+                if (!right_bbox.is_empty())
+                {
+                    add_events(right_new, right_bbox, e.primitive);
+                    ++right_count;
+                }
+            }
+
+            if (e.axis == 0 && e.type != EventType_End)
+            {
+                left_count += sides_[e.primitive] == Side_Left;
+                right_count += sides_[e.primitive] == Side_Right;
+            }
+        }
+        std::vector<Event>().swap(events);
+
+        std::vector<Event> merged;
+        std::sort(left_new.begin(), left_new.end());
+        merged.resize(left_events.size() + left_new.size());
+        std::merge(left_events.begin(), left_events.end(), left_new.begin(), left_new.end(), merged.begin());
+        std::vector<Event>().swap(left_events);
+        std::vector<Event>().swap(left_new);
+        build_node(merged, left_count, left_voxel, depth + 1);
+
+        std::sort(right_new.begin(), right_new.end());
+        merged.resize(right_events.size() + right_new.size());
+        std::merge(right_events.begin(), right_events.end(), right_new.begin(), right_new.end(), merged.begin());
+        std::vector<Event>().swap(right_events);
+        std::vector<Event>().swap(right_new);
+        uint above = static_cast<uint>(nodes_.size());
+        build_node(merged, right_count, right_voxel, depth + 1);
+
+        KdTreeNode& node = nodes_[index];
+        node.split = static_cast<float>(split.position);
+        node.flags = static_cast<uint>(split.axis) | (above << 2);
+    }
+
+    // 按轴扫描已排序的事件，逐个平面计算SAH代价
+    // 位于平面上的图元分别试算放到下方和上方，取较小者
+    Split find_split(const std::vector<Event>& events, uint count, const AABB& voxel)
+        const
+    {
+        Split best;
+        double area = voxel.surface_area();
+        if (area <= 0)
+            return best;
+
+        uint n_left[3] = { 0, 0, 0 }, n_right[3] = { count, count, count };
+        double extent[3];
+        for (int a = 0; a < 3; ++a)
+            extent[a] = voxel.axis(a).get_size();
+
+        size_t i = 0;
+        while (i < events.size())
+        {
+            int axis = events[i].axis;
+            double position = events[i].position;
+            uint ends = 0, planars = 0, starts = 0;
+            while (i < events.size() && events[i].axis == axis && events[i].position == position && events[i].type == EventType_End)
+                ++ends, ++i;
+            while (i < events.size() && events[i].axis == axis && events[i].position == position && events[i].type == EventType_Planar)
+                ++planars, ++i;
+            while (i < events.size() && events[i].axis == axis && events[i].position == position && events[i].type == EventType_Start)
+                ++starts, ++i;
+
+            n_right[axis] -= planars + ends;
+
+            double min = voxel.axis(axis).get_min(), max = voxel.axis(axis).get_max();
+            if (position > min && position < max)
+            {
+                // 子空间的表面积
+                int a1 = (axis + 1) % 3, a2 = (axis + 2) % 3;
+                double cap = extent[a1] * extent[a2];
+                double side = extent[a1] + extent[a2];
+                double area_left = 2 * (cap + (position - min) * side);
+                double area_right = 2 * (cap + (max - position) * side);
+                double p_left = area_left / area, p_right = area_right / area;
+
+                auto cost = [&](uint left, uint right)
+                    {
+                        double c = kTraversalCost + kIntersectCost * (p_left * left + p_right * right);
+                        return (left == 0 || right == 0) ? c * kEmptyBonus : c;
+                    };
+
+                double cost_left = cost(n_left[axis] + planars, n_right[axis]);
+                double cost_right = cost(n_left[axis], n_right[axis] + planars);
+                if (cost_left < best.cost || cost_right < best.cost)
+                {
+                    best.planar_left = cost_left <= cost_right;
+                    best.cost = std::min(cost_left, cost_right);
+                    best.position = position;
+                    best.axis = axis;
+                }
+            }
+
+            n_left[axis] += starts + planars;
+        }
+        return best;
+    }
+
+    void make_leaf(uint index, const std::vector<Event>& events, uint count)
+    {
+        KdTreeNode& node = nodes_[index];
+        node.flags = 3 | (count << 2);
+        node.offset = static_cast<uint>(indices_.size());
+        for (const Event& e : events)
+        {
+            if (e.axis == 0 && e.type != EventType_End)
+                indices_.push_back(e.primitive);
+        }
+
+        if (count == 1)
+        {
+            node.primitive = indices_.back();
+            indices_.pop_back();
+        }
+    }
+
+    // 事件位置与单精度划分平面一致，包围盒向外取整
+    static AABB round_bbox(const AABB& bbox)
+    {
+        return AABB(
+            Interval(round_down_float(bbox.axis(0).get_min()), round_up_float(bbox.axis(0).get_max())),
+            Interval(round_down_float(bbox.axis(1).get_min()), round_up_float(bbox.axis(1).get_max())),
+            Interval(round_down_float(bbox.axis(2).get_min()), round_up_float(bbox.axis(2).get_max())));
+    }
+
+    // 向外取整后仍限制在子空间内
+    static AABB clip_to_voxel(const AABB& bbox, const AABB& voxel)
+    {
+        if (bbox.is_empty())
+            return bbox;
+        return round_bbox(bbox).intersect(voxel);
+    }
+
+    static void set_axis(AABB& bbox, int axis, double min, double max)
+    {
+        Interval intervals[3] = { bbox.axis(0), bbox.axis(1), bbox.axis(2) };
+        intervals[axis] = Interval(min, max);
+        bbox = AABB(intervals[0], intervals[1], intervals[2]);
+    }
+
+    static void add_events(std::vector<Event>& events, const AABB& bbox, uint primitive)
+    {
+        for (int a = 0; a < 3; ++a)
+        {
+            double min = bbox.axis(a).get_min(), max = bbox.axis(a).get_max();
+            if (min == max)
+            {
+                events.push_back({ min, primitive, static_cast<uchar>(a), EventType_Planar });
+                continue;
+            }
+            events.push_back({ min, primitive, static_cast<uchar>(a), EventType_Start });
+            events.push_back({ max, primitive, static_cast<uchar>(a), EventType_End });
+        }
+    }
+
+    // 光线与根节点包围盒的距离范围，未击中时返回false
+    bool clip_ray(const Point3& origin, const Vec3& inv_dir, double& t_min, double& t_max)
+        const
+    {
+        for (int a = 0; a < 3; ++a)
+        {
+            double t0 = (bbox_.axis(a).get_min() - origin[a]) * inv_dir[a];
+            double t1 = (bbox_.axis(a).get_max() - origin[a]) * inv_dir[a];
+
+            if (inv_dir[a] < 0)
+                std::swap(t0, t1);
+
+            if (t0 > t_min) t_min = t0;
+            if (t1 < t_max) t_max = t1;
+
+            if (t_max < t_min)
+                return false;
+        }
+        return true;
+    }
+
+    void report_quality()
+        const
+    {
+        std::vector<int> depths(nodes_.size(), 0);
+        uint leaf_count = 0, empty_count = 0;
+        int max_depth = 0;
+        ullong references = 0;
+
+        for (size_t i = 0; i < nodes_.size(); ++i)
+        {
+            const KdTreeNode& node = nodes_[i];
+            if (node.is_leaf())
+            {
+                ++leaf_count;
+                empty_count += node.count() == 0;
+                references += node.count();
+                max_depth = std::max(max_depth, depths[i]);
+                continue;
+            }
+            depths[i + 1] = depths[node.above_child()] = depths[i] + 1;
+        }
+
+        double primitive_count = static_cast<double>(std::max<size_t>(objects_.size(), 1));
+        size_t memory_bytes = nodes_.size() * sizeof(KdTreeNode) + indices_.size() * sizeof(uint)
+            + leaves_.memory_bytes() + objects_.size() * sizeof(shared_ptr<Hittable>);
+        add_info("kd-tree quality: " + format_num(nodes_.size()) + " nodes, " + format_num(leaf_count) + " leaves ("
+            + format_num(empty_count) + " empty), " + STR(references / primitive_count) + " references per primitive, max depth "
+            + STR(max_depth));
+        add_info("  memory: " + format_num(memory_bytes) + " bytes, " + STR(memory_bytes / primitive_count) + " bytes per primitive");
+    }
+};
+
+#endif // !KD_TREE_H
@@ -0,0 +1,396 @@
+/*
+ * 叶节点图元的SoA存储
+ * 线性BVH和多叉BVH的图元已按叶节点顺序排列，其中三角形的三个顶点按同样顺序连续存储为结构数组，
+ * 叶节点求交时顺序读取，只记录最近交点的距离和重心坐标，遍历结束后才经由图元指针为最近交点计算一次属性
+ * SBVH中同一图元可被多个叶节点引用，光线用信箱（mailbox）记录已测试的图元，不再重复求交
+ * 光线包在叶节点中每次取相邻4条（AVX2）或2条（SSE2）光线，用SIMD同时与一个三角形求交，运算与单条光线的求交逐条对应，结果相同
+ */
+#ifndef LEAF_PRIMITIVES_H
+#define LEAF_PRIMITIVES_H
+
+#include "triangle.h"
+#include "triangle_simd.h"
+
+// 参见 Amanatides & Woo 1987, Mailboxing
+// 每条光线最近测试过的图元编号，环形覆盖
+// 叶节点相邻，重复引用通常在很近的叶节点中出现，容量不必大
+class Mailbox
+{
+private:
+    static const int kSize = 8;
+
+    uint ids_[kSize];
+    int next_ = 0;
+    int count_ = 0;
+
+public:
+    // 图元id已测试过时返回true，否则记录并返回false
+    bool test_and_set(uint id)
+    {
+        for (int i = 0; i < count_; ++i)
+        {
+            if (ids_[i] == id)
+                return true;
+        }
+
+        ids_[next_] = id;
+        next_ = (next_ + 1) % kSize;
+        count_ = std::min(count_ + 1, kSize);
+        return false;
+    }
+};
+
+class LeafPrimitives
+{
+private:
+    static const int kBlockSize = 4;
+
+    // 每4个相邻位置的三角形三个顶点，块内按分量SoA存储为real，非三角形图元处不使用
+    // 叶节点图元连续，一个叶节点只读取一两个相邻的块
+    struct TriangleBlock
+    {
+        real v0[3][kBlockSize];
+        real v1[3][kBlockSize];
+        real v2[3][kBlockSize];
+    };
+
+    std::vector<TriangleBlock> blocks_;
+    std::vector<uchar> is_triangle_;
+    std::vector<uint> ids_; // 各位置图元去重后的编号，仅在图元被重复引用时使用
+    SimdLevel simd_ = cpu_simd_level(); // 光线包求交使用的指令集
+
+public:
+    // objects为按叶节点顺序排列的图元，indices为其在原图元列表中的编号
+    void build(const std::vector<shared_ptr<Hittable>>& objects, const std::vector<uint>& indices, bool duplicated)
+    {
+        size_t size = objects.size();
+        blocks_.assign((size + kBlockSize - 1) / kBlockSize, TriangleBlock{});
+        is_triangle_.assign(size, 0);
+        ids_.clear();
+        if (duplicated)
+            ids_ = indices;
+
+        refit(objects);
+    }
+
+    // 三角形顶点移动后更新
+    void refit(const std::vector<shared_ptr<Hittable>>& objects)
+    {
+        int size = static_cast<int>(objects.size());
+#pragma omp parallel for
+        for (int i = 0; i < size; ++i)
+        {
+            const Triangle* triangle = dynamic_cast<const Triangle*>(objects[i].get());
+            is_triangle_[i] = triangle != nullptr;
+            if (triangle == nullptr)
+                continue;
+
+            Point3 v0, v1, v2;
+            triangle->get_vertices(v0, v1, v2);
+            TriangleBlock& block = blocks_[i / kBlockSize];
+            int lane = i % kBlockSize;
+            for (int a = 0; a < 3; ++a)
+            {
+                block.v0[a][lane] = v0[a];
+                block.v1[a][lane] = v1[a];
+                block.v2[a][lane] = v2[a];
+            }
+        }
+    }
+
+    bool is_triangle(uint i)
+        const
+    {
+        return is_triangle_[i] != 0;
+    }
+
+    bool duplicated()
+        const
+    {
+        return !ids_.empty();
+    }
+
+    uint id(uint i)
+        const
+    {
+        return ids_[i];
+    }
+
+    size_t memory_bytes()
+        const
+    {
+        return blocks_.size() * sizeof(TriangleBlock) + is_triangle_.size() * sizeof(uchar) + ids_.size() * sizeof(uint);
+    }
+
+    // 位置i处三角形在区间内是否有交点，与TriangleMesh::hit的判定完全一致
+    bool intersect(uint i, const WatertightRay& ray, const Interval& interval)
+        const
+    {
+        double t_hit, bc1, bc2;
+        return intersect(i, ray, interval, t_hit, bc1, bc2);
+    }
+
+    bool intersect(uint i, const WatertightRay& ray, const Interval& interval, double& t_hit, double& bc1, double& bc2)
+        const
+    {
+        const TriangleBlock& block = blocks_[i / kBlockSize];
+        uint lane = i % kBlockSize;
+        return TriangleMesh::intersect(
+            Point3(block.v0[0][lane], block.v0[1][lane], block.v0[2][lane]),
+            Point3(block.v1[0][lane], block.v1[1][lane], block.v1[2][lane]),
+            Point3(block.v2[0][lane], block.v2[1][lane], block.v2[2][lane]),
+            ray, interval, t_hit, bc1, bc2);
+    }
+
+    // 位置i处图元求交，三角形使用SoA数据，只记录交点，属性在遍历结束后由Hittable::resolve计算
+    bool intersect(const std::vector<shared_ptr<Hittable>>& objects, uint i, const Ray& r, const WatertightRay& ray,
+        const Interval& interval, DeferredHit& deferred, HitRecord& rec)
+        const
+    {
+        if (!is_triangle(i))
+            return objects[i]->intersect(r, interval, deferred, rec);
+
+        double t_hit, bc1, bc2;
+        if (!intersect(i, ray, interval, t_hit, bc1, bc2))
+            return false;
+
+        deferred = { objects[i].get(), t_hit, bc1, bc2, 0 };
+        return true;
+    }
+
+    // 叶节点[begin,end)的图元与光线包中active列出的光线求交，更近的交点写入packet.t_max和deferred
+    // 相邻光线分组，整组依次与叶节点各图元求交，不活跃的通道由掩码去掉，每条光线测试图元的顺序不变
+    void intersect_packet(const std::vector<shared_ptr<Hittable>>& objects, uint begin, uint end,
+        RayPacket& packet, const int* active, int count, DeferredHit* deferred)
+        const
+    {
+#if defined(SIMD_X86)
+        if (simd_ != SimdLevel_Scalar)
+        {
+            // active按序号递增，相邻光线每width条一组
+            const int width = simd_ == SimdLevel_AVX2 ? 4 : 2;
+            for (int n = 0; n < count; )
+            {
+                int first = active[n] / width * width;
+                uint lanes = 0;
+                for (; n < count && active[n] < first + width; ++n)
+                    lanes |= 1u << (active[n] - first);
+
+                if (!simd_group(packet, first, lanes))
+                {
+                    for (uint i = begin; i < end; ++i)
+                        intersect_lanes(objects, i, packet, first, lanes, deferred);
+                }
+                else if (simd_ == SimdLevel_AVX2)
+                    intersect_group_avx2(objects, begin, end, packet, first, lanes, deferred);
+                else
+                    intersect_group_sse(objects, begin, end, packet, first, lanes, deferred);
+            }
+            return;
+        }
+#endif
+
+        for (uint i = begin; i < end; ++i)
+        {
+            for (int n = 0; n < count; ++n)
+            {
+                int k = active[n];
+                if (intersect(objects, i, packet.rays[k], packet.watertight[k], Interval(packet.t_min, packet.t_max[k]), deferred[k], packet.recs[k]))
+                    record_hit(packet, k, deferred[k]);
+            }
+        }
+    }
+
+    // 遍历结束后只为各光线的最近交点计算属性
+    static void resolve_packet(RayPacket& packet, const DeferredHit* deferred)
+    {
+        for (int k = 0; k < packet.size; ++k)
+            Hittable::resolve(packet.rays[k], deferred[k], packet.recs[k]);
+    }
+
+private:
+    // 位置i处图元与光线first + l逐条求交，l为lanes中置位的通道
+    void intersect_lanes(const std::vector<shared_ptr<Hittable>>& objects, uint i, RayPacket& packet, int first, uint lanes,
+        DeferredHit* deferred)
+        const
+    {
+        for (; lanes != 0; lanes &= lanes - 1)
+        {
+            int k = first + lowest_bit(lanes);
+            if (intersect(objects, i, packet.rays[k], packet.watertight[k], Interval(packet.t_min, packet.t_max[k]), deferred[k], packet.recs[k]))
+                record_hit(packet, k, deferred[k]);
+        }
+    }
+
+    // 组内至少两条活跃光线且剪切轴相同时用SIMD求交，三角形顶点分量可直接广播；相干光线包通常满足
+    static bool simd_group(const RayPacket& packet, int first, uint lanes)
+    {
+        if ((lanes & (lanes - 1)) == 0)
+            return false;
+        const WatertightRay& w0 = packet.watertight[first + lowest_bit(lanes)];
+        for (uint rest = lanes; rest != 0; rest &= rest - 1)
+        {
+            const WatertightRay& w = packet.watertight[first + lowest_bit(rest)];
+            if (w.kx != w0.kx || w.ky != w0.ky || w.kz != w0.kz)
+                return false;
+        }
+        return true;
+    }
+
+    static void record_hit(RayPacket& packet, int k, const DeferredHit& deferred)
+    {
+        packet.hits[k] = true;
+        packet.t_max[k] = static_cast<real>(deferred.t);
+    }
+
+    static int lowest_bit(uint bits)
+    {
+        int bit = 0;
+        while ((bits & 1) == 0)
+        {
+            bits >>= 1;
+            ++bit;
+        }
+        return bit;
+    }
+
+#if defined(SIMD_X86)
+    // 光线first起的4条与叶节点各图元求交，三角形与TriangleMesh::intersect的运算逐条对应，非三角形图元逐条求交
+    SIMD_AVX2
+    void intersect_group_avx2(const std::vector<shared_ptr<Hittable>>& objects, uint begin, uint end,
+        RayPacket& packet, int first, uint lanes, DeferredHit* deferred)
+        const
+    {
+        const WatertightRay& axes = packet.watertight[first + lowest_bit(lanes)];
+        const int kx = axes.kx, ky = axes.ky, kz = axes.kz;
+        const __m256d zero = _mm256_setzero_pd();
+        const __m256d ox = _mm256_load_pd(packet.shear_origin[0] + first);
+        const __m256d oy = _mm256_load_pd(packet.shear_origin[1] + first);
+        const __m256d oz = _mm256_load_pd(packet.shear_origin[2] + first);
+        const __m256d sx = _mm256_load_pd(packet.shear[0] + first);
+        const __m256d sy = _mm256_load_pd(packet.shear[1] + first);
+        const __m256d sz = _mm256_load_pd(packet.shear[2] + first);
+        const __m256d t_min = _mm256_set1_pd(packet.t_min);
+
+        for (uint i = begin; i < end; ++i)
+        {
+            if (!is_triangle(i))
+            {
+                intersect_lanes(objects, i, packet, first, lanes, deferred);
+                continue;
+            }
+
+            const TriangleBlock& block = blocks_[i / kBlockSize];
+            uint lane = i % kBlockSize;
+            __m256d az = _mm256_sub_pd(_mm256_set1_pd(block.v0[kz][lane]), oz);
+            __m256d bz = _mm256_sub_pd(_mm256_set1_pd(block.v1[kz][lane]), oz);
+            __m256d cz = _mm256_sub_pd(_mm256_set1_pd(block.v2[kz][lane]), oz);
+            __m256d ax = _mm256_sub_pd(_mm256_sub_pd(_mm256_set1_pd(block.v0[kx][lane]), ox), _mm256_mul_pd(sx, az));
+            __m256d ay = _mm256_sub_pd(_mm256_sub_pd(_mm256_set1_pd(block.v0[ky][lane]), oy), _mm256_mul_pd(sy, az));
+            __m256d bx = _mm256_sub_pd(_mm256_sub_pd(_mm256_set1_pd(block.v1[kx][lane]), ox), _mm256_mul_pd(sx, bz));
+            __m256d by = _mm256_sub_pd(_mm256_sub_pd(_mm256_set1_pd(block.v1[ky][lane]), oy), _mm256_mul_pd(sy, bz));
+            __m256d cx = _mm256_sub_pd(_mm256_sub_pd(_mm256_set1_pd(block.v2[kx][lane]), ox), _mm256_mul_pd(sx, cz));
+            __m256d cy = _mm256_sub_pd(_mm256_sub_pd(_mm256_set1_pd(block.v2[ky][lane]), oy), _mm256_mul_pd(sy, cz));
+
+            __m256d u = _mm256_sub_pd(_mm256_mul_pd(cx, by), _mm256_mul_pd(cy, bx));
+            __m256d v = _mm256_sub_pd(_mm256_mul_pd(ax, cy), _mm256_mul_pd(ay, cx));
+            __m256d w = _mm256_sub_pd(_mm256_mul_pd(bx, ay), _mm256_mul_pd(by, ax));
+            __m256d negative = _mm256_or_pd(_mm256_or_pd(_mm256_cmp_pd(u, zero, _CMP_LT_OQ), _mm256_cmp_pd(v, zero, _CMP_LT_OQ)),
+                _mm256_cmp_pd(w, zero, _CMP_LT_OQ));
+            __m256d positive = _mm256_or_pd(_mm256_or_pd(_mm256_cmp_pd(u, zero, _CMP_GT_OQ), _mm256_cmp_pd(v, zero, _CMP_GT_OQ)),
+                _mm256_cmp_pd(w, zero, _CMP_GT_OQ));
+
+            __m256d det = _mm256_add_pd(_mm256_add_pd(u, v), w);
+            __m256d inv_det = _mm256_div_pd(_mm256_set1_pd(1.), det);
+            __m256d t = _mm256_mul_pd(_mm256_mul_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(u, az), _mm256_mul_pd(v, bz)),
+                _mm256_mul_pd(w, cz)), sz), inv_det);
+            __m256d t_max = _mm256_set_pd(packet.t_max[first + 3], packet.t_max[first + 2], packet.t_max[first + 1], packet.t_max[first]);
+            __m256d valid = _mm256_andnot_pd(_mm256_and_pd(negative, positive), _mm256_cmp_pd(det, zero, _CMP_NEQ_UQ));
+            valid = _mm256_and_pd(valid, _mm256_and_pd(_mm256_cmp_pd(t, t_min, _CMP_GT_OQ), _mm256_cmp_pd(t, t_max, _CMP_LT_OQ)));
+
+            uint hits = static_cast<uint>(_mm256_movemask_pd(valid)) & lanes;
+            if (hits == 0)
+                continue;
+
+            alignas(32) double ts[4], bc1s[4], bc2s[4];
+            _mm256_store_pd(ts, t);
+            _mm256_store_pd(bc1s, _mm256_mul_pd(v, inv_det));
+            _mm256_store_pd(bc2s, _mm256_mul_pd(w, inv_det));
+            for (; hits != 0; hits &= hits - 1)
+            {
+                int l = lowest_bit(hits);
+                deferred[first + l] = { objects[i].get(), ts[l], bc1s[l], bc2s[l], 0 };
+                record_hit(packet, first + l, deferred[first + l]);
+            }
+        }
+    }
+
+    // 与intersect_group_avx2相同，每次2条光线
+    void intersect_group_sse(const std::vector<shared_ptr<Hittable>>& objects, uint begin, uint end,
+        RayPacket& packet, int first, uint lanes, DeferredHit* deferred)
+        const
+    {
+        const WatertightRay& axes = packet.watertight[first + lowest_bit(lanes)];
+        const int kx = axes.kx, ky = axes.ky, kz = axes.kz;
+        const __m128d zero = _mm_setzero_pd();
+        const __m128d ox = _mm_load_pd(packet.shear_origin[0] + first);
+        const __m128d oy = _mm_load_pd(packet.shear_origin[1] + first);
+        const __m128d oz = _mm_load_pd(packet.shear_origin[2] + first);
+        const __m128d sx = _mm_load_pd(packet.shear[0] + first);
+        const __m128d sy = _mm_load_pd(packet.shear[1] + first);
+        const __m128d sz = _mm_load_pd(packet.shear[2] + first);
+        const __m128d t_min = _mm_set1_pd(packet.t_min);
+
+        for (uint i = begin; i < end; ++i)
+        {
+            if (!is_triangle(i))
+            {
+                intersect_lanes(objects, i, packet, first, lanes, deferred);
+                continue;
+            }
+
+            const TriangleBlock& block = blocks_[i / kBlockSize];
+            uint lane = i % kBlockSize;
+            __m128d az = _mm_sub_pd(_mm_set1_pd(block.v0[kz][lane]), oz);
+            __m128d bz = _mm_sub_pd(_mm_set1_pd(block.v1[kz][lane]), oz);
+            __m128d cz = _mm_sub_pd(_mm_set1_pd(block.v2[kz][lane]), oz);
+            __m128d ax = _mm_sub_pd(_mm_sub_pd(_mm_set1_pd(block.v0[kx][lane]), ox), _mm_mul_pd(sx, az));
+            __m128d ay = _mm_sub_pd(_mm_sub_pd(_mm_set1_pd(block.v0[ky][lane]), oy), _mm_mul_pd(sy, az));
+            __m128d bx = _mm_sub_pd(_mm_sub_pd(_mm_set1_pd(block.v1[kx][lane]), ox), _mm_mul_pd(sx, bz));
+            __m128d by = _mm_sub_pd(_mm_sub_pd(_mm_set1_pd(block.v1[ky][lane]), oy), _mm_mul_pd(sy, bz));
+            __m128d cx = _mm_sub_pd(_mm_sub_pd(_mm_set1_pd(block.v2[kx][lane]), ox), _mm_mul_pd(sx, cz));
+            __m128d cy = _mm_sub_pd(_mm_sub_pd(_mm_set1_pd(block.v2[ky][lane]), oy), _mm_mul_pd(sy, cz));
+
+            __m128d u = _mm_sub_pd(_mm_mul_pd(cx, by), _mm_mul_pd(cy, bx));
+            __m128d v = _mm_sub_pd(_mm_mul_pd(ax, cy), _mm_mul_pd(ay, cx));
+            __m128d w = _mm_sub_pd(_mm_mul_pd(bx, ay), _mm_mul_pd(by, ax));
+            __m128d negative = _mm_or_pd(_mm_or_pd(_mm_cmplt_pd(u, zero), _mm_cmplt_pd(v, zero)), _mm_cmplt_pd(w, zero));
+            __m128d positive = _mm_or_pd(_mm_or_pd(_mm_cmpgt_pd(u, zero), _mm_cmpgt_pd(v, zero)), _mm_cmpgt_pd(w, zero));
+
+            __m128d det = _mm_add_pd(_mm_add_pd(u, v), w);
+            __m128d inv_det = _mm_div_pd(_mm_set1_pd(1.), det);
+            __m128d t = _mm_mul_pd(_mm_mul_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(u, az), _mm_mul_pd(v, bz)), _mm_mul_pd(w, cz)), sz), inv_det);
+            __m128d t_max = _mm_set_pd(packet.t_max[first + 1], packet.t_max[first]);
+            __m128d valid = _mm_andnot_pd(_mm_and_pd(negative, positive), _mm_cmpneq_pd(det, zero));
+            valid = _mm_and_pd(valid, _mm_and_pd(_mm_cmpgt_pd(t, t_min), _mm_cmplt_pd(t, t_max)));
+
+            uint hits = static_cast<uint>(_mm_movemask_pd(valid)) & lanes;
+            if (hits == 0)
+                continue;
+
+            alignas(16) double ts[2], bc1s[2], bc2s[2];
+            _mm_store_pd(ts, t);
+            _mm_store_pd(bc1s, _mm_mul_pd(v, inv_det));
+            _mm_store_pd(bc2s, _mm_mul_pd(w, inv_det));
+            for (; hits != 0; hits &= hits - 1)
+            {
+                int l = lowest_bit(hits);
+                deferred[first + l] = { objects[i].get(), ts[l], bc1s[l], bc2s[l], 0 };
+                record_hit(packet, first + l, deferred[first + l]);
+            }
+        }
+    }
+#endif
+};
+
+#endif // !LEAF_PRIMITIVES_H
@@ -0,0 +1,418 @@
+/*
+ * 线性BVH类
+ * 将构建结果按深度优先顺序压缩为连续的节点数组，遍历时用栈迭代，不再追踪指针
+ */
+#ifndef LINEAR_BVH_H
+#define LINEAR_BVH_H
+
+#include "bvh_node.h"
+#include "leaf_primitives.h"
+
+// 转为不大于d的单精度数
+inline float round_down_float(double d)
+{
+    float f = static_cast<float>(d);
+    return (f > d) ? std::nextafter(f, -std::numeric_limits<float>::infinity()) : f;
+}
+
+// 转为不小于d的单精度数
+inline float round_up_float(double d)
+{
+    float f = static_cast<float>(d);
+    return (f < d) ? std::nextafter(f, std::numeric_limits<float>::infinity()) : f;
+}
+
+// 转为不大于d的real，遍历区间下限
+inline real round_down_real(double d)
+{
+    real f = static_cast<real>(d);
+    return (f > d) ? std::nextafter(f, -std::numeric_limits<real>::infinity()) : f;
+}
+
+// 转为不小于d的real，遍历区间上限
+inline real round_up_real(double d)
+{
+    real f = static_cast<real>(d);
+    return (f < d) ? std::nextafter(f, std::numeric_limits<real>::infinity()) : f;
+}
+
+// 32字节节点
+// 深度优先顺序下左子节点紧随父节点之后，只需记录右子节点索引
+struct LinearBVHNode
+{
+    float  bbox_min[3];
+    float  bbox_max[3];
+    uint   offset;       // 内部节点：右子节点索引；叶节点：首个图元索引
+    ushort object_count; // 叶节点图元数，内部节点为0
+    uchar  axis;         // 划分轴
+    uchar  pad;
+};
+
+static_assert(sizeof(LinearBVHNode) == 32, "LinearBVHNode should be 32 bytes");
+
+class LinearBVH : public Hittable
+{
+private:
+    static const int kStackSize = BVHBuilder::kMaxDepth + 1; // 构建器限制了树深，栈不会溢出
+    static const int kRefitTaskDepth = 3; // refit时此深度以上的右子树作为并行任务
+
+    std::vector<LinearBVHNode> nodes_;
+    std::vector<shared_ptr<Hittable>> objects_; // 按叶节点顺序排列的图元
+    LeafPrimitives leaves_; // 叶节点中三角形的SoA数据
+    AABB bbox_;
+    BVHBuildOption option_;
+    bool duplicated_ = false; // SBVH中图元可能被多个叶节点引用
+    double built_sah_cost_ = 0.; // 构建时的SAH代价，用于判断refit后是否需要重建
+
+public:
+    LinearBVH() = delete;
+
+    LinearBVH(const HittableList& list, const BVHBuildOption& option)
+        : option_(option)
+    {
+        build(list.get_objects());
+    }
+
+    LinearBVH(const LinearBVH&) = delete;
+    LinearBVH& operator=(const LinearBVH&) = delete;
+
+    LinearBVH(LinearBVH&&) = delete;
+    LinearBVH& operator=(LinearBVH&&) = delete;
+
+public:
+    bool hit(const Ray& r, const Interval& interval, HitRecord& rec)
+        const override
+    {
+        if (nodes_.empty())
+            return false;
+
+        const WatertightRay watertight(r);
+        Point3 origin = r.get_origin();
+        Vec3 inv_dir = 1. / r.get_direction();
+        double closest_so_far = interval.get_max();
+        bool hit_anything = false;
+        DeferredHit deferred;
+        const bool dir_is_neg[3] = { inv_dir[0] < 0, inv_dir[1] < 0, inv_dir[2] < 0 };
+        const bool ordered = option_.layout.ordered_traversal;
+        ullong visited = 0, tested = 0;
+        Mailbox mailbox;
+
+        uint stack[kStackSize];
+        int top = 0;
+        uint index = 0;
+
+        while (true)
+        {
+            const LinearBVHNode& node = nodes_[index];
+            ++visited;
+            if (node_hit(node, origin, inv_dir, interval.get_min(), closest_so_far))
+            {
+                if (node.object_count > 0)
+                {
+                    for (uint i = node.offset; i < node.offset + node.object_count; ++i)
+                    {
+                        if (leaves_.duplicated() && mailbox.test_and_set(leaves_.id(i)))
+                            continue;
+                        ++tested;
+                        if (leaves_.intersect(objects_, i, r, watertight, Interval(interval.get_min(), closest_so_far), deferred, rec))
+                        {
+                            hit_anything = true;
+                            closest_so_far = deferred.t;
+                        }
+                    }
+                }
+                else if (ordered && dir_is_neg[node.axis])
+                {
+                    // 光线沿划分轴负方向时右子节点较近，先访问
+                    stack[top++] = index + 1;
+                    index = node.offset;
+                    continue;
+                }
+                else
+                {
+                    stack[top++] = node.offset;
+                    index = index + 1;
+                    continue;
+                }
+            }
+
+            if (top == 0)
+                break;
+            index = stack[--top];
+        }
+
+        record_traversal(visited, tested);
+        if (hit_anything)
+            resolve(r, deferred, rec);
+        return hit_anything;
+    }
+
+    // 整包遍历，栈中同时记录子树的首条活跃光线，按首条活跃光线的方向先访问近处子节点
+    void hit_packet(RayPacket& packet)
+        const override
+    {
+        struct StackEntry
+        {
+            uint index;
+            int first;
+        };
+
+        if (nodes_.empty() || packet.size == 0)
+            return;
+
+        DeferredHit deferred[RayPacket::kMaxSize];
+        ullong visited = 0, tested = 0;
+        double t_near;
+
+        StackEntry stack[kStackSize];
+        int top = 0;
+        StackEntry entry = { 0, 0 };
+
+        while (true)
+        {
+            const LinearBVHNode& node = nodes_[entry.index];
+            ++visited;
+            int first = packet.first_hit(node.bbox_min, node.bbox_max, entry.first, t_near);
+            if (first < packet.size)
+            {
+                if (node.object_count > 0)
+                {
+                    int active[RayPacket::kMaxSize];
+                    int count = packet.active_rays(node.bbox_min, node.bbox_max, first, active);
+                    tested += static_cast<ullong>(node.object_count) * count;
+                    leaves_.intersect_packet(objects_, node.offset, node.offset + node.object_count, packet, active, count, deferred);
+                }
+                else if (option_.layout.ordered_traversal && packet.inv_dir[node.axis][first] < 0)
+                {
+                    stack[top++] = { entry.index + 1, first };
+                    entry = { node.offset, first };
+                    continue;
+                }
+                else
+                {
+                    stack[top++] = { node.offset, first };
+                    entry = { entry.index + 1, first };
+                    continue;
+                }
+            }
+
+            if (top == 0)
+                break;
+            entry = stack[--top];
+        }
+
+        LeafPrimitives::resolve_packet(packet, deferred);
+        record_traversal(visited, tested);
+    }
+
+    // 找到任意交点即返回，不需要按远近顺序访问子节点
+    bool occluded(const Ray& r, const Interval& interval)
+        const override
+    {
+        if (nodes_.empty())
+            return false;
+
+        const WatertightRay watertight(r);
+        Point3 origin = r.get_origin();
+        Vec3 inv_dir = 1. / r.get_direction();
+        ullong visited = 0, tested = 0;
+        bool hit_anything = false;
+
+        uint stack[kStackSize];
+        int top = 0;
+        uint index = 0;
+
+        while (true)
+        {
+            const LinearBVHNode& node = nodes_[index];
+            ++visited;
+            if (node_hit(node, origin, inv_dir, interval.get_min(), interval.get_max()))
+            {
+                if (node.object_count == 0)
+                {
+                    stack[top++] = node.offset;
+                    index = index + 1;
+                    continue;
+                }
+
+                for (uint i = node.offset; i < node.offset + node.object_count && !hit_anything; ++i, ++tested)
+                    hit_anything = leaves_.is_triangle(i) ? leaves_.intersect(i, watertight, interval) : objects_[i]->occluded(r, interval);
+                if (hit_anything)
+                    break;
+            }
+
+            if (top == 0)
+                break;
+            index = stack[--top];
+        }
+
+        record_traversal(visited, tested);
+        return hit_anything;
+    }
+
+    AABB get_bbox()
+        const override
+    {
+        return bbox_;
+    }
+
+    // 保持树结构，自底向上更新节点包围盒
+    // SAH代价相比构建时增长超过refit_threshold倍时完全重建
+    void refit()
+        override
+    {
+        if (nodes_.empty())
+            return;
+
+        refit_objects(objects_, duplicated_);
+        leaves_.refit(objects_);
+        bbox_ = refit_node(0, 0);
+
+        double cost = sah_cost();
+        if (cost > built_sah_cost_ * option_.layout.refit_threshold)
+        {
+            add_info("BVH SAH cost "_str + STR(built_sah_cost_) + " -> " + STR(cost) + " after refit, rebuild.");
+            option_.builder.mesh_hash = 0; // 几何已改变，不能再用缓存
+            build(duplicated_ ? unique_objects(objects_) : std::vector<shared_ptr<Hittable>>(objects_));
+        }
+    }
+
+    // 与BVHBuilder::sah_cost相同，按单精度节点包围盒计算
+    double sah_cost()
+        const
+    {
+        double root_area = nodes_.empty() ? 0. : node_bbox(nodes_[0]).surface_area();
+        if (root_area <= 0)
+            return 0.;
+
+        double cost = 0.;
+        for (const LinearBVHNode& node : nodes_)
+            cost += node_bbox(node).surface_area() * (node.object_count > 0 ? node.object_count : option_.builder.traversal_cost);
+        return cost / root_area;
+    }
+
+    // 以下节点操作MeshBVH共用
+    static AABB node_bbox(const LinearBVHNode& node)
+    {
+        return AABB(
+            Interval(node.bbox_min[0], node.bbox_max[0]),
+            Interval(node.bbox_min[1], node.bbox_max[1]),
+            Interval(node.bbox_min[2], node.bbox_max[2]));
+    }
+
+    // 单精度存储包围盒，向外取整保证包围盒不变小
+    static LinearBVHNode make_node(const AABB& bbox)
+    {
+        LinearBVHNode node = {};
+        for (int a = 0; a < 3; ++a)
+        {
+            node.bbox_min[a] = round_down_float(bbox.axis(a).get_min());
+            node.bbox_max[a] = round_up_float(bbox.axis(a).get_max());
+        }
+        return node;
+    }
+
+    // 参见 PBRT 6.1.2
+    // 以real计算，离开距离放大1+2*gamma(3)倍，保证舍入误差不会漏掉实际击中的包围盒
+    static bool node_hit(const LinearBVHNode& node, const Point3& origin, const Vec3& inv_dir, double t_min, double t_max)
+    {
+        real t_enter = static_cast<real>(t_min), t_exit = static_cast<real>(t_max);
+        for (int a = 0; a < 3; ++a)
+        {
+            real t0 = (node.bbox_min[a] - origin[a]) * inv_dir[a];
+            real t1 = (node.bbox_max[a] - origin[a]) * inv_dir[a];
+
+            if (inv_dir[a] < 0)
+                std::swap(t0, t1);
+            t1 *= 1 + 2 * error_gamma(3);
+
+            if (t0 > t_enter) t_enter = t0;
+            if (t1 < t_exit) t_exit = t1;
+
+            if (t_exit <= t_enter)
+                return false;
+        }
+        return true;
+    }
+
+private:
+    void build(const std::vector<shared_ptr<Hittable>>& objects)
+    {
+        BVHBuilder builder(objects, option_.builder);
+        duplicated_ = builder.get_indices().size() != objects.size();
+
+        bbox_ = AABB();
+        for (const auto& object : objects)
+            bbox_ = AABB(bbox_, object->get_bbox());
+
+        // 图元按叶节点顺序重排
+        objects_.clear();
+        objects_.reserve(builder.get_indices().size());
+        for (uint i : builder.get_indices())
+            objects_.emplace_back(objects[i]);
+        leaves_.build(objects_, builder.get_indices(), duplicated_);
+
+        int depth = flatten(builder.get_nodes());
+        assert(depth < kStackSize);
+        built_sah_cost_ = sah_cost();
+
+        if (option_.quality_report)
+            builder.report_quality("linear BVH", nodes_.size() * sizeof(LinearBVHNode) + leaves_.memory_bytes()
+                + objects_.size() * sizeof(shared_ptr<Hittable>));
+    }
+
+    // 返回节点index的新包围盒，左子节点紧随其后，右子节点为offset
+    AABB refit_node(uint index, int depth)
+    {
+        LinearBVHNode& node = nodes_[index];
+        AABB bbox;
+
+        if (node.object_count > 0)
+        {
+            for (uint i = node.offset; i < node.offset + node.object_count; ++i)
+                bbox = AABB(bbox, objects_[i]->get_bbox());
+        }
+        else if (depth < kRefitTaskDepth)
+        {
+            auto right = std::async(std::launch::async, [this, &node, depth] { return refit_node(node.offset, depth + 1); });
+            AABB left = refit_node(index + 1, depth + 1);
+            bbox = AABB(left, right.get());
+        }
+        else
+        {
+            bbox = AABB(refit_node(index + 1, depth + 1), refit_node(node.offset, depth + 1));
+        }
+
+        LinearBVHNode bounds = make_node(bbox);
+        std::copy(bounds.bbox_min, bounds.bbox_min + 3, node.bbox_min);
+        std::copy(bounds.bbox_max, bounds.bbox_max + 3, node.bbox_max);
+        return bbox;
+    }
+
+    // 参见 PBRT 4.4
+    // 构建结果已是深度优先顺序，逐个转换为32字节节点，返回树深度
+    int flatten(const std::vector<BVHBuildNode>& build_nodes)
+    {
+        nodes_.resize(build_nodes.size());
+        std::vector<int> depths(build_nodes.size(), 0);
+        int max_depth = 0;
+
+        for (size_t i = 0; i < build_nodes.size(); ++i)
+        {
+            const BVHBuildNode& b = build_nodes[i];
+            LinearBVHNode& node = nodes_[i];
+            node = make_node(b.bbox);
+            node.offset = b.offset;
+            node.object_count = static_cast<ushort>(b.count);
+            node.axis = static_cast<uchar>(b.axis);
+
+            max_depth = std::max(max_depth, depths[i]);
+            if (b.count == 0)
+                depths[i + 1] = depths[b.offset] = depths[i] + 1;
+        }
+
+        return max_depth;
+    }
+};
+
+#endif // !LINEAR_BVH_H
@@ -0,0 +1,352 @@
+/*
+ * 网格BVH类
+ * 整个三角形网格作为一个图元加入场景，内部按面编号构建线性BVH，不为每个三角形创建图元对象
+ * 求交所需的三角形顶点按叶节点顺序预先取出，每个叶节点占整数个4三角形的单精度SoA块，
+ * 叶节点求交时不再经由索引读取顶点，用SIMD一次与叶节点的4或8个三角形求交
+ */
+#ifndef MESH_BVH_H
+#define MESH_BVH_H
+
+#include "linear_bvh.h"
+#include "triangle_mesh.h"
+#include "triangle_simd.h"
+
+class MeshBVH : public Hittable
+{
+private:
+    static const int kStackSize = BVHBuilder::kMaxDepth + 1; // 构建器限制了树深，栈不会溢出
+
+    shared_ptr<const TriangleMesh> mesh_;
+    std::vector<LinearBVHNode> nodes_; // 叶节点offset为首个三角形块的索引
+    std::vector<TriangleBlock4> blocks_; // 按叶节点顺序排列的三角形顶点和面编号，网格顶点本为单精度，取出时没有误差
+    AABB bbox_;
+    BVHBuildOption option_;
+    SimdLevel simd_; // 叶节点求交使用的指令集
+
+public:
+    MeshBVH() = delete;
+
+    // 不做空间划分，其余构建参数与LinearBVH相同
+    // 叶节点最多为一次求交的三角形数（AVX2为8个，否则为一块4个），
+    // SAH以逐个求交一个三角形的代价为1，一次求交一组时节点遍历相对更贵，按组大小放大遍历代价，叶节点更大更浅，块中空位也更少
+    MeshBVH(shared_ptr<const TriangleMesh> mesh, const BVHBuildOption& option)
+        : mesh_(mesh), option_(option), simd_(option.layout.simd_triangles ? simd_level_for<real>() : SimdLevel_Scalar)
+    {
+        int lanes = simd_ == SimdLevel_AVX2 ? 8 : 4;
+        option_.builder.spatial_splits = false;
+        option_.builder.max_leaf_size = lanes;
+        option_.builder.traversal_cost *= lanes * .75;
+        build();
+
+        double face_count = static_cast<double>(std::max<uint>(mesh_->face_count(), 1));
+        add_info("mesh bytes per triangle: vertices and indices " + STR(mesh_->memory_bytes() / face_count)
+            + ", BVH " + STR(nodes_.size() * sizeof(LinearBVHNode) / face_count)
+            + ", leaf triangles " + STR(blocks_.size() * sizeof(TriangleBlock4) / face_count));
+        add_info("mesh triangle kernel: " + simd_level_name(simd_));
+    }
+
+    MeshBVH(const MeshBVH&) = delete;
+    MeshBVH& operator=(const MeshBVH&) = delete;
+
+    MeshBVH(MeshBVH&&) = delete;
+    MeshBVH& operator=(MeshBVH&&) = delete;
+
+public:
+    bool hit(const Ray& r, const Interval& interval, HitRecord& rec)
+        const override
+    {
+        DeferredHit deferred;
+        if (!intersect(r, interval, deferred, rec))
+            return false;
+
+        set_hit_record(r, deferred, rec);
+        return true;
+    }
+
+    // 只记录最近交点的面编号和重心坐标，网格在其它加速结构中时交点属性也在整个遍历结束后才计算
+    bool intersect(const Ray& r, const Interval& interval, DeferredHit& deferred, HitRecord& /*rec*/)
+        const override
+    {
+        if (nodes_.empty())
+            return false;
+
+        const WatertightRayReal watertight(WatertightRay{ r });
+        Point3 origin = r.get_origin();
+        Vec3 inv_dir = 1. / r.get_direction();
+        real t_min = static_cast<real>(interval.get_min());
+        real closest_so_far = static_cast<real>(interval.get_max());
+        int closest = -1;
+        real closest_bc1 = 0, closest_bc2 = 0;
+        const bool dir_is_neg[3] = { inv_dir[0] < 0, inv_dir[1] < 0, inv_dir[2] < 0 };
+        const bool ordered = option_.layout.ordered_traversal;
+        ullong visited = 0, tested = 0;
+
+        uint stack[kStackSize];
+        int top = 0;
+        uint index = 0;
+
+        while (true)
+        {
+            const LinearBVHNode& node = nodes_[index];
+            ++visited;
+            if (LinearBVH::node_hit(node, origin, inv_dir, interval.get_min(), closest_so_far))
+            {
+                if (node.object_count > 0)
+                {
+                    tested += node.object_count;
+                    int i = intersect_leaf(node, watertight, t_min, closest_so_far, closest_bc1, closest_bc2);
+                    if (i >= 0)
+                        closest = i;
+                }
+                else if (ordered && dir_is_neg[node.axis])
+                {
+                    // 光线沿划分轴负方向时右子节点较近，先访问
+                    stack[top++] = index + 1;
+                    index = node.offset;
+                    continue;
+                }
+                else
+                {
+                    stack[top++] = node.offset;
+                    index = index + 1;
+                    continue;
+                }
+            }
+
+            if (top == 0)
+                break;
+            index = stack[--top];
+        }
+
+        record_traversal(visited, tested);
+        if (closest < 0)
+            return false;
+
+        deferred = { this, closest_so_far, closest_bc1, closest_bc2, face(closest) };
+        return true;
+    }
+
+    void set_hit_record(const Ray& r, const DeferredHit& deferred, HitRecord& rec)
+        const override
+    {
+        mesh_->set_hit_record(deferred.id, r, deferred.t, deferred.b1, deferred.b2, rec);
+    }
+
+    // 与LinearBVH相同的整包遍历，叶节点只记录各光线最近的面和重心坐标，遍历结束后再计算交点属性
+    void hit_packet(RayPacket& packet)
+        const override
+    {
+        struct StackEntry
+        {
+            uint index;
+            int first;
+        };
+
+        if (nodes_.empty() || packet.size == 0)
+            return;
+
+        WatertightRayReal watertight[RayPacket::kMaxSize];
+        real t_max[RayPacket::kMaxSize];
+        int closest[RayPacket::kMaxSize];
+        real closest_bc1[RayPacket::kMaxSize], closest_bc2[RayPacket::kMaxSize];
+        for (int k = 0; k < packet.size; ++k)
+        {
+            watertight[k] = WatertightRayReal(packet.watertight[k]);
+            t_max[k] = packet.t_max[k];
+            closest[k] = -1;
+        }
+        real t_min = packet.t_min;
+        ullong visited = 0, tested = 0;
+        double t_near;
+
+        StackEntry stack[kStackSize];
+        int top = 0;
+        StackEntry entry = { 0, 0 };
+
+        while (true)
+        {
+            const LinearBVHNode& node = nodes_[entry.index];
+            ++visited;
+            int first = packet.first_hit(node.bbox_min, node.bbox_max, entry.first, t_near);
+            if (first < packet.size)
+            {
+                if (node.object_count > 0)
+                {
+                    int active[RayPacket::kMaxSize];
+                    int count = packet.active_rays(node.bbox_min, node.bbox_max, first, active);
+                    tested += static_cast<ullong>(node.object_count) * count;
+                    for (int n = 0; n < count; ++n)
+                    {
+                        int k = active[n];
+                        int i = intersect_leaf(node, watertight[k], t_min, t_max[k], closest_bc1[k], closest_bc2[k]);
+                        if (i >= 0)
+                        {
+                            packet.t_max[k] = t_max[k];
+                            closest[k] = i;
+                        }
+                    }
+                }
+                else if (option_.layout.ordered_traversal && packet.inv_dir[node.axis][first] < 0)
+                {
+                    stack[top++] = { entry.index + 1, first };
+                    entry = { node.offset, first };
+                    continue;
+                }
+                else
+                {
+                    stack[top++] = { node.offset, first };
+                    entry = { entry.index + 1, first };
+                    continue;
+                }
+            }
+
+            if (top == 0)
+                break;
+            entry = stack[--top];
+        }
+
+        for (int k = 0; k < packet.size; ++k)
+        {
+            if (closest[k] < 0)
+                continue;
+            mesh_->set_hit_record(face(closest[k]), packet.rays[k], t_max[k], closest_bc1[k], closest_bc2[k], packet.recs[k]);
+            packet.hits[k] = true;
+        }
+        record_traversal(visited, tested);
+    }
+
+    // 找到任意交点即返回，不需要按远近顺序访问子节点
+    bool occluded(const Ray& r, const Interval& interval)
+        const override
+    {
+        if (nodes_.empty())
+            return false;
+
+        const WatertightRayReal watertight(WatertightRay{ r });
+        Point3 origin = r.get_origin();
+        Vec3 inv_dir = 1. / r.get_direction();
+        real t_min = static_cast<real>(interval.get_min());
+        ullong visited = 0, tested = 0;
+        bool hit_anything = false;
+
+        uint stack[kStackSize];
+        int top = 0;
+        uint index = 0;
+
+        while (true)
+        {
+            const LinearBVHNode& node = nodes_[index];
+            ++visited;
+            if (LinearBVH::node_hit(node, origin, inv_dir, interval.get_min(), interval.get_max()))
+            {
+                if (node.object_count == 0)
+                {
+                    stack[top++] = node.offset;
+                    index = index + 1;
+                    continue;
+                }
+
+                real t_max = static_cast<real>(interval.get_max()), bc1, bc2;
+                tested += node.object_count;
+                hit_anything = intersect_leaf(node, watertight, t_min, t_max, bc1, bc2) >= 0;
+                if (hit_anything)
+                    break;
+            }
+
+            if (top == 0)
+                break;
+            index = stack[--top];
+        }
+
+        record_traversal(visited, tested);
+        return hit_anything;
+    }
+
+    AABB get_bbox()
+        const override
+    {
+        return bbox_;
+    }
+
+private:
+    void build()
+    {
+        std::vector<AABB> bboxes(mesh_->face_count());
+        for (uint face = 0; face < mesh_->face_count(); ++face)
+        {
+            bboxes[face] = mesh_->face_bbox(face);
+            bbox_ = AABB(bbox_, bboxes[face]);
+        }
+
+        BVHBuilder builder(bboxes, option_.builder);
+        const std::vector<uint>& faces = builder.get_indices();
+        const std::vector<BVHBuildNode>& build_nodes = builder.get_nodes();
+
+        // 每个叶节点从新的块开始，不足4个的空位重复最后一个三角形的顶点v0
+        nodes_.resize(build_nodes.size());
+        blocks_.clear();
+        std::vector<int> depths(build_nodes.size(), 0);
+        for (size_t i = 0; i < build_nodes.size(); ++i)
+        {
+            const BVHBuildNode& b = build_nodes[i];
+            LinearBVHNode& node = nodes_[i];
+            node = LinearBVH::make_node(b.bbox);
+            node.offset = b.offset;
+            node.object_count = static_cast<ushort>(b.count);
+            node.axis = static_cast<uchar>(b.axis);
+            if (b.count == 0)
+            {
+                depths[i + 1] = depths[b.offset] = depths[i] + 1;
+                assert(depths[i] < kStackSize);
+                continue;
+            }
+
+            node.offset = static_cast<uint>(blocks_.size());
+            blocks_.resize(blocks_.size() + block_count(node));
+            for (uint n = 0; n < block_count(node) * 4; ++n)
+            {
+                uint face = faces[b.offset + std::min(n, b.count - 1)];
+                Point3 v0, v1, v2;
+                mesh_->get_vertices(face, v0, v1, v2);
+                if (n >= b.count)
+                    v1 = v2 = v0;
+
+                TriangleBlock4& block = blocks_[node.offset + n / 4];
+                uint lane = n % 4;
+                for (int a = 0; a < 3; ++a)
+                {
+                    block.v0[a][lane] = static_cast<float>(v0[a]);
+                    block.v1[a][lane] = static_cast<float>(v1[a]);
+                    block.v2[a][lane] = static_cast<float>(v2[a]);
+                }
+                block.id[lane] = face;
+            }
+        }
+
+        if (option_.quality_report)
+            builder.report_quality("mesh BVH", nodes_.size() * sizeof(LinearBVHNode) + blocks_.size() * sizeof(TriangleBlock4)
+                + mesh_->memory_bytes());
+    }
+
+    static uint block_count(const LinearBVHNode& node)
+    {
+        return (node.object_count + 3u) / 4u;
+    }
+
+    // 块中位置i处三角形的面编号
+    uint face(int i)
+        const
+    {
+        return blocks_[i / 4].id[i % 4];
+    }
+
+    // 叶节点的全部三角形一次求交，返回最近交点在块中的位置，t_max改为交点距离；未击中返回-1
+    int intersect_leaf(const LinearBVHNode& node, const WatertightRayReal& ray, real t_min, real& t_max, real& bc1, real& bc2)
+        const
+    {
+        int i = TriangleSimd::intersect(&blocks_[node.offset], static_cast<int>(block_count(node)), ray, t_min, t_max, bc1, bc2, simd_);
+        return i < 0 ? -1 : static_cast<int>(node.offset) * 4 + i;
+    }
+};
+
+#endif // !MESH_BVH_H
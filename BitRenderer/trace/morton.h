@@ -0,0 +1,109 @@
+/*
+ * Morton码
+ * 将质心量化到网格后交错各轴的二进制位，按Morton码排序后空间上相近的图元在序列中也相近
+ */
+#ifndef MORTON_H
+#define MORTON_H
+
+#include "vec.h"
+
+struct MortonPrimitive
+{
+    ullong code;
+    uint   index; // 图元索引
+};
+
+// 10位分量的每位之间插入两个0
+inline ullong left_shift3_10(ullong x)
+{
+    x &= 0x3ff;
+    x = (x | (x << 16)) & 0x030000ff;
+    x = (x | (x << 8))  & 0x0300f00f;
+    x = (x | (x << 4))  & 0x030c30c3;
+    x = (x | (x << 2))  & 0x09249249;
+    return x;
+}
+
+// 21位分量的每位之间插入两个0
+inline ullong left_shift3_21(ullong x)
+{
+    x &= 0x1fffff;
+    x = (x | (x << 32)) & 0x001f00000000ffff;
+    x = (x | (x << 16)) & 0x001f0000ff0000ff;
+    x = (x | (x << 8))  & 0x100f00f00f00f00f;
+    x = (x | (x << 4))  & 0x10c30c30c30c30c3;
+    x = (x | (x << 2))  & 0x1249249249249249;
+    return x;
+}
+
+// 参见 PBRT(3rd) 4.3.3
+// p各分量在[0,1]内，bits为30或63，x分量在最高位
+inline ullong encode_morton3(const Vec3& p, int bits)
+{
+    int axis_bits = bits / 3;
+    double scale = static_cast<double>(1ull << axis_bits);
+    ullong max_value = (1ull << axis_bits) - 1;
+
+    ullong q[3];
+    for (int a = 0; a < 3; ++a)
+        q[a] = std::min(static_cast<ullong>(std::max<double>(p[a], 0.) * scale), max_value);
+
+    if (bits == 30)
+        return (left_shift3_10(q[0]) << 2) | (left_shift3_10(q[1]) << 1) | left_shift3_10(q[2]);
+    return (left_shift3_21(q[0]) << 2) | (left_shift3_21(q[1]) << 1) | left_shift3_21(q[2]);
+}
+
+// 码值第bit位对应的轴
+inline int morton_axis(int bit)
+{
+    return 2 - bit % 3;
+}
+
+// LSD基数排序，每趟8位
+// 各块分别统计桶内数量，再按桶、块顺序计算写入位置，结果稳定且与线程数无关
+inline void radix_sort(std::vector<MortonPrimitive>& prims, int bits)
+{
+    const int kBitsPerPass = 8;
+    const int kBucketCount = 1 << kBitsPerPass;
+    const int kChunkSize   = 1 << 14;
+
+    int size = static_cast<int>(prims.size());
+    int chunk_count = (size + kChunkSize - 1) / kChunkSize;
+    std::vector<MortonPrimitive> temp(prims.size());
+    std::vector<std::array<uint, kBucketCount>> offsets(chunk_count);
+
+    for (int shift = 0; shift < bits; shift += kBitsPerPass)
+    {
+#pragma omp parallel for
+        for (int c = 0; c < chunk_count; ++c)
+        {
+            offsets[c].fill(0);
+            int end = std::min(size, (c + 1) * kChunkSize);
+            for (int i = c * kChunkSize; i < end; ++i)
+                ++offsets[c][(prims[i].code >> shift) & (kBucketCount - 1)];
+        }
+
+        uint sum = 0;
+        for (int b = 0; b < kBucketCount; ++b)
+        {
+            for (int c = 0; c < chunk_count; ++c)
+            {
+                uint count = offsets[c][b];
+                offsets[c][b] = sum;
+                sum += count;
+            }
+        }
+
+#pragma omp parallel for
+        for (int c = 0; c < chunk_count; ++c)
+        {
+            int end = std::min(size, (c + 1) * kChunkSize);
+            for (int i = c * kChunkSize; i < end; ++i)
+                temp[offsets[c][(prims[i].code >> shift) & (kBucketCount - 1)]++] = prims[i];
+        }
+
+        prims.swap(temp);
+    }
+}
+
+#endif // !MORTON_H
@@ -0,0 +1,409 @@
+/*
+ * 运动BVH类
+ * 节点分别存储时间段起止时刻的包围盒，求交时按光线时刻线性插值，
+ * 避免运动物体用整个运动范围的包围盒撑大所有祖先节点
+ * 可选时间划分：运动幅度大时将0~1划分为多个时间段，每段各建一棵树
+ */
+#ifndef MOTION_BVH_H
+#define MOTION_BVH_H
+
+#include "linear_bvh.h"
+
+// 56字节节点，除两个时刻的包围盒外与LinearBVHNode相同
+struct MotionBVHNode
+{
+    float  bbox_min[2][3]; // 时间段起止时刻的包围盒
+    float  bbox_max[2][3];
+    uint   offset;         // 内部节点：右子节点索引；叶节点：首个图元索引
+    ushort object_count;   // 叶节点图元数，内部节点为0
+    uchar  axis;           // 划分轴
+    uchar  pad;
+};
+
+static_assert(sizeof(MotionBVHNode) == 56, "MotionBVHNode should be 56 bytes");
+
+class MotionBVH : public Hittable
+{
+private:
+    static const int kStackSize = BVHBuilder::kMaxDepth + 1; // 构建器限制了树深，栈不会溢出
+    static const int kMaxTimeSegments = 8;
+    static constexpr double kSegmentGain = .9; // 时间段数加倍后SAH代价降到此比例以下才采用
+
+    // 一个时间段[time0, time1]内的树
+    struct Segment
+    {
+        double time0, time1;
+        std::vector<MotionBVHNode> nodes;
+        std::vector<shared_ptr<Hittable>> objects; // 按叶节点顺序排列的图元
+    };
+
+    std::vector<Segment> segments_;
+    std::vector<shared_ptr<Hittable>> objects_; // 去重后的图元，用于refit
+    BVHBuildOption option_;
+    AABB bbox_;
+
+public:
+    MotionBVH() = delete;
+
+    MotionBVH(const HittableList& list, const BVHBuildOption& option)
+        : objects_(list.get_objects()), option_(option), bbox_(list.get_bbox())
+    {
+        // SBVH需要裁剪图元，运动图元在时间段内的几何不固定，只用物体划分
+        option_.builder.spatial_splits = false;
+        // 各时间段用中点时刻的包围盒构建，与静态网格的缓存不通用
+        option_.builder.mesh_hash = 0;
+
+        segments_ = build_segments(1);
+        if (option_.motion.temporal_splits)
+        {
+            double cost = sah_cost(segments_);
+            while (static_cast<int>(segments_.size()) < kMaxTimeSegments)
+            {
+                auto split = build_segments(static_cast<int>(segments_.size()) * 2);
+                double split_cost = sah_cost(split);
+                if (split_cost > cost * kSegmentGain)
+                    break;
+                segments_ = std::move(split);
+                cost = split_cost;
+            }
+        }
+
+        add_info("motion BVH time segments: "_str + STR(segments_.size()));
+    }
+
+    MotionBVH(const MotionBVH&) = delete;
+    MotionBVH& operator=(const MotionBVH&) = delete;
+
+    MotionBVH(MotionBVH&&) = delete;
+    MotionBVH& operator=(MotionBVH&&) = delete;
+
+public:
+    bool hit(const Ray& r, const Interval& interval, HitRecord& rec)
+        const override
+    {
+        double time = std::clamp<double>(r.get_time(), 0., 1.);
+        int index = std::min(static_cast<int>(time * segments_.size()), static_cast<int>(segments_.size()) - 1);
+        const Segment& segment = segments_[index];
+        if (segment.nodes.empty())
+            return false;
+
+        // 时间段内的插值系数
+        double alpha = (time - segment.time0) / (segment.time1 - segment.time0);
+
+        Point3 origin = r.get_origin();
+        Vec3 inv_dir = 1. / r.get_direction();
+        double closest_so_far = interval.get_max();
+        bool hit_anything = false;
+        DeferredHit deferred;
+        const bool dir_is_neg[3] = { inv_dir[0] < 0, inv_dir[1] < 0, inv_dir[2] < 0 };
+        const bool ordered = option_.layout.ordered_traversal;
+        ullong visited = 0, tested = 0;
+
+        uint stack[kStackSize];
+        int top = 0;
+        uint node_index = 0;
+
+        while (true)
+        {
+            const MotionBVHNode& node = segment.nodes[node_index];
+            ++visited;
+            if (node_hit(node, alpha, origin, inv_dir, interval.get_min(), closest_so_far))
+            {
+                if (node.object_count > 0)
+                {
+                    for (uint i = node.offset; i < node.offset + node.object_count; ++i)
+                    {
+                        ++tested;
+                        if (segment.objects[i]->intersect(r, Interval(interval.get_min(), closest_so_far), deferred, rec))
+                        {
+                            hit_anything = true;
+                            closest_so_far = deferred.t;
+                        }
+                    }
+                }
+                else if (ordered && dir_is_neg[node.axis])
+                {
+                    // 光线沿划分轴负方向时右子节点较近，先访问
+                    stack[top++] = node_index + 1;
+                    node_index = node.offset;
+                    continue;
+                }
+                else
+                {
+                    stack[top++] = node.offset;
+                    node_index = node_index + 1;
+                    continue;
+                }
+            }
+
+            if (top == 0)
+                break;
+            node_index = stack[--top];
+        }
+
+        record_traversal(visited, tested);
+        if (hit_anything)
+            resolve(r, deferred, rec);
+        return hit_anything;
+    }
+
+    // 找到任意交点即返回，不需要按远近顺序访问子节点
+    bool occluded(const Ray& r, const Interval& interval)
+        const override
+    {
+        double time = std::clamp<double>(r.get_time(), 0., 1.);
+        int index = std::min(static_cast<int>(time * segments_.size()), static_cast<int>(segments_.size()) - 1);
+        const Segment& segment = segments_[index];
+        if (segment.nodes.empty())
+            return false;
+
+        double alpha = (time - segment.time0) / (segment.time1 - segment.time0);
+
+        Point3 origin = r.get_origin();
+        Vec3 inv_dir = 1. / r.get_direction();
+        ullong visited = 0, tested = 0;
+        bool hit_anything = false;
+
+        uint stack[kStackSize];
+        int top = 0;
+        uint node_index = 0;
+
+        while (true)
+        {
+            const MotionBVHNode& node = segment.nodes[node_index];
+            ++visited;
+            if (node_hit(node, alpha, origin, inv_dir, interval.get_min(), interval.get_max()))
+            {
+                if (node.object_count == 0)
+                {
+                    stack[top++] = node.offset;
+                    node_index = node_index + 1;
+                    continue;
+                }
+
+                for (uint i = node.offset; i < node.offset + node.object_count && !hit_anything; ++i, ++tested)
+                    hit_anything = segment.objects[i]->occluded(r, interval);
+                if (hit_anything)
+                    break;
+            }
+
+            if (top == 0)
+                break;
+            node_index = stack[--top];
+        }
+
+        record_traversal(visited, tested);
+        return hit_anything;
+    }
+
+    AABB get_bbox()
+        const override
+    {
+        return bbox_;
+    }
+
+    AABB get_bbox_at(double time)
+        const override
+    {
+        AABB bbox;
+        for (const auto& object : objects_)
+            bbox = AABB(bbox, object->get_bbox_at(time));
+        return bbox;
+    }
+
+    bool is_moving()
+        const override
+    {
+        return true;
+    }
+
+    // 保持树结构，重新计算各时间段节点两个时刻的包围盒
+    void refit()
+        override
+    {
+        refit_objects(objects_, false);
+        bbox_ = AABB();
+        for (const auto& object : objects_)
+            bbox_ = AABB(bbox_, object->get_bbox());
+
+        for (Segment& segment : segments_)
+            compute_bounds(segment);
+    }
+
+private:
+    // 用时间段中点时刻的图元包围盒构建树结构，节点再分别计算起止时刻的包围盒
+    // 用扫掠包围盒构建时运动图元的包围盒过大，划分质量差
+    void build(Segment& segment)
+    {
+        std::vector<AABB> bboxes(objects_.size());
+        int size = static_cast<int>(objects_.size());
+#pragma omp parallel for
+        for (int i = 0; i < size; ++i)
+            bboxes[i] = objects_[i]->get_bbox_at((segment.time0 + segment.time1) * .5);
+
+        BVHBuilder builder(bboxes, option_.builder);
+
+        segment.objects.clear();
+        segment.objects.reserve(builder.get_indices().size());
+        for (uint i : builder.get_indices())
+            segment.objects.emplace_back(objects_[i]);
+
+        const auto& build_nodes = builder.get_nodes();
+        segment.nodes.resize(build_nodes.size());
+        std::vector<int> depths(build_nodes.size(), 0);
+        int max_depth = 0;
+        for (size_t i = 0; i < build_nodes.size(); ++i)
+        {
+            MotionBVHNode& node = segment.nodes[i];
+            node = {};
+            node.offset = build_nodes[i].offset;
+            node.object_count = static_cast<ushort>(build_nodes[i].count);
+            node.axis = static_cast<uchar>(build_nodes[i].axis);
+
+            max_depth = std::max(max_depth, depths[i]);
+            if (build_nodes[i].count == 0)
+                depths[i + 1] = depths[node.offset] = depths[i] + 1;
+        }
+        assert(max_depth < kStackSize);
+
+        compute_bounds(segment);
+
+        if (option_.quality_report)
+            builder.report_quality("motion BVH", segment.nodes.size() * sizeof(MotionBVHNode)
+                + segment.objects.size() * sizeof(shared_ptr<Hittable>));
+    }
+
+    // 先并行计算叶节点，再按逆深度优先顺序合并内部节点，子节点索引总大于父节点
+    void compute_bounds(Segment& segment)
+    {
+        int size = static_cast<int>(segment.nodes.size());
+#pragma omp parallel for
+        for (int i = 0; i < size; ++i)
+        {
+            MotionBVHNode& node = segment.nodes[i];
+            if (node.object_count == 0)
+                continue;
+
+            AABB bbox0, bbox1;
+            for (uint k = node.offset; k < node.offset + node.object_count; ++k)
+            {
+                bbox0 = AABB(bbox0, segment.objects[k]->get_bbox_at(segment.time0));
+                bbox1 = AABB(bbox1, segment.objects[k]->get_bbox_at(segment.time1));
+            }
+            set_bounds(node, 0, bbox0);
+            set_bounds(node, 1, bbox1);
+        }
+
+        for (int i = size - 1; i >= 0; --i)
+        {
+            MotionBVHNode& node = segment.nodes[i];
+            if (node.object_count > 0)
+                continue;
+
+            const MotionBVHNode& left = segment.nodes[i + 1];
+            const MotionBVHNode& right = segment.nodes[node.offset];
+            for (int k = 0; k < 2; ++k)
+            {
+                for (int a = 0; a < 3; ++a)
+                {
+                    node.bbox_min[k][a] = std::min(left.bbox_min[k][a], right.bbox_min[k][a]);
+                    node.bbox_max[k][a] = std::max(left.bbox_max[k][a], right.bbox_max[k][a]);
+                }
+            }
+        }
+    }
+
+    static void set_bounds(MotionBVHNode& node, int k, const AABB& bbox)
+    {
+        for (int a = 0; a < 3; ++a)
+        {
+            node.bbox_min[k][a] = round_down_float(bbox.axis(a).get_min());
+            node.bbox_max[k][a] = round_up_float(bbox.axis(a).get_max());
+        }
+    }
+
+    // 将0~1等分为segment_count段，各建一棵树
+    std::vector<Segment> build_segments(int segment_count)
+    {
+        std::vector<Segment> segments(segment_count);
+        for (int i = 0; i < segment_count; ++i)
+        {
+            segments[i].time0 = static_cast<double>(i) / segment_count;
+            segments[i].time1 = static_cast<double>(i + 1) / segment_count;
+            build(segments[i]);
+        }
+        return segments;
+    }
+
+    // 参见 Grünschloß et al. 2011, MSBVH: An Efficient Acceleration Data Structure for Ray Traced Motion Blur
+    // 在各时间段的起点、中点、终点插值节点包围盒计算SAH代价，再对所有时间段取平均
+    // 子节点运动方向不同时插值包围盒在时间段中部膨胀，划分时间段可减小膨胀
+    double sah_cost(const std::vector<Segment>& segments)
+        const
+    {
+        const double kAlphas[] = { 0., .5, 1. };
+        double cost = 0.;
+        for (const Segment& segment : segments)
+        {
+            if (segment.nodes.empty())
+                continue;
+
+            for (double alpha : kAlphas)
+            {
+                double root_area = lerp_bbox(segment.nodes[0], alpha).surface_area();
+                if (root_area <= 0)
+                    continue;
+
+                double sum = 0.;
+                for (const MotionBVHNode& node : segment.nodes)
+                    sum += lerp_bbox(node, alpha).surface_area() * (node.object_count > 0 ? node.object_count : option_.builder.traversal_cost);
+                cost += sum / root_area;
+            }
+        }
+        return cost / (segments.size() * std::size(kAlphas));
+    }
+
+    static AABB lerp_bbox(const MotionBVHNode& node, double alpha)
+    {
+        Interval axes[3];
+        for (int a = 0; a < 3; ++a)
+        {
+            axes[a] = Interval(
+                (1 - alpha) * node.bbox_min[0][a] + alpha * node.bbox_min[1][a],
+                (1 - alpha) * node.bbox_max[0][a] + alpha * node.bbox_max[1][a]);
+        }
+        return AABB(axes[0], axes[1], axes[2]);
+    }
+
+    // 按插值系数alpha求当前时刻的节点包围盒再做slab测试
+    // 两端包围盒都向外取整，插值结果仍包含匀速运动图元在该时刻的包围盒
+    // 插值的舍入误差不超过gamma(3)倍两端坐标绝对值的较大者，包围盒按此向外扩展；离开距离与LinearBVH相同放大1+2*gamma(3)倍
+    static bool node_hit(const MotionBVHNode& node, double alpha, const Point3& origin, const Vec3& inv_dir, double t_min, double t_max)
+    {
+        const double kGamma3 = error_gamma<double>(3);
+        for (int a = 0; a < 3; ++a)
+        {
+            double min0 = node.bbox_min[0][a], min1 = node.bbox_min[1][a];
+            double max0 = node.bbox_max[0][a], max1 = node.bbox_max[1][a];
+            double min = (1 - alpha) * min0 + alpha * min1;
+            double max = (1 - alpha) * max0 + alpha * max1;
+            min -= kGamma3 * std::max(std::fabs(min0), std::fabs(min1));
+            max += kGamma3 * std::max(std::fabs(max0), std::fabs(max1));
+            double t0 = (min - origin[a]) * inv_dir[a];
+            double t1 = (max - origin[a]) * inv_dir[a];
+
+            if (inv_dir[a] < 0)
+                std::swap(t0, t1);
+            t1 *= 1 + 2 * kGamma3;
+
+            if (t0 > t_min) t_min = t0;
+            if (t1 < t_max) t_max = t1;
+
+            if (t_max <= t_min)
+                return false;
+        }
+        return true;
+    }
+};
+
+#endif // !MOTION_BVH_H
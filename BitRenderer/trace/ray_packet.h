@@ -0,0 +1,183 @@
+/*
+ * 光线包
+ * 相邻像素的主光线方向相近，在BVH中的遍历路径几乎相同，成组遍历时共享节点访问和包围盒测试
+ * 光线数据按分量SoA存储为real，叶节点对包内光线逐条求交的循环可由编译器向量化
+ */
+#ifndef RAY_PACKET_H
+#define RAY_PACKET_H
+
+#include "aabb.h"
+
+// 前向声明，击中记录由调用方提供
+struct HitRecord;
+
+// 参见 Wald et al. 2001, Interactive Rendering with Coherent Ray Tracing
+// 参见 Overbeck et al. 2008, Large Ray Packets for Real-time Whitted Ray Tracing
+// 节点测试：先测首条活跃光线，未击中时用区间算术判断整包是否必然错过，否则再逐条找首条击中的光线
+// 首条击中光线之前的光线必然错过该节点的子树，遍历时只记录首条活跃光线的序号
+struct RayPacket
+{
+    static const int kMaxSize = 64; // 8x8像素
+
+    int        size = 0;
+    real       t_min = 0;               // 各光线共用的区间下限
+    const Ray* rays = nullptr;          // 包内光线，由调用方提供
+    real       origin[3][kMaxSize];
+    real       direction[3][kMaxSize];
+    real       inv_dir[3][kMaxSize];
+    real       t_max[kMaxSize];         // 各光线的区间上限，击中后更新为最近交点距离
+    bool       hits[kMaxSize];
+    HitRecord* recs = nullptr;          // 各光线的击中记录
+    WatertightRay watertight[kMaxSize]; // 各光线与三角形求交的剪切参数
+    // 剪切参数按分量的副本，叶节点用SIMD对相邻多条光线同时与一个三角形求交
+    alignas(32) double shear_origin[3][kMaxSize]; // 按kx、ky、kz重排的起点
+    alignas(32) double shear[3][kMaxSize];        // sx、sy、sz
+    bool       coherent = false;        // 各轴方向符号一致，可用区间算术剔除
+    real       origin_min[3], origin_max[3];   // 包内光线原点各分量的范围
+    real       inv_dir_min[3], inv_dir_max[3]; // 方向倒数各分量的范围
+
+    // 载入count条光线，in_rays和records在求交期间须保持有效
+    void set(const Ray* in_rays, int count, const Interval& interval, HitRecord* records)
+    {
+        size = std::min(count, kMaxSize);
+        t_min = interval.get_min();
+        rays = in_rays;
+        recs = records;
+        coherent = size > 0;
+
+        for (int a = 0; a < 3; ++a)
+        {
+            origin_min[a] = inv_dir_min[a] = std::numeric_limits<real>::infinity();
+            origin_max[a] = inv_dir_max[a] = -std::numeric_limits<real>::infinity();
+        }
+
+        for (int k = 0; k < size; ++k)
+        {
+            t_max[k] = interval.get_max();
+            hits[k] = false;
+            watertight[k] = WatertightRay(in_rays[k]);
+            const WatertightRay& w = watertight[k];
+            shear_origin[0][k] = w.ox;
+            shear_origin[1][k] = w.oy;
+            shear_origin[2][k] = w.oz;
+            shear[0][k] = w.sx;
+            shear[1][k] = w.sy;
+            shear[2][k] = w.sz;
+
+            Point3 o = in_rays[k].get_origin();
+            Vec3 d = in_rays[k].get_direction();
+            for (int a = 0; a < 3; ++a)
+            {
+                origin[a][k] = o[a];
+                direction[a][k] = d[a];
+                inv_dir[a][k] = 1 / d[a];
+                origin_min[a] = std::min(origin_min[a], o[a]);
+                origin_max[a] = std::max(origin_max[a], o[a]);
+                inv_dir_min[a] = std::min(inv_dir_min[a], inv_dir[a][k]);
+                inv_dir_max[a] = std::max(inv_dir_max[a], inv_dir[a][k]);
+            }
+        }
+
+        // 方向分量为0时倒数为无穷，区间算术可能产生NaN，此时只逐条测试
+        for (int a = 0; a < 3; ++a)
+        {
+            bool same_sign = inv_dir_min[a] > 0 || inv_dir_max[a] < 0;
+            coherent = coherent && same_sign && std::isfinite(inv_dir_min[a]) && std::isfinite(inv_dir_max[a]);
+        }
+    }
+
+    // 第k条光线是否击中包围盒，与LinearBVH的节点测试一致，t_near为进入距离
+    bool hit_bbox(int k, const float bbox_min[3], const float bbox_max[3], double& t_near)
+        const
+    {
+        real t0_max = t_min, t1_min = t_max[k];
+        for (int a = 0; a < 3; ++a)
+        {
+            real t0 = (bbox_min[a] - origin[a][k]) * inv_dir[a][k];
+            real t1 = (bbox_max[a] - origin[a][k]) * inv_dir[a][k];
+
+            if (inv_dir[a][k] < 0)
+                std::swap(t0, t1);
+            t1 *= 1 + 2 * error_gamma(3);
+
+            if (t0 > t0_max) t0_max = t0;
+            if (t1 < t1_min) t1_min = t1;
+
+            if (t1_min <= t0_max)
+                return false;
+        }
+        t_near = t0_max;
+        return true;
+    }
+
+    // 参见 Boulos et al. 2007, Packet-based Whitted and Distribution Ray Tracing
+    // 以原点和方向倒数的范围计算整包进入距离的下界和离开距离的上界，下界大于上界时所有光线都错过包围盒
+    bool miss_bbox(const float bbox_min[3], const float bbox_max[3])
+        const
+    {
+        double t_enter = t_min, t_exit = kInfinitDouble;
+        for (int a = 0; a < 3; ++a)
+        {
+            // 方向为正时从min面进入、max面离开，为负时相反，单精度的分量在双精度下相减没有舍入误差
+            bool positive = inv_dir_min[a] > 0;
+            double near_lo = static_cast<double>(positive ? bbox_min[a] : bbox_max[a]) - origin_max[a];
+            double near_hi = static_cast<double>(positive ? bbox_min[a] : bbox_max[a]) - origin_min[a];
+            double far_lo = static_cast<double>(positive ? bbox_max[a] : bbox_min[a]) - origin_max[a];
+            double far_hi = static_cast<double>(positive ? bbox_max[a] : bbox_min[a]) - origin_min[a];
+
+            double enter_a, exit_a;
+            if (positive)
+            {
+                enter_a = near_lo * (near_lo >= 0 ? inv_dir_min[a] : inv_dir_max[a]);
+                exit_a = far_hi * (far_hi >= 0 ? inv_dir_max[a] : inv_dir_min[a]);
+            }
+            else
+            {
+                enter_a = near_hi * (near_hi >= 0 ? inv_dir_min[a] : inv_dir_max[a]);
+                exit_a = far_lo * (far_lo >= 0 ? inv_dir_max[a] : inv_dir_min[a]);
+            }
+
+            t_enter = std::max(t_enter, enter_a);
+            t_exit = std::min(t_exit, exit_a);
+        }
+
+        // 放宽舍入误差，保证不错误剔除
+        return t_enter - t_exit > 1e-9 * (std::abs(t_enter) + std::abs(t_exit));
+    }
+
+    // 从first起首条击中包围盒的光线序号，全部错过时返回size，t_near为该光线的进入距离
+    int first_hit(const float bbox_min[3], const float bbox_max[3], int first, double& t_near)
+        const
+    {
+        if (first >= size)
+            return size;
+        if (hit_bbox(first, bbox_min, bbox_max, t_near))
+            return first;
+        if (coherent && miss_bbox(bbox_min, bbox_max))
+            return size;
+
+        for (int k = first + 1; k < size; ++k)
+        {
+            if (hit_bbox(k, bbox_min, bbox_max, t_near))
+                return k;
+        }
+        return size;
+    }
+
+    // 叶节点中从first起击中包围盒的光线序号写入active，返回条数
+    // 叶节点处包内多数光线已错过，只让击中的光线与图元求交
+    int active_rays(const float bbox_min[3], const float bbox_max[3], int first, int* active)
+        const
+    {
+        int count = 0;
+        double t_near;
+        for (int k = first; k < size; ++k)
+        {
+            if (hit_bbox(k, bbox_min, bbox_max, t_near))
+                active[count++] = k;
+        }
+        return count;
+    }
+};
+
+#endif // !RAY_PACKET_H
@@ -0,0 +1,72 @@
+/*
+ * SIMD指令集检测
+ * 运行时检测CPU支持的最宽指令集，AVX2实现只为单个函数开启，工程不需要以AVX2编译
+ */
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <string>
+#include <type_traits>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC不需要指定目标指令集即可使用AVX2指令，GCC和Clang需要为函数单独开启
+#if defined(SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define SIMD_AVX2 __attribute__((target("avx2")))
+#else
+#define SIMD_AVX2
+#endif
+
+enum SimdLevel
+{
+    SimdLevel_Scalar,
+    SimdLevel_SSE,
+    SimdLevel_AVX2
+};
+
+// CPU和操作系统都支持的最宽指令集，只检测一次
+inline SimdLevel cpu_simd_level()
+{
+    static const SimdLevel level = []()
+        {
+#if !defined(SIMD_X86)
+            return SimdLevel_Scalar;
+#elif defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 1);
+            // OSXSAVE和AVX，且操作系统保存YMM寄存器
+            bool avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+            __cpuidex(info, 7, 0);
+            return avx && (info[1] & (1 << 5)) ? SimdLevel_AVX2 : SimdLevel_SSE;
+#else
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") ? SimdLevel_AVX2 : SimdLevel_SSE;
+#endif
+        }();
+    return level;
+}
+
+// 以T类型计算的SIMD实现可用的指令集，现有实现都是单精度，T为double时返回标量
+template <typename T>
+inline SimdLevel simd_level_for()
+{
+    return std::is_same_v<T, float> ? cpu_simd_level() : SimdLevel_Scalar;
+}
+
+inline std::string simd_level_name(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel_AVX2: return "AVX2";
+    case SimdLevel_SSE: return "SSE";
+    default: return "scalar";
+    }
+}
+
+#endif // !SIMD_H
@@ -1,145 +1,233 @@
-/*
- * 球类
- */
-#ifndef SPHERE_H
-#define SPHERE_H
-
-#include "hittable.h"
-#include "onb.h"
-#include "vec.h"
-
-class Sphere : public Hittable
-{
-private:
-    Point3 center_;
-    Vec3 center_move_vec_; // 球移动距离
-    bool is_moving_; //球是否在移动
-    AABB bbox_;
-    double radius_;
-    shared_ptr<Material> material_;
-
-public:
-    // 静态球
-    Sphere(Point3 center, double radius, shared_ptr<Material> material) 
-        : center_(center), radius_(radius), material_(material), is_moving_(false) 
-    {
-        auto rvec = Vec3(radius, radius, radius);
-        bbox_ = AABB(center - rvec, center + rvec);
-    }
-
-    // 运动球
-    Sphere(Point3 center, Point3 center_end, double radius, shared_ptr<Material> material)
-        : center_(center), radius_(radius), material_(material), is_moving_(true)
-    {
-        auto rvec = Vec3(radius, radius, radius);
-        AABB box1(center - rvec, center_end + rvec);
-        AABB box2(center - rvec, center_end + rvec);
-        bbox_ = AABB(box1, box2);
-
-        center_move_vec_ = center_end - center;
-    }
-
-    Sphere(const Sphere&) = delete;
-    Sphere& operator=(const Sphere&) = delete;
-
-    Sphere(Sphere&&) = delete;
-    Sphere& operator=(Sphere&&) = delete;
-
-public:
-    bool hit(const Ray& r, const Interval& interval, HitRecord& rec)
-        const override
-    {
-        Point3 now_center = is_moving_ ? get_center(r.get_time()) : center_;
-        Vec3 oc = r.get_origin() - now_center;
-        auto a = r.get_direction().norm2();
-        auto half_b = dot(oc, r.get_direction());
-        auto c = oc.norm2() - radius_ * radius_;
-
-        auto discriminant = half_b * half_b - a * c;
-        if (discriminant < 0) 
-            return false;
-        auto sqrtd = std::sqrt(discriminant);
-
-        auto root = (-half_b - sqrtd) / a; // 更近的根
-        if (!interval.surrounds(root))
-        {
-            root = (-half_b + sqrtd) / a; // 更远的根
-            if (!interval.surrounds(root))
-                return false;
-        }
-
-        rec.t = root;
-        rec.p = r.at(rec.t);
-        Vec3 outward_normal = (rec.p - center_) / radius_; // 单位化
-        rec.set_face_normal(r, outward_normal);
-        get_sphere_uv(outward_normal, rec.u, rec.v);
-        rec.material = material_;
-
-        return true;
-    }
-
-    AABB get_bbox() const override
-    { 
-        return bbox_;
-    }
-
-    // 参见RayTracingTheNextWeek 4.4
-    // 根据球上一点三维坐标得到其uv纹理坐标
-    // p: 球上一点
-    // u: returned value [0,1] of angle around the Y axis from X=-1.
-    // v: returned value [0,1] of angle from Y=-1 to Y=+1.
-    static void get_sphere_uv(const Point3& p, double& u, double& v)
-    {
-        //     <1 0 0> yields <0.50 0.50>       <-1  0  0> yields <0.00 0.50>
-        //     <0 1 0> yields <0.50 1.00>       < 0 -1  0> yields <0.50 0.00>
-        //     <0 0 1> yields <0.25 0.50>       < 0  0 -1> yields <0.75 0.50>
-        auto phi = atan2(-p.z(), p.x()) ;
-        u = (phi + kPI) / (2 * kPI);
-        auto theta = acos(-p.y());
-        v = theta / kPI;
-    }
-
-    double pdf_value(const Point3& o, const Vec3& v) const override
-    {
-        // 仅对静态球有效
-        HitRecord rec;
-        if (!this->hit(Ray(o, v), Interval(0.001, kInfinitDouble), rec))
-            return 0;
-
-        auto cos_theta_max = std::sqrt(1 - radius_ * radius_ / (center_ - o).norm2());
-        auto solid_angle = 2 * kPI * (1 - cos_theta_max);
-
-        return  1 / solid_angle;
-    }
-
-    Vec3 random(const Point3& o) const override
-    {
-        Vec3 direction = center_ - o;
-        auto distance_squared = direction.norm2();
-        ONB uvw;
-        uvw.build_from_w(direction);
-        return uvw.local(random_to_sphere(radius_, distance_squared));
-    }
-
-private:
-    // 获取t时刻的球心位置
-    Point3 get_center(double t) const
-    {
-        return center_ + t * center_move_vec_;
-    }
-
-    static Vec3 random_to_sphere(double radius, double distance_squared)
-    {
-        auto r1 = random_double();
-        auto r2 = random_double();
-        auto z = 1 + r2 * (sqrt(1 - radius * radius / distance_squared) - 1);
-
-        auto phi = 2 * kPI * r1;
-        auto x = cos(phi) * sqrt(1 - z * z);
-        auto y = sin(phi) * sqrt(1 - z * z);
-
-        return Vec3(x, y, z);
-    }
-};
-
-#endif // !SPHERE_H
+/*
+ * 球类
+ */
+#ifndef SPHERE_H
+#define SPHERE_H
+
+#include "hittable.h"
+#include "onb.h"
+#include "vec.h"
+
+class Sphere : public Hittable
+{
+private:
+    Point3 center_;
+    Vec3 center_move_vec_; // 球移动距离
+    bool is_moving_; //球是否在移动
+    AABB bbox_;
+    double radius_;
+    shared_ptr<Material> material_;
+
+public:
+    // 静态球
+    Sphere(Point3 center, double radius, shared_ptr<Material> material) 
+        : center_(center), radius_(radius), material_(material), is_moving_(false) 
+    {
+        auto rvec = Vec3(radius, radius, radius);
+        bbox_ = AABB(center - rvec, center + rvec);
+    }
+
+    // 运动球
+    Sphere(Point3 center, Point3 center_end, double radius, shared_ptr<Material> material)
+        : center_(center), radius_(radius), material_(material), is_moving_(true)
+    {
+        auto rvec = Vec3(radius, radius, radius);
+        AABB box1(center - rvec, center + rvec);
+        AABB box2(center_end - rvec, center_end + rvec);
+        bbox_ = AABB(box1, box2);
+
+        center_move_vec_ = center_end - center;
+    }
+
+    Sphere(const Sphere&) = delete;
+    Sphere& operator=(const Sphere&) = delete;
+
+    Sphere(Sphere&&) = delete;
+    Sphere& operator=(Sphere&&) = delete;
+
+public:
+    bool hit(const Ray& r, const Interval& interval, HitRecord& rec)
+        const override
+    {
+        DeferredHit deferred;
+        if (!intersect(r, interval, deferred, rec))
+            return false;
+
+        set_hit_record(r, deferred, rec);
+        return true;
+    }
+
+    bool intersect(const Ray& r, const Interval& interval, DeferredHit& deferred, HitRecord& /*rec*/)
+        const override
+    {
+        double root;
+        if (!find_root(r, interval, is_moving_ ? get_center(r.get_time()) : center_, root))
+            return false;
+
+        deferred = { this, root, 0, 0, 0 };
+        return true;
+    }
+
+    // 球面坐标的反三角函数只对最近交点计算一次
+    void set_hit_record(const Ray& r, const DeferredHit& deferred, HitRecord& rec)
+        const override
+    {
+        Point3 now_center = is_moving_ ? get_center(r.get_time()) : center_;
+        rec.t = deferred.t;
+        rec.p = r.at(rec.t);
+        Vec3 outward_normal = (rec.p - now_center) / radius_; // 单位化
+        // 击中点投影回球面，消去t的误差，投影后的误差界参见 PBRT 3.9.4
+        Vec3 radial = rec.p - now_center;
+        radial *= std::abs(radius_) / radial.norm();
+        rec.p = now_center + radial;
+        rec.set_spawn_offset(error_gamma(5) * (abs(now_center) + abs(radial)), outward_normal);
+        rec.set_face_normal(r, outward_normal);
+        get_sphere_uv(outward_normal, rec.u, rec.v);
+        rec.material = material_;
+    }
+
+    bool occluded(const Ray& r, const Interval& interval)
+        const override
+    {
+        double root;
+        return find_root(r, interval, is_moving_ ? get_center(r.get_time()) : center_, root);
+    }
+
+    AABB get_bbox() const override
+    { 
+        return bbox_;
+    }
+
+    // 匀速运动，t时刻的包围盒即两端包围盒的线性插值
+    AABB get_bbox_at(double time)
+        const override
+    {
+        auto rvec = Vec3(radius_, radius_, radius_);
+        Point3 center = is_moving_ ? get_center(time) : center_;
+        return AABB(center - rvec, center + rvec);
+    }
+
+    bool is_moving()
+        const override
+    {
+        return is_moving_;
+    }
+
+    // 移动球心，运动球的位移不变，refit后包围盒生效
+    void set_center(const Point3& center)
+    {
+        center_ = center;
+    }
+
+    void refit()
+        override
+    {
+        auto rvec = Vec3(radius_, radius_, radius_);
+        bbox_ = AABB(center_ - rvec, center_ + rvec);
+        if (is_moving_)
+            bbox_ = AABB(bbox_, AABB(center_ + center_move_vec_ - rvec, center_ + center_move_vec_ + rvec));
+    }
+
+    // 参见RayTracingTheNextWeek 4.4
+    // 根据球上一点三维坐标得到其uv纹理坐标
+    // p: 球上一点
+    // u: returned value [0,1] of angle around the Y axis from X=-1.
+    // v: returned value [0,1] of angle from Y=-1 to Y=+1.
+    static void get_sphere_uv(const Point3& p, double& u, double& v)
+    {
+        //     <1 0 0> yields <0.50 0.50>       <-1  0  0> yields <0.00 0.50>
+        //     <0 1 0> yields <0.50 1.00>       < 0 -1  0> yields <0.50 0.00>
+        //     <0 0 1> yields <0.25 0.50>       < 0  0 -1> yields <0.75 0.50>
+        auto phi = atan2(-p.z(), p.x()) ;
+        u = (phi + kPI) / (2 * kPI);
+        auto theta = acos(std::clamp<double>(-p.y(), -1, 1)); // 单位化的舍入误差可能使分量略超出[-1,1]
+        v = theta / kPI;
+    }
+
+    double pdf_value(const Point3& o, const Vec3& v) const override
+    {
+        // 仅对静态球有效
+        if (!occluded(Ray(o, v), Interval(0.001, kInfinitDouble)))
+            return 0;
+
+        auto cos_theta_max = std::sqrt(1 - radius_ * radius_ / (center_ - o).norm2());
+        auto solid_angle = 2 * kPI * (1 - cos_theta_max);
+
+        return  1 / solid_angle;
+    }
+
+    Vec3 random(const Point3& o) const override
+    {
+        Vec3 direction = center_ - o;
+        auto distance_squared = direction.norm2();
+        ONB uvw;
+        uvw.build_from_w(direction);
+        return uvw.local(random_to_sphere(radius_, distance_squared));
+    }
+
+private:
+    // 区间内最近的根，即光线击中球面时的t
+    // 参见 Haines et al. 2019, Ray Tracing Gems 7, Precision Improvements for Ray/Sphere Intersection
+    // 在双精度下计算，判别式由球心到光线的垂直距离求出，绝对值较小的根由c/q求出，避免相近数相减，
+    // 从球面偏移出发、离开球面的光线，另一个根的符号不会因舍入而改变
+    bool find_root(const Ray& r, const Interval& interval, const Point3& center, double& root)
+        const
+    {
+        Point3 o = r.get_origin();
+        Vec3 d = r.get_direction();
+        double oc[3], dir[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            oc[i] = static_cast<double>(o[i]) - center[i];
+            dir[i] = d[i];
+        }
+        auto a = dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2];
+        auto half_b = oc[0] * dir[0] + oc[1] * dir[1] + oc[2] * dir[2];
+        auto c = oc[0] * oc[0] + oc[1] * oc[1] + oc[2] * oc[2] - radius_ * radius_;
+
+        double perp2 = 0; // 球心到光线距离的平方
+        for (int i = 0; i < 3; ++i)
+        {
+            double l = oc[i] - half_b / a * dir[i];
+            perp2 += l * l;
+        }
+        auto discriminant = a * (radius_ * radius_ - perp2);
+        if (discriminant < 0) 
+            return false;
+
+        auto q = -(half_b + std::copysign(std::sqrt(discriminant), half_b));
+        auto t0 = c / q, t1 = q / a;
+        if (t0 > t1)
+            std::swap(t0, t1);
+
+        root = t0; // 更近的根
+        if (!interval.surrounds(root))
+        {
+            root = t1; // 更远的根
+            if (!interval.surrounds(root))
+                return false;
+        }
+        return true;
+    }
+
+    // 获取t时刻的球心位置
+    Point3 get_center(double t) const
+    {
+        return center_ + t * center_move_vec_;
+    }
+
+    static Vec3 random_to_sphere(double radius, double distance_squared)
+    {
+        auto r1 = random_double();
+        auto r2 = random_double();
+        auto z = 1 + r2 * (sqrt(1 - radius * radius / distance_squared) - 1);
+
+        auto phi = 2 * kPI * r1;
+        auto x = cos(phi) * sqrt(1 - z * z);
+        auto y = sin(phi) * sqrt(1 - z * z);
+
+        return Vec3(x, y, z);
+    }
+};
+
+#endif // !SPHERE_H
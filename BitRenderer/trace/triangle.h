@@ -1,111 +1,86 @@
-/*
- * 三角形类
- */
-#ifndef TRIANGLE_H
-#define TRIANGLE_H
-
-#include "common.h"
-#include "hittable.h"
-
-extern std::vector<Point3>    vertices;
-extern std::vector<Vec3>      normals;
-extern std::vector<Texcoord2> texcoords;
-
-class Triangle : public Hittable
-{
-private:
-    uint a_,  b_,  c_;  // 顶点索引
-    uint an_, bn_, cn_; // 法线索引
-    uint at_, bt_, ct_; // 纹理坐标索引
-    shared_ptr<Material> material_;
-    AABB bbox_;
-
-public:
-    Triangle(
-        uint a, uint an, uint at, uint b, uint bn, uint bt, uint c, uint cn, uint ct,
-        shared_ptr<Material> material)
-        : a_(a), an_(an), at_(at), b_(b), bn_(bn), bt_(bt), c_(c), cn_(cn), ct_(ct),
-        material_(material)
-    {
-        bbox_ = AABB(AABB(vertices[a_], vertices[b_]).pad(), AABB(vertices[a_], vertices[c_]).pad());
-    }
-
-    Triangle(const Triangle&) = delete;
-    Triangle& operator=(const Triangle&) = delete;
-
-    Triangle(Triangle&&) = delete;
-    Triangle& operator=(Triangle&&) = delete;
-
-public:
-    // 参考
-    // https://dl.acm.org/doi/10.1145/1198555.1198746
-    // https://www.cnblogs.com/graphics/archive/2010/08/09/1795348.html
-
-    bool hit(const Ray& r, const Interval& interval, HitRecord& rec)
-        const override
-    {
-        Vec3 e1 = vertices[b_] - vertices[a_];
-        Vec3 e2 = vertices[c_] - vertices[a_];
-        Vec3 p = cross(r.get_direction(), e2);
-        double det = dot(e1, p);
-
-        Vec3 t;
-        if (det > 0)
-        {
-            t = r.get_origin() - vertices[a_];
-        }
-        else
-        {
-            t = vertices[a_] - r.get_origin();
-            det = -det;
-        }
-
-        // 光线与三角形接近平行
-        if (det < 1e-4)
-            return false;
-
-        // 重心坐标
-        double bc1, bc2;
-        bc1 = dot(t, p);
-        if (bc1 < 0.f || bc1 > det)
-            return false;
-
-        Vec3 q = cross(t, e1);
-        bc2 = dot(r.get_direction(), q);
-        if (bc2 < 0.f || bc1 + bc2 > det)
-            return false;
-
-        // 击中时光线行进距离
-        rec.t = dot(e2, q);
-
-        double inv_det = 1. / det;
-        rec.t *= inv_det;
-        bc1 *= inv_det;
-        bc2 *= inv_det;
-
-        // 避免数值误差造成交点在三角形内侧，反射再次击中三角形而被遮挡
-        if (!interval.surrounds(rec.t))
-            return false;
-
-        // 重心坐标插值
-        // 击中点
-        rec.p = (1 - bc1 - bc2) * vertices[a_] + bc1 * vertices[b_] + bc2 * vertices[c_];
-        // 法线
-        Vec3 normal = (1 - bc1 - bc2) * normals[an_] + bc1 * normals[bn_] + bc2 * normals[cn_];
-        rec.set_face_normal(r, normal);
-        //  纹理坐标
-        rec.u = (1 - bc1 - bc2) * texcoords[at_].u() + bc1 * texcoords[bt_].u() + bc2 * texcoords[ct_].u();
-        rec.v = (1 - bc1 - bc2) * texcoords[at_].v() + bc1 * texcoords[bt_].v() + bc2 * texcoords[ct_].v();
-        rec.material = material_;
-
-        return true;
-    }
-
-    AABB get_bbox()
-        const override
-    {
-        return bbox_;
-    }
-};
-
-#endif // !TRIANGLE_H
+/*
+ * 三角形类
+ * 网格中一个面的图元视图，只记录所属网格和面编号，顶点数据由网格持有
+ * 用于需要逐个三角形作为图元的加速结构（kd树、网格、SBVH等）和单独的三角形
+ */
+#ifndef TRIANGLE_H
+#define TRIANGLE_H
+
+#include "hittable_list.h"
+#include "triangle_mesh.h"
+
+class Triangle : public Hittable
+{
+private:
+    shared_ptr<const TriangleMesh> mesh_;
+    uint face_;
+
+public:
+    Triangle(shared_ptr<const TriangleMesh> mesh, uint face)
+        : mesh_(mesh), face_(face) {}
+
+    Triangle(const Triangle&) = delete;
+    Triangle& operator=(const Triangle&) = delete;
+
+    Triangle(Triangle&&) = delete;
+    Triangle& operator=(Triangle&&) = delete;
+
+public:
+    bool hit(const Ray& r, const Interval& interval, HitRecord& rec)
+        const override
+    {
+        return mesh_->hit(face_, r, interval, rec);
+    }
+
+    bool intersect(const Ray& r, const Interval& interval, DeferredHit& deferred, HitRecord& /*rec*/)
+        const override
+    {
+        double t_hit, bc1, bc2;
+        if (!mesh_->intersect(face_, WatertightRay(r), interval, t_hit, bc1, bc2))
+            return false;
+
+        deferred = { this, t_hit, bc1, bc2, face_ };
+        return true;
+    }
+
+    void set_hit_record(const Ray& r, const DeferredHit& deferred, HitRecord& rec)
+        const override
+    {
+        mesh_->set_hit_record(face_, r, deferred.t, deferred.b1, deferred.b2, rec);
+    }
+
+    bool occluded(const Ray& r, const Interval& interval)
+        const override
+    {
+        double t_hit, bc1, bc2;
+        return mesh_->intersect(face_, WatertightRay(r), interval, t_hit, bc1, bc2);
+    }
+
+    AABB get_bbox()
+        const override
+    {
+        return mesh_->face_bbox(face_);
+    }
+
+    // 三个顶点，叶节点SoA存储用
+    void get_vertices(Point3& a, Point3& b, Point3& c)
+        const
+    {
+        mesh_->get_vertices(face_, a, b, c);
+    }
+
+    AABB clip_bbox(const AABB& box)
+        const override
+    {
+        return mesh_->clip_face(face_, box);
+    }
+};
+
+// 为网格的每个面创建三角形图元，加入list
+inline void add_triangles(const shared_ptr<const TriangleMesh>& mesh, HittableList& list)
+{
+    for (uint face = 0; face < mesh->face_count(); ++face)
+        list.add(make_shared<Triangle>(mesh, face));
+}
+
+#endif // !TRIANGLE_H
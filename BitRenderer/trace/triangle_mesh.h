@@ -0,0 +1,250 @@
+/*
+ * 三角形网格类
+ * 顶点位置、法线和纹理坐标以单精度按分量分别连续存储，每个面只存3个顶点索引，材质由整个网格共享
+ * 各网格自行持有顶点数据，可同时存在多个网格；按面编号求交，MeshBVH和Triangle都经由面编号访问
+ */
+#ifndef TRIANGLE_MESH_H
+#define TRIANGLE_MESH_H
+
+#include "common.h"
+#include "hittable.h"
+
+class TriangleMesh
+{
+private:
+    std::vector<float> px_, py_, pz_; // 顶点位置
+    std::vector<float> nx_, ny_, nz_; // 顶点法线，为空时使用面法线
+    std::vector<float> u_, v_;        // 顶点纹理坐标，为空时取0
+    std::vector<uint> indices_;       // 每个面3个顶点索引
+    shared_ptr<Material> material_;
+
+public:
+    TriangleMesh() = delete;
+
+    // positions和normals每个顶点3个分量，texcoords每个顶点2个分量，indices每个面3个顶点索引
+    // normals和texcoords可以为空
+    TriangleMesh(const std::vector<float>& positions, const std::vector<float>& normals, const std::vector<float>& texcoords,
+        std::vector<uint> indices, shared_ptr<Material> material)
+        : indices_(std::move(indices)), material_(material)
+    {
+        size_t vertex_count = positions.size() / 3;
+        px_.resize(vertex_count);
+        py_.resize(vertex_count);
+        pz_.resize(vertex_count);
+        for (size_t i = 0; i < vertex_count; ++i)
+        {
+            px_[i] = positions[3 * i + 0];
+            py_[i] = positions[3 * i + 1];
+            pz_[i] = positions[3 * i + 2];
+        }
+
+        if (normals.size() == positions.size())
+        {
+            nx_.resize(vertex_count);
+            ny_.resize(vertex_count);
+            nz_.resize(vertex_count);
+            for (size_t i = 0; i < vertex_count; ++i)
+            {
+                nx_[i] = normals[3 * i + 0];
+                ny_[i] = normals[3 * i + 1];
+                nz_[i] = normals[3 * i + 2];
+            }
+        }
+
+        if (texcoords.size() == vertex_count * 2)
+        {
+            u_.resize(vertex_count);
+            v_.resize(vertex_count);
+            for (size_t i = 0; i < vertex_count; ++i)
+            {
+                u_[i] = texcoords[2 * i + 0];
+                v_[i] = texcoords[2 * i + 1];
+            }
+        }
+    }
+
+    TriangleMesh(const TriangleMesh&) = delete;
+    TriangleMesh& operator=(const TriangleMesh&) = delete;
+
+    TriangleMesh(TriangleMesh&&) = delete;
+    TriangleMesh& operator=(TriangleMesh&&) = delete;
+
+public:
+    uint face_count()
+        const
+    {
+        return static_cast<uint>(indices_.size() / 3);
+    }
+
+    size_t vertex_count()
+        const
+    {
+        return px_.size();
+    }
+
+    Point3 position(uint vertex)
+        const
+    {
+        return Point3(px_[vertex], py_[vertex], pz_[vertex]);
+    }
+
+    // 面face的三个顶点
+    void get_vertices(uint face, Point3& a, Point3& b, Point3& c)
+        const
+    {
+        a = position(indices_[3 * face]);
+        b = position(indices_[3 * face + 1]);
+        c = position(indices_[3 * face + 2]);
+    }
+
+    AABB face_bbox(uint face)
+        const
+    {
+        Point3 a = position(indices_[3 * face]);
+        Point3 b = position(indices_[3 * face + 1]);
+        Point3 c = position(indices_[3 * face + 2]);
+        return AABB(AABB(a, b).pad(), AABB(a, c).pad());
+    }
+
+    // 面face在区间内的交点距离t_hit和重心坐标bc1、bc2
+    bool intersect(uint face, const WatertightRay& ray, const Interval& interval, double& t_hit, double& bc1, double& bc2)
+        const
+    {
+        Point3 a, b, c;
+        get_vertices(face, a, b, c);
+        return intersect(a, b, c, ray, interval, t_hit, bc1, bc2);
+    }
+
+    // 与face求交，击中时由重心坐标插值出击中点、法线和纹理坐标
+    bool hit(uint face, const Ray& r, const Interval& interval, HitRecord& rec)
+        const
+    {
+        double t_hit, bc1, bc2;
+        // 未击中时不能改写rec，BVH会用rec.t作为后续求交的最大距离
+        if (!intersect(face, WatertightRay(r), interval, t_hit, bc1, bc2))
+            return false;
+
+        set_hit_record(face, r, t_hit, bc1, bc2, rec);
+        return true;
+    }
+
+    // 由交点距离和重心坐标计算击中点、法线和纹理坐标
+    // 击中点由重心坐标插值，重心坐标有误差时仍在三角形平面上，误差界只来自插值，参见 PBRT 3.9.4
+    // 顶点和SIMD求交总是单精度，双精度构建时误差界也按单精度计算
+    void set_hit_record(uint face, const Ray& r, double t_hit, double bc1, double bc2, HitRecord& rec)
+        const
+    {
+        uint a = indices_[3 * face], b = indices_[3 * face + 1], c = indices_[3 * face + 2];
+        double bc0 = 1 - bc1 - bc2;
+        Vec3 p0 = bc0 * position(a), p1 = bc1 * position(b), p2 = bc2 * position(c);
+
+        rec.t = t_hit;
+        rec.p = p0 + p1 + p2;
+        Vec3 geometric_normal = cross(position(b) - position(a), position(c) - position(a));
+        rec.set_spawn_offset(error_gamma<float>(7) * (abs(p0) + abs(p1) + abs(p2)), geometric_normal);
+        Vec3 normal;
+        if (nx_.empty())
+            normal = unit_vector(geometric_normal);
+        else
+            normal = bc0 * Vec3(nx_[a], ny_[a], nz_[a]) + bc1 * Vec3(nx_[b], ny_[b], nz_[b]) + bc2 * Vec3(nx_[c], ny_[c], nz_[c]);
+        rec.set_face_normal(r, normal);
+        rec.u = u_.empty() ? 0. : bc0 * u_[a] + bc1 * u_[b] + bc2 * u_[c];
+        rec.v = v_.empty() ? 0. : bc0 * v_[a] + bc1 * v_[b] + bc2 * v_[c];
+        rec.material = material_;
+    }
+
+    // 依次用box的6个平面裁剪面face（Sutherland-Hodgman），取剩余多边形的包围盒
+    // 与face_bbox一样加厚过窄的轴，再限制在box内
+    AABB clip_face(uint face, const AABB& box)
+        const
+    {
+        Point3 polygon[2][9] = { { position(indices_[3 * face]), position(indices_[3 * face + 1]), position(indices_[3 * face + 2]) } };
+        int count = 3, current = 0;
+
+        for (int a = 0; a < 3; ++a)
+        {
+            for (int side = 0; side < 2; ++side)
+            {
+                double plane = side == 0 ? box.axis(a).get_min() : box.axis(a).get_max();
+                const Point3* in = polygon[current];
+                Point3* out = polygon[current ^ 1];
+                int out_count = 0;
+
+                for (int i = 0; i < count; ++i)
+                {
+                    const Point3& p = in[i];
+                    const Point3& q = in[(i + 1) % count];
+                    bool p_inside = side == 0 ? p[a] >= plane : p[a] <= plane;
+                    bool q_inside = side == 0 ? q[a] >= plane : q[a] <= plane;
+
+                    if (p_inside)
+                        out[out_count++] = p;
+                    if (p_inside != q_inside)
+                    {
+                        Point3 r = p + (plane - p[a]) / (q[a] - p[a]) * (q - p);
+                        r[a] = plane;
+                        out[out_count++] = r;
+                    }
+                }
+
+                count = out_count;
+                current ^= 1;
+                if (count == 0)
+                    return AABB();
+            }
+        }
+
+        AABB clipped;
+        for (int i = 0; i < count; ++i)
+            clipped = AABB(clipped, AABB(polygon[current][i], polygon[current][i]));
+        return clipped.pad().intersect(box);
+    }
+
+    // 顶点和索引占用的字节数
+    size_t memory_bytes()
+        const
+    {
+        return (px_.size() * 3 + nx_.size() * 3 + u_.size() * 2) * sizeof(float) + indices_.size() * sizeof(uint);
+    }
+
+    // 参见 Woop et al. 2013, Watertight Ray/Triangle Intersection
+    // 三角形平移、剪切到光线空间后，由三条边的2D边函数同号判定光线是否穿过三角形
+    // 相邻三角形共享的边在两侧算出的边函数互为相反数，交点恰在边上时至少一侧接受，光线不会从共享边漏过
+    // 不以行列式阈值剔除，小三角形也能击中；双面求交，重心坐标bc1、bc2为顶点b、c的权重
+    static bool intersect(const Point3& a, const Point3& b, const Point3& c, const WatertightRay& ray, const Interval& interval,
+        double& t_hit, double& bc1, double& bc2)
+    {
+        // 平移到光线起点，沿光线方向剪切，光线变为沿kz轴的正方向
+        double az = a[ray.kz] - ray.oz, bz = b[ray.kz] - ray.oz, cz = c[ray.kz] - ray.oz;
+        double ax = a[ray.kx] - ray.ox - ray.sx * az, ay = a[ray.ky] - ray.oy - ray.sy * az;
+        double bx = b[ray.kx] - ray.ox - ray.sx * bz, by = b[ray.ky] - ray.oy - ray.sy * bz;
+        double cx = c[ray.kx] - ray.ox - ray.sx * cz, cy = c[ray.ky] - ray.oy - ray.sy * cz;
+
+        double u = cx * by - cy * bx;
+        double v = ax * cy - ay * cx;
+        if ((u < 0 && v > 0) || (u > 0 && v < 0))
+            return false;
+        double w = bx * ay - by * ax;
+        if ((u < 0 || v < 0 || w < 0) && (u > 0 || v > 0 || w > 0))
+            return false;
+
+        // 光线与三角形平面平行或三角形退化
+        double det = u + v + w;
+        if (det == 0)
+            return false;
+
+        // 击中时光线行进距离
+        double inv_det = 1. / det;
+        t_hit = (u * az + v * bz + w * cz) * ray.sz * inv_det;
+
+        // 避免数值误差造成交点在三角形内侧，反射再次击中三角形而被遮挡
+        if (!interval.surrounds(t_hit))
+            return false;
+
+        bc1 = v * inv_det;
+        bc2 = w * inv_det;
+        return true;
+    }
+};
+
+#endif // !TRIANGLE_MESH_H
@@ -0,0 +1,231 @@
+/*
+ * 多三角形SIMD求交
+ * 三角形每4个一块，顶点以单精度SoA存储，一条光线用一串指令同时与一块（SSE）或相邻两块（AVX2）中的全部三角形求交，
+ * 返回区间内最近交点的位置和重心坐标
+ * 运行时按CPU支持的指令集选择实现，非x86平台或关闭SIMD时逐个三角形执行相同的运算，各实现结果完全一致
+ * 光线和距离以real表示，SIMD实现只用于单精度构建；双精度构建以双精度逐个计算，作为单精度结果的对照
+ */
+#ifndef TRIANGLE_SIMD_H
+#define TRIANGLE_SIMD_H
+
+#include "hittable.h"
+#include "simd.h"
+
+// 4个三角形的顶点，块内按分量SoA存储，id为三角形编号
+// 不足4个时空位的三个顶点相同，行列式为0，不会被击中
+struct alignas(16) TriangleBlock4
+{
+    float v0[3][4];
+    float v1[3][4];
+    float v2[3][4];
+    uint  id[4];
+};
+
+// WatertightRay的real版本
+struct WatertightRayReal
+{
+    int kx, ky, kz;
+    real ox, oy, oz;
+    real sx, sy, sz;
+
+    WatertightRayReal() : kx(0), ky(1), kz(2), ox(0), oy(0), oz(0), sx(0), sy(0), sz(1) {}
+
+    explicit WatertightRayReal(const WatertightRay& ray)
+        : kx(ray.kx), ky(ray.ky), kz(ray.kz),
+        ox(static_cast<real>(ray.ox)), oy(static_cast<real>(ray.oy)), oz(static_cast<real>(ray.oz)),
+        sx(static_cast<real>(ray.sx)), sy(static_cast<real>(ray.sy)), sz(static_cast<real>(ray.sz)) {}
+};
+
+// 与TriangleMesh::intersect相同的水密求交，运算顺序固定，SIMD实现逐条对应，不使用乘加融合和近似倒数
+class TriangleSimd
+{
+public:
+    // 与blocks[0, block_count)中的三角形求交，t_min < t < t_max
+    // 返回最近交点在块中的位置（块号 * 4 + 通道），t_max改为交点距离；未击中返回-1，不改变t_max
+    // 距离相同时取位置靠前的三角形
+    static int intersect(const TriangleBlock4* blocks, int block_count, const WatertightRayReal& ray,
+        real t_min, real& t_max, real& bc1, real& bc2, SimdLevel level)
+    {
+#if defined(SIMD_X86)
+        if (level == SimdLevel_AVX2)
+            return intersect_avx2(blocks, block_count, ray, t_min, t_max, bc1, bc2);
+        if (level == SimdLevel_SSE)
+            return intersect_sse(blocks, block_count, ray, t_min, t_max, bc1, bc2);
+#endif
+        return intersect_scalar(blocks, block_count, ray, t_min, t_max, bc1, bc2);
+    }
+
+private:
+    static int intersect_scalar(const TriangleBlock4* blocks, int block_count, const WatertightRayReal& ray,
+        real t_min, real& t_max, real& bc1, real& bc2)
+    {
+        int closest = -1;
+        for (int b = 0; b < block_count; ++b)
+        {
+            const TriangleBlock4& block = blocks[b];
+            for (int lane = 0; lane < 4; ++lane)
+            {
+                real az = block.v0[ray.kz][lane] - ray.oz;
+                real bz = block.v1[ray.kz][lane] - ray.oz;
+                real cz = block.v2[ray.kz][lane] - ray.oz;
+                real ax = (block.v0[ray.kx][lane] - ray.ox) - ray.sx * az;
+                real ay = (block.v0[ray.ky][lane] - ray.oy) - ray.sy * az;
+                real bx = (block.v1[ray.kx][lane] - ray.ox) - ray.sx * bz;
+                real by = (block.v1[ray.ky][lane] - ray.oy) - ray.sy * bz;
+                real cx = (block.v2[ray.kx][lane] - ray.ox) - ray.sx * cz;
+                real cy = (block.v2[ray.ky][lane] - ray.oy) - ray.sy * cz;
+
+                real u = cx * by - cy * bx;
+                real v = ax * cy - ay * cx;
+                real w = bx * ay - by * ax;
+                if ((u < 0 || v < 0 || w < 0) && (u > 0 || v > 0 || w > 0))
+                    continue;
+
+                real det = u + v + w;
+                if (det == 0)
+                    continue;
+
+                real t = ((u * az + v * bz) + w * cz) * ray.sz / det;
+                if (t > t_min && t < t_max)
+                {
+                    t_max = t;
+                    bc1 = v / det;
+                    bc2 = w / det;
+                    closest = b * 4 + lane;
+                }
+            }
+        }
+        return closest;
+    }
+
+#if defined(SIMD_X86)
+    static int intersect_sse(const TriangleBlock4* blocks, int block_count, const WatertightRayReal& ray,
+        real t_min, real& t_max, real& bc1, real& bc2)
+    {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 ox = _mm_set1_ps(ray.ox), oy = _mm_set1_ps(ray.oy), oz = _mm_set1_ps(ray.oz);
+        const __m128 sx = _mm_set1_ps(ray.sx), sy = _mm_set1_ps(ray.sy), sz = _mm_set1_ps(ray.sz);
+        const __m128 near_t = _mm_set1_ps(t_min);
+
+        int closest = -1;
+        for (int b = 0; b < block_count; ++b)
+        {
+            const TriangleBlock4& block = blocks[b];
+            __m128 az = _mm_sub_ps(_mm_load_ps(block.v0[ray.kz]), oz);
+            __m128 bz = _mm_sub_ps(_mm_load_ps(block.v1[ray.kz]), oz);
+            __m128 cz = _mm_sub_ps(_mm_load_ps(block.v2[ray.kz]), oz);
+            __m128 ax = _mm_sub_ps(_mm_sub_ps(_mm_load_ps(block.v0[ray.kx]), ox), _mm_mul_ps(sx, az));
+            __m128 ay = _mm_sub_ps(_mm_sub_ps(_mm_load_ps(block.v0[ray.ky]), oy), _mm_mul_ps(sy, az));
+            __m128 bx = _mm_sub_ps(_mm_sub_ps(_mm_load_ps(block.v1[ray.kx]), ox), _mm_mul_ps(sx, bz));
+            __m128 by = _mm_sub_ps(_mm_sub_ps(_mm_load_ps(block.v1[ray.ky]), oy), _mm_mul_ps(sy, bz));
+            __m128 cx = _mm_sub_ps(_mm_sub_ps(_mm_load_ps(block.v2[ray.kx]), ox), _mm_mul_ps(sx, cz));
+            __m128 cy = _mm_sub_ps(_mm_sub_ps(_mm_load_ps(block.v2[ray.ky]), oy), _mm_mul_ps(sy, cz));
+
+            __m128 u = _mm_sub_ps(_mm_mul_ps(cx, by), _mm_mul_ps(cy, bx));
+            __m128 v = _mm_sub_ps(_mm_mul_ps(ax, cy), _mm_mul_ps(ay, cx));
+            __m128 w = _mm_sub_ps(_mm_mul_ps(bx, ay), _mm_mul_ps(by, ax));
+            __m128 negative = _mm_or_ps(_mm_or_ps(_mm_cmplt_ps(u, zero), _mm_cmplt_ps(v, zero)), _mm_cmplt_ps(w, zero));
+            __m128 positive = _mm_or_ps(_mm_or_ps(_mm_cmpgt_ps(u, zero), _mm_cmpgt_ps(v, zero)), _mm_cmpgt_ps(w, zero));
+
+            __m128 det = _mm_add_ps(_mm_add_ps(u, v), w);
+            __m128 t = _mm_div_ps(_mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(u, az), _mm_mul_ps(v, bz)), _mm_mul_ps(w, cz)), sz), det);
+            __m128 valid = _mm_andnot_ps(_mm_and_ps(negative, positive), _mm_cmpneq_ps(det, zero));
+            valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpgt_ps(t, near_t), _mm_cmplt_ps(t, _mm_set1_ps(t_max))));
+
+            int mask = _mm_movemask_ps(valid);
+            if (mask == 0)
+                continue;
+
+            alignas(16) float ts[4], vs[4], ws[4], dets[4];
+            _mm_store_ps(ts, t);
+            _mm_store_ps(vs, v);
+            _mm_store_ps(ws, w);
+            _mm_store_ps(dets, det);
+            closest = select_closest(mask, 4, b * 4, ts, vs, ws, dets, closest, t_max, bc1, bc2);
+        }
+        return closest;
+    }
+
+    // 每次载入相邻两块，不足两块时后一半重复最后一块，由掩码去掉
+    SIMD_AVX2
+    static int intersect_avx2(const TriangleBlock4* blocks, int block_count, const WatertightRayReal& ray,
+        real t_min, real& t_max, real& bc1, real& bc2)
+    {
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 ox = _mm256_set1_ps(ray.ox), oy = _mm256_set1_ps(ray.oy), oz = _mm256_set1_ps(ray.oz);
+        const __m256 sx = _mm256_set1_ps(ray.sx), sy = _mm256_set1_ps(ray.sy), sz = _mm256_set1_ps(ray.sz);
+        const __m256 near_t = _mm256_set1_ps(t_min);
+
+        int closest = -1;
+        for (int b = 0; b < block_count; b += 2)
+        {
+            const TriangleBlock4& lo = blocks[b];
+            const TriangleBlock4& hi = blocks[std::min(b + 1, block_count - 1)];
+            __m256 az = _mm256_sub_ps(load(lo.v0[ray.kz], hi.v0[ray.kz]), oz);
+            __m256 bz = _mm256_sub_ps(load(lo.v1[ray.kz], hi.v1[ray.kz]), oz);
+            __m256 cz = _mm256_sub_ps(load(lo.v2[ray.kz], hi.v2[ray.kz]), oz);
+            __m256 ax = _mm256_sub_ps(_mm256_sub_ps(load(lo.v0[ray.kx], hi.v0[ray.kx]), ox), _mm256_mul_ps(sx, az));
+            __m256 ay = _mm256_sub_ps(_mm256_sub_ps(load(lo.v0[ray.ky], hi.v0[ray.ky]), oy), _mm256_mul_ps(sy, az));
+            __m256 bx = _mm256_sub_ps(_mm256_sub_ps(load(lo.v1[ray.kx], hi.v1[ray.kx]), ox), _mm256_mul_ps(sx, bz));
+            __m256 by = _mm256_sub_ps(_mm256_sub_ps(load(lo.v1[ray.ky], hi.v1[ray.ky]), oy), _mm256_mul_ps(sy, bz));
+            __m256 cx = _mm256_sub_ps(_mm256_sub_ps(load(lo.v2[ray.kx], hi.v2[ray.kx]), ox), _mm256_mul_ps(sx, cz));
+            __m256 cy = _mm256_sub_ps(_mm256_sub_ps(load(lo.v2[ray.ky], hi.v2[ray.ky]), oy), _mm256_mul_ps(sy, cz));
+
+            __m256 u = _mm256_sub_ps(_mm256_mul_ps(cx, by), _mm256_mul_ps(cy, bx));
+            __m256 v = _mm256_sub_ps(_mm256_mul_ps(ax, cy), _mm256_mul_ps(ay, cx));
+            __m256 w = _mm256_sub_ps(_mm256_mul_ps(bx, ay), _mm256_mul_ps(by, ax));
+            __m256 negative = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(u, zero, _CMP_LT_OQ), _mm256_cmp_ps(v, zero, _CMP_LT_OQ)),
+                _mm256_cmp_ps(w, zero, _CMP_LT_OQ));
+            __m256 positive = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(u, zero, _CMP_GT_OQ), _mm256_cmp_ps(v, zero, _CMP_GT_OQ)),
+                _mm256_cmp_ps(w, zero, _CMP_GT_OQ));
+
+            __m256 det = _mm256_add_ps(_mm256_add_ps(u, v), w);
+            __m256 t = _mm256_div_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(u, az), _mm256_mul_ps(v, bz)),
+                _mm256_mul_ps(w, cz)), sz), det);
+            __m256 valid = _mm256_andnot_ps(_mm256_and_ps(negative, positive), _mm256_cmp_ps(det, zero, _CMP_NEQ_UQ));
+            valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(t, near_t, _CMP_GT_OQ),
+                _mm256_cmp_ps(t, _mm256_set1_ps(t_max), _CMP_LT_OQ)));
+
+            int mask = _mm256_movemask_ps(valid);
+            if (b + 1 == block_count)
+                mask &= 0xf;
+            if (mask == 0)
+                continue;
+
+            alignas(32) float ts[8], vs[8], ws[8], dets[8];
+            _mm256_store_ps(ts, t);
+            _mm256_store_ps(vs, v);
+            _mm256_store_ps(ws, w);
+            _mm256_store_ps(dets, det);
+            closest = select_closest(mask, 8, b * 4, ts, vs, ws, dets, closest, t_max, bc1, bc2);
+        }
+        return closest;
+    }
+
+    // 两块中同一分量的4个值拼成一个寄存器
+    SIMD_AVX2
+    static __m256 load(const float* lo, const float* hi)
+    {
+        return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_load_ps(lo)), _mm_load_ps(hi), 1);
+    }
+
+    // 按位置顺序在击中的通道中选出最近的，与标量实现逐个比较的结果相同
+    static int select_closest(int mask, int lanes, int first, const float* ts, const float* vs, const float* ws, const float* dets,
+        int closest, real& t_max, real& bc1, real& bc2)
+    {
+        for (int lane = 0; lane < lanes; ++lane)
+        {
+            if ((mask & (1 << lane)) && ts[lane] < t_max)
+            {
+                t_max = ts[lane];
+                bc1 = vs[lane] / dets[lane];
+                bc2 = ws[lane] / dets[lane];
+                closest = first + lane;
+            }
+        }
+        return closest;
+    }
+#endif
+};
+
+#endif // !TRIANGLE_SIMD_H
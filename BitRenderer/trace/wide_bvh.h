@@ -0,0 +1,833 @@
+/*
+ * 多叉BVH类
+ * 将二叉构建结果折叠为4叉或8叉树，每个节点以SoA方式存储各子节点的单精度包围盒，
+ * 用SSE/AVX2一次完成全部子节点的slab测试，再按击中距离由近及远遍历，运行时按CPU支持的指令集选择
+ * 光线和距离以real表示，双精度构建以双精度逐个子节点测试，作为单精度SIMD结果的对照
+ * 可选量化节点：子节点包围盒以父节点包围盒为基准量化为8位整数
+ */
+#ifndef WIDE_BVH_H
+#define WIDE_BVH_H
+
+#include <immintrin.h>
+
+#include "linear_bvh.h"
+#include "simd.h"
+
+// N个子节点的包围盒按轴连续存放，便于一次载入一个SIMD寄存器
+template <int N>
+struct alignas(32) WideBVHNode
+{
+    float bbox_min[3][N];
+    float bbox_max[3][N];
+    uint  child[N];       // 内部子节点：节点索引；叶子节点：首个图元索引
+    uint  object_count[N]; // 叶子节点图元数，内部子节点为0
+    uint  child_count;     // 有效子节点数
+};
+
+// 参见 Ylitie et al. 2017, Efficient Incoherent Ray Traversal on GPUs Through Compressed Wide BVHs
+// 子节点包围盒为origin + q * 2^exponent，q为8位整数，量化时向外取整保证包围盒不变小
+// 内部子节点按子节点顺序连续存放，各叶子节点的图元也按子节点顺序连续存放，只需记录两个起始索引
+template <int N>
+struct QuantizedBVHNode
+{
+    float origin[3];
+    schar exponent[3];
+    uchar child_count;     // 有效子节点数
+    uchar q_min[3][N];
+    uchar q_max[3][N];
+    uint  child_base;      // 首个内部子节点的节点索引
+    uint  object_base;     // 首个叶子节点的首个图元索引
+    uchar object_count[N]; // 叶子节点图元数，内部子节点为0
+};
+
+template <int N, bool Quantized = false>
+class WideBVH : public Hittable
+{
+    static_assert(N == 4 || N == 8, "WideBVH supports 4 or 8 children");
+
+    using Node = std::conditional_t<Quantized, QuantizedBVHNode<N>, WideBVHNode<N>>;
+
+private:
+    static const int kStackSize = 512;
+    // 多叉树深度不超过二叉树，每层最多压入N-1个子节点
+    static_assert((N - 1) * BVHBuilder::kMaxDepth + 1 <= kStackSize, "WideBVH stack may overflow");
+
+    // 待访问的子节点及其进入距离
+    struct StackEntry
+    {
+        uint child;
+        uint object_count;
+        real t;
+    };
+
+    static const int kRefitTaskDepth = N == 4 ? 2 : 1; // refit时此深度以上的内部子节点作为并行任务
+
+    std::vector<Node> nodes_;
+    std::vector<shared_ptr<Hittable>> objects_; // 按叶节点顺序排列的图元
+    LeafPrimitives leaves_; // 叶节点中三角形的SoA数据
+    shared_ptr<Hittable> root_leaf_; // 整棵树只有一个叶节点时直接求交
+    AABB bbox_;
+    BVHBuildOption option_;
+    SimdLevel simd_; // 节点测试使用的指令集，8叉节点在支持AVX2时一次测试全部子节点
+    bool duplicated_ = false; // SBVH中图元可能被多个叶节点引用
+    double built_sah_cost_ = 0.; // 构建时的SAH代价，用于判断refit后是否需要重建
+
+public:
+    WideBVH() = delete;
+
+    WideBVH(const HittableList& list, const BVHBuildOption& option)
+        : option_(option), simd_(simd_level_for<real>())
+    {
+        build(list.get_objects());
+        if (nodes_.empty())
+            return;
+
+        double primitive_count = static_cast<double>(std::max<size_t>(list.get_objects().size(), 1));
+        add_info("BVH" + STR(N) + " node bytes per primitive: float "
+            + STR(nodes_.size() * sizeof(WideBVHNode<N>) / primitive_count) + ", quantized "
+            + STR(nodes_.size() * sizeof(QuantizedBVHNode<N>) / primitive_count));
+    }
+
+    WideBVH(const WideBVH&) = delete;
+    WideBVH& operator=(const WideBVH&) = delete;
+
+    WideBVH(WideBVH&&) = delete;
+    WideBVH& operator=(WideBVH&&) = delete;
+
+public:
+    bool hit(const Ray& r, const Interval& interval, HitRecord& rec)
+        const override
+    {
+        if (root_leaf_ != nullptr)
+            return root_leaf_->hit(r, interval, rec);
+        if (nodes_.empty())
+            return false;
+
+        const WatertightRay watertight(r);
+        Point3 origin = r.get_origin();
+        Vec3 inv_dir = 1. / r.get_direction();
+        real o[3], inv[3];
+        for (int a = 0; a < 3; ++a)
+        {
+            o[a] = static_cast<real>(origin[a]);
+            inv[a] = static_cast<real>(inv_dir[a]);
+        }
+
+        double closest_so_far = interval.get_max();
+        bool hit_anything = false;
+        DeferredHit deferred;
+
+        real t_min = round_down_real(interval.get_min());
+        real t_max = far_bound(closest_so_far);
+
+        ullong visited = 0, tested = 0;
+        Mailbox mailbox;
+
+        StackEntry stack[kStackSize];
+        int top = 0;
+        stack[top++] = { 0, 0, t_min };
+
+        while (top > 0)
+        {
+            StackEntry entry = stack[--top];
+            // 压栈后已找到更近的交点
+            if (entry.t > t_max)
+                continue;
+
+            if (entry.object_count > 0)
+            {
+                for (uint i = entry.child; i < entry.child + entry.object_count; ++i)
+                {
+                    if (leaves_.duplicated() && mailbox.test_and_set(leaves_.id(i)))
+                        continue;
+                    ++tested;
+                    if (leaves_.intersect(objects_, i, r, watertight, Interval(interval.get_min(), closest_so_far), deferred, rec))
+                    {
+                        hit_anything = true;
+                        closest_so_far = deferred.t;
+                        t_max = far_bound(closest_so_far);
+                    }
+                }
+                continue;
+            }
+
+            const Node& node = nodes_[entry.child];
+            ++visited;
+            alignas(32) real t_near[N];
+            uint mask = node_hit(node, o, inv, t_min, t_max, t_near, simd_);
+            mask &= (1u << node.child_count) - 1;
+            if (mask == 0)
+                continue;
+            uint buffer[N];
+            const uint* child = children(node, buffer);
+
+            // 击中的子节点按距离由远及近压栈，最近的先出栈
+            int first = top;
+            for (int c = 0; c < N; ++c)
+            {
+                if (!(mask & (1u << c)))
+                    continue;
+
+                StackEntry e = { child[c], node.object_count[c], t_near[c] };
+                int k = top++;
+                for (; k > first && stack[k - 1].t < e.t; --k)
+                    stack[k] = stack[k - 1];
+                stack[k] = e;
+            }
+        }
+
+        record_traversal(visited, tested);
+        if (hit_anything)
+            resolve(r, deferred, rec);
+        return hit_anything;
+    }
+
+    // 整包遍历，逐个子节点做整包测试，击中的子节点按首条活跃光线的进入距离排序压栈
+    void hit_packet(RayPacket& packet)
+        const override
+    {
+        struct PacketEntry
+        {
+            uint child;
+            uint object_count;
+            int first;
+            float bbox_min[3], bbox_max[3]; // 叶子节点的包围盒，出栈时筛选击中的光线
+        };
+
+        if (root_leaf_ != nullptr)
+        {
+            root_leaf_->hit_packet(packet);
+            return;
+        }
+        if (nodes_.empty() || packet.size == 0)
+            return;
+
+        DeferredHit deferred[RayPacket::kMaxSize];
+        ullong visited = 0, tested = 0;
+
+        PacketEntry stack[kStackSize];
+        double stack_t[kStackSize];
+        int top = 0;
+        stack[top++] = { 0, 0, 0, {}, {} };
+
+        while (top > 0)
+        {
+            PacketEntry entry = stack[--top];
+            if (entry.object_count > 0)
+            {
+                int active[RayPacket::kMaxSize];
+                int count = packet.active_rays(entry.bbox_min, entry.bbox_max, entry.first, active);
+                tested += static_cast<ullong>(entry.object_count) * count;
+                leaves_.intersect_packet(objects_, entry.child, entry.child + entry.object_count, packet, active, count, deferred);
+                continue;
+            }
+
+            const Node& node = nodes_[entry.child];
+            ++visited;
+            alignas(32) float bbox_min[3][N];
+            alignas(32) float bbox_max[3][N];
+            node_bounds(node, bbox_min, bbox_max);
+            uint buffer[N];
+            const uint* child = children(node, buffer);
+
+            int bottom = top;
+            for (uint c = 0; c < node.child_count; ++c)
+            {
+                const float child_min[3] = { bbox_min[0][c], bbox_min[1][c], bbox_min[2][c] };
+                const float child_max[3] = { bbox_max[0][c], bbox_max[1][c], bbox_max[2][c] };
+                double t_near;
+                int first = packet.first_hit(child_min, child_max, entry.first, t_near);
+                if (first >= packet.size)
+                    continue;
+
+                // 由远及近排列，最近的先出栈
+                PacketEntry e = { child[c], node.object_count[c], first,
+                    { child_min[0], child_min[1], child_min[2] }, { child_max[0], child_max[1], child_max[2] } };
+                int k = top++;
+                for (; k > bottom && stack_t[k - 1] < t_near; --k)
+                {
+                    stack[k] = stack[k - 1];
+                    stack_t[k] = stack_t[k - 1];
+                }
+                stack[k] = e;
+                stack_t[k] = t_near;
+            }
+        }
+
+        LeafPrimitives::resolve_packet(packet, deferred);
+        record_traversal(visited, tested);
+    }
+
+    // 找到任意交点即返回，击中的子节点不排序直接压栈
+    bool occluded(const Ray& r, const Interval& interval)
+        const override
+    {
+        if (root_leaf_ != nullptr)
+            return root_leaf_->occluded(r, interval);
+        if (nodes_.empty())
+            return false;
+
+        const WatertightRay watertight(r);
+        Point3 origin = r.get_origin();
+        Vec3 inv_dir = 1. / r.get_direction();
+        real o[3], inv[3];
+        for (int a = 0; a < 3; ++a)
+        {
+            o[a] = static_cast<real>(origin[a]);
+            inv[a] = static_cast<real>(inv_dir[a]);
+        }
+
+        real t_min = round_down_real(interval.get_min());
+        real t_max = far_bound(interval.get_max());
+        ullong visited = 0, tested = 0;
+        bool hit_anything = false;
+
+        StackEntry stack[kStackSize];
+        int top = 0;
+        stack[top++] = { 0, 0, t_min };
+
+        while (top > 0 && !hit_anything)
+        {
+            StackEntry entry = stack[--top];
+            if (entry.object_count > 0)
+            {
+                for (uint i = entry.child; i < entry.child + entry.object_count && !hit_anything; ++i, ++tested)
+                    hit_anything = leaves_.is_triangle(i) ? leaves_.intersect(i, watertight, interval) : objects_[i]->occluded(r, interval);
+                continue;
+            }
+
+            const Node& node = nodes_[entry.child];
+            ++visited;
+            alignas(32) real t_near[N];
+            uint mask = node_hit(node, o, inv, t_min, t_max, t_near, simd_);
+            mask &= (1u << node.child_count) - 1;
+            if (mask == 0)
+                continue;
+            uint buffer[N];
+            const uint* child = children(node, buffer);
+
+            for (int c = 0; c < N; ++c)
+            {
+                if (mask & (1u << c))
+                    stack[top++] = { child[c], node.object_count[c], t_near[c] };
+            }
+        }
+
+        record_traversal(visited, tested);
+        return hit_anything;
+    }
+
+    AABB get_bbox()
+        const override
+    {
+        return bbox_;
+    }
+
+    // 保持树结构，自底向上更新子节点包围盒，量化节点按新包围盒重新量化
+    // SAH代价相比构建时增长超过refit_threshold倍时完全重建
+    void refit()
+        override
+    {
+        if (root_leaf_ != nullptr)
+        {
+            root_leaf_->refit();
+            bbox_ = root_leaf_->get_bbox();
+            return;
+        }
+        if (nodes_.empty())
+            return;
+
+        refit_objects(objects_, duplicated_);
+        leaves_.refit(objects_);
+        bbox_ = refit_node(0, 0);
+
+        double cost = sah_cost();
+        if (cost > built_sah_cost_ * option_.layout.refit_threshold)
+        {
+            add_info("BVH" + STR(N) + " SAH cost " + STR(built_sah_cost_) + " -> " + STR(cost) + " after refit, rebuild.");
+            option_.builder.mesh_hash = 0; // 几何已改变，不能再用缓存
+            build(duplicated_ ? unique_objects(objects_) : std::vector<shared_ptr<Hittable>>(objects_));
+        }
+    }
+
+    // 多叉树的SAH代价：每个多叉节点计一次遍历代价，叶子节点计图元数，均以相对根节点的表面积加权
+    double sah_cost()
+        const
+    {
+        double root_area = bbox_.surface_area();
+        if (nodes_.empty() || root_area <= 0)
+            return 0.;
+
+        double cost = root_area * option_.builder.traversal_cost;
+        for (const Node& node : nodes_)
+        {
+            for (uint c = 0; c < node.child_count; ++c)
+                cost += child_bbox(node, c).surface_area() * (node.object_count[c] > 0 ? node.object_count[c] : option_.builder.traversal_cost);
+        }
+        return cost / root_area;
+    }
+
+private:
+    void build(const std::vector<shared_ptr<Hittable>>& objects)
+    {
+        BVHBuilder builder(objects, option_.builder);
+        duplicated_ = builder.get_indices().size() != objects.size();
+        nodes_.clear();
+        root_leaf_ = nullptr;
+
+        bbox_ = AABB();
+        for (const auto& object : objects)
+            bbox_ = AABB(bbox_, object->get_bbox());
+
+        // 折叠时各多叉节点的叶子节点图元依次追加，同一节点的叶子节点图元连续
+        const auto& build_nodes = builder.get_nodes();
+        std::vector<uint> indices;
+        int depth = 0;
+        if (!build_nodes.empty() && build_nodes[0].count == 0)
+        {
+            indices.reserve(builder.get_indices().size());
+            nodes_.emplace_back();
+            collapse(build_nodes, builder.get_indices(), 0, 0, 1, depth, indices);
+            assert((N - 1) * depth + 1 <= kStackSize);
+        }
+        else
+        {
+            indices = builder.get_indices();
+        }
+
+        objects_.clear();
+        objects_.reserve(indices.size());
+        for (uint i : indices)
+            objects_.emplace_back(objects[i]);
+        leaves_.build(objects_, indices, duplicated_);
+
+        if (build_nodes.empty())
+            return;
+
+        if (build_nodes[0].count > 0)
+        {
+            auto leaf = make_shared<HittableList>();
+            for (const auto& object : objects_)
+                leaf->add(object);
+            root_leaf_ = leaf;
+            return;
+        }
+
+        built_sah_cost_ = sah_cost();
+
+        // 统计的是折叠前的二叉树，内存为多叉节点
+        if (option_.quality_report)
+            builder.report_quality("BVH" + STR(N), nodes_.size() * sizeof(Node) + leaves_.memory_bytes()
+                + objects_.size() * sizeof(shared_ptr<Hittable>));
+    }
+
+    // 返回多叉节点index的新包围盒，子节点索引总大于父节点
+    AABB refit_node(uint index, int depth)
+    {
+        Node& node = nodes_[index];
+        WideBVHNode<N> wide = {};
+        AABB child_bboxes[N];
+        std::future<AABB> tasks[N];
+        wide.child_count = node.child_count;
+        uint buffer[N];
+        std::copy_n(children(node, buffer), wide.child_count, wide.child);
+
+        for (uint c = 0; c < wide.child_count; ++c)
+        {
+            wide.object_count[c] = node.object_count[c];
+
+            if (wide.object_count[c] > 0)
+            {
+                for (uint i = wide.child[c]; i < wide.child[c] + wide.object_count[c]; ++i)
+                    child_bboxes[c] = AABB(child_bboxes[c], objects_[i]->get_bbox());
+            }
+            else if (depth < kRefitTaskDepth)
+            {
+                uint child = wide.child[c];
+                tasks[c] = std::async(std::launch::async, [this, child, depth] { return refit_node(child, depth + 1); });
+            }
+            else
+            {
+                child_bboxes[c] = refit_node(wide.child[c], depth + 1);
+            }
+        }
+
+        AABB bbox;
+        for (uint c = 0; c < wide.child_count; ++c)
+        {
+            if (tasks[c].valid())
+                child_bboxes[c] = tasks[c].get();
+            bbox = AABB(bbox, child_bboxes[c]);
+
+            for (int a = 0; a < 3; ++a)
+            {
+                wide.bbox_min[a][c] = round_down_float(child_bboxes[c].axis(a).get_min());
+                wide.bbox_max[a][c] = round_up_float(child_bboxes[c].axis(a).get_max());
+            }
+        }
+
+        encode(wide, bbox, child_bboxes, node);
+        return bbox;
+    }
+
+    static AABB child_bbox(const WideBVHNode<N>& node, int c)
+    {
+        return AABB(
+            Interval(node.bbox_min[0][c], node.bbox_max[0][c]),
+            Interval(node.bbox_min[1][c], node.bbox_max[1][c]),
+            Interval(node.bbox_min[2][c], node.bbox_max[2][c]));
+    }
+
+    static AABB child_bbox(const QuantizedBVHNode<N>& node, int c)
+    {
+        Interval axes[3];
+        for (int a = 0; a < 3; ++a)
+        {
+            float scale = exponent_scale(node.exponent[a]);
+            axes[a] = Interval(decode(node.origin[a], node.q_min[a][c], scale), decode(node.origin[a], node.q_max[a][c], scale));
+        }
+        return AABB(axes[0], axes[1], axes[2]);
+    }
+
+    // 参见 Wald et al. 2008, Getting Rid of Packets
+    // 将二叉节点index的子树折叠为多叉节点node_index：反复展开表面积最大的内部子节点，直到子节点数达到N
+    // 内部子节点在节点数组末尾连续分配后再逐个折叠，叶子节点的图元索引按子节点顺序追加到indices
+    // depth记录多叉树深度
+    void collapse(const std::vector<BVHBuildNode>& build_nodes, const std::vector<uint>& build_indices, uint index, uint node_index,
+        int level, int& depth, std::vector<uint>& indices)
+    {
+        depth = std::max(depth, level);
+
+        uint children[N];
+        int count = 0;
+        children[count++] = index + 1;
+        children[count++] = build_nodes[index].offset;
+
+        while (count < N)
+        {
+            int best = -1;
+            double best_area = -1.;
+            for (int c = 0; c < count; ++c)
+            {
+                const BVHBuildNode& b = build_nodes[children[c]];
+                if (b.count == 0 && b.bbox.surface_area() > best_area)
+                {
+                    best = c;
+                    best_area = b.bbox.surface_area();
+                }
+            }
+            if (best == -1)
+                break;
+
+            uint expanded = children[best];
+            children[best] = expanded + 1;
+            children[count++] = build_nodes[expanded].offset;
+        }
+
+        WideBVHNode<N> node = {};
+        AABB child_bboxes[N];
+        node.child_count = count;
+        uint next_node = static_cast<uint>(nodes_.size());
+
+        for (int c = 0; c < N; ++c)
+        {
+            if (c >= count)
+            {
+                for (int a = 0; a < 3; ++a)
+                    node.bbox_min[a][c] = node.bbox_max[a][c] = 0.f;
+                continue;
+            }
+
+            const BVHBuildNode& b = build_nodes[children[c]];
+            child_bboxes[c] = b.bbox;
+            for (int a = 0; a < 3; ++a)
+            {
+                node.bbox_min[a][c] = round_down_float(b.bbox.axis(a).get_min());
+                node.bbox_max[a][c] = round_up_float(b.bbox.axis(a).get_max());
+            }
+
+            node.object_count[c] = b.count;
+            if (b.count > 0)
+            {
+                node.child[c] = static_cast<uint>(indices.size());
+                indices.insert(indices.end(), build_indices.begin() + b.offset, build_indices.begin() + b.offset + b.count);
+            }
+            else
+            {
+                node.child[c] = next_node++;
+            }
+        }
+
+        nodes_.resize(next_node);
+        encode(node, build_nodes[index].bbox, child_bboxes, nodes_[node_index]);
+
+        for (int c = 0; c < count; ++c)
+        {
+            if (node.object_count[c] == 0)
+                collapse(build_nodes, build_indices, children[c], node.child[c], level + 1, depth, indices);
+        }
+    }
+
+    // 各子节点的节点索引（内部子节点）或首个图元索引（叶子节点），单精度节点直接存储
+    static const uint* children(const WideBVHNode<N>& node, uint*)
+    {
+        return node.child;
+    }
+
+    // 量化节点由两个起始索引依次累加得到，写入buffer
+    static const uint* children(const QuantizedBVHNode<N>& node, uint* buffer)
+    {
+        uint next_node = node.child_base, next_object = node.object_base;
+        for (uint c = 0; c < node.child_count; ++c)
+        {
+            buffer[c] = node.object_count[c] > 0 ? next_object : next_node++;
+            next_object += node.object_count[c];
+        }
+        return buffer;
+    }
+
+    static void encode(const WideBVHNode<N>& wide, const AABB&, const AABB*, WideBVHNode<N>& node)
+    {
+        node = wide;
+    }
+
+    // 每个轴取父节点包围盒最小值为原点，取能覆盖父节点包围盒的最小2的幂为量化步长
+    // 子节点包围盒的最小值向下、最大值向上取整，并按解码时的单精度运算校验
+    static void encode(const WideBVHNode<N>& wide, const AABB& parent, const AABB* child_bboxes, QuantizedBVHNode<N>& node)
+    {
+        node = {};
+        node.child_count = static_cast<uchar>(wide.child_count);
+        bool first_node = true, first_object = true;
+        for (uint c = 0; c < wide.child_count; ++c)
+        {
+            assert(wide.object_count[c] <= std::numeric_limits<uchar>::max());
+            node.object_count[c] = static_cast<uchar>(wide.object_count[c]);
+            if (wide.object_count[c] == 0 && first_node)
+            {
+                node.child_base = wide.child[c];
+                first_node = false;
+            }
+            if (wide.object_count[c] > 0 && first_object)
+            {
+                node.object_base = wide.child[c];
+                first_object = false;
+            }
+        }
+
+        for (int a = 0; a < 3; ++a)
+        {
+            float origin = round_down_float(parent.axis(a).get_min());
+            int exponent;
+            std::frexp(std::max((parent.axis(a).get_max() - origin) / 255., 0.), &exponent);
+            exponent = std::clamp(exponent, -126, 127);
+            while (exponent < 127 && decode(origin, 255, exponent_scale(exponent)) < parent.axis(a).get_max())
+                ++exponent;
+
+            float scale = exponent_scale(exponent);
+            node.origin[a] = origin;
+            node.exponent[a] = static_cast<schar>(exponent);
+
+            for (uint c = 0; c < wide.child_count; ++c)
+            {
+                double min = child_bboxes[c].axis(a).get_min();
+                double max = child_bboxes[c].axis(a).get_max();
+
+                int q_min = std::clamp(static_cast<int>(std::floor((min - origin) / scale)), 0, 255);
+                while (q_min > 0 && decode(origin, q_min, scale) > min)
+                    --q_min;
+
+                int q_max = std::clamp(static_cast<int>(std::ceil((max - origin) / scale)), 0, 255);
+                while (q_max < 255 && decode(origin, q_max, scale) < max)
+                    ++q_max;
+
+                node.q_min[a][c] = static_cast<uchar>(q_min);
+                node.q_max[a][c] = static_cast<uchar>(q_max);
+            }
+        }
+    }
+
+    // 2^exponent，直接构造单精度数的指数位
+    static float exponent_scale(int exponent)
+    {
+        uint bits = static_cast<uint>(exponent + 127) << 23;
+        float scale;
+        std::memcpy(&scale, &bits, sizeof(float));
+        return scale;
+    }
+
+    static float decode(float origin, int q, float scale)
+    {
+        return origin + static_cast<float>(q) * scale;
+    }
+
+    // 参见 PBRT 6.1.2
+    // 计算的距离有舍入误差，离开距离放大1+2*gamma(3)倍，保证不漏掉实际击中的包围盒
+    static real far_scale()
+    {
+        return 1 + 2 * error_gamma(3);
+    }
+
+    static real far_bound(double t)
+    {
+        return round_up_real(t) * far_scale();
+    }
+
+    static uint node_hit(const WideBVHNode<N>& node, const real o[3], const real inv[3], real t_min, real t_max, real* t_near,
+        SimdLevel simd)
+    {
+        return slab_hit(node.bbox_min, node.bbox_max, o, inv, t_min, t_max, t_near, simd);
+    }
+
+    static uint node_hit(const QuantizedBVHNode<N>& node, const real o[3], const real inv[3], real t_min, real t_max, real* t_near,
+        SimdLevel simd)
+    {
+        alignas(32) float bbox_min[3][N];
+        alignas(32) float bbox_max[3][N];
+        if constexpr (N == 8 && std::is_same_v<real, float>)
+        {
+            if (simd == SimdLevel_AVX2)
+            {
+                node_bounds_avx2(node, bbox_min, bbox_max);
+                return slab_hit_avx2(bbox_min, bbox_max, o, inv, t_min, t_max, t_near);
+            }
+        }
+        node_bounds(node, bbox_min, bbox_max);
+        return slab_hit(bbox_min, bbox_max, o, inv, t_min, t_max, t_near, simd);
+    }
+
+    static void node_bounds(const WideBVHNode<N>& node, float (&bbox_min)[3][N], float (&bbox_max)[3][N])
+    {
+        std::memcpy(bbox_min, node.bbox_min, sizeof(bbox_min));
+        std::memcpy(bbox_max, node.bbox_max, sizeof(bbox_max));
+    }
+
+    // 用SSE将8位整数解码为单精度包围盒，运算与encode中的decode一致
+    static void node_bounds(const QuantizedBVHNode<N>& node, float (&bbox_min)[3][N], float (&bbox_max)[3][N])
+    {
+        const __m128i zero = _mm_setzero_si128();
+
+        for (int a = 0; a < 3; ++a)
+        {
+            __m128 origin = _mm_set1_ps(node.origin[a]);
+            __m128 scale = _mm_set1_ps(exponent_scale(node.exponent[a]));
+            for (int g = 0; g < N; g += 4)
+            {
+                int q_min, q_max;
+                std::memcpy(&q_min, node.q_min[a] + g, sizeof(int));
+                std::memcpy(&q_max, node.q_max[a] + g, sizeof(int));
+                __m128i min = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(q_min), zero), zero);
+                __m128i max = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(q_max), zero), zero);
+                _mm_store_ps(bbox_min[a] + g, _mm_add_ps(origin, _mm_mul_ps(_mm_cvtepi32_ps(min), scale)));
+                _mm_store_ps(bbox_max[a] + g, _mm_add_ps(origin, _mm_mul_ps(_mm_cvtepi32_ps(max), scale)));
+            }
+        }
+    }
+
+    // 8个子节点用AVX2一次解码，运算与SSE解码相同；整行写入，随后整行载入时不会因拼接两次写入而停顿
+    SIMD_AVX2
+    static void node_bounds_avx2(const QuantizedBVHNode<N>& node, float (&bbox_min)[3][N], float (&bbox_max)[3][N])
+    {
+        for (int a = 0; a < 3; ++a)
+        {
+            __m256 origin = _mm256_set1_ps(node.origin[a]);
+            __m256 scale = _mm256_set1_ps(exponent_scale(node.exponent[a]));
+            __m256i min = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(node.q_min[a])));
+            __m256i max = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(node.q_max[a])));
+            _mm256_store_ps(bbox_min[a], _mm256_add_ps(origin, _mm256_mul_ps(_mm256_cvtepi32_ps(min), scale)));
+            _mm256_store_ps(bbox_max[a], _mm256_add_ps(origin, _mm256_mul_ps(_mm256_cvtepi32_ps(max), scale)));
+        }
+    }
+
+    // 一次测试全部子节点，返回击中掩码，t_near为各子节点的进入距离
+    // SIMD实现以单精度计算，只用于单精度构建
+    static uint slab_hit(const float (&bbox_min)[3][N], const float (&bbox_max)[3][N],
+        const real o[3], const real inv[3], real t_min, real t_max, real* t_near, SimdLevel simd)
+    {
+        if constexpr (std::is_same_v<real, float>)
+        {
+            if constexpr (N == 8)
+            {
+                if (simd == SimdLevel_AVX2)
+                    return slab_hit_avx2(bbox_min, bbox_max, o, inv, t_min, t_max, t_near);
+            }
+            if (simd != SimdLevel_Scalar)
+                return slab_hit_sse(bbox_min, bbox_max, o, inv, t_min, t_max, t_near);
+        }
+        return slab_hit_scalar(bbox_min, bbox_max, o, inv, t_min, t_max, t_near);
+    }
+
+    // 逐个子节点以real计算，比较方式与SSE实现相同
+    static uint slab_hit_scalar(const float (&bbox_min)[3][N], const float (&bbox_max)[3][N],
+        const real o[3], const real inv[3], real t_min, real t_max, real* t_near)
+    {
+        const real kScale = far_scale();
+        uint mask = 0;
+        for (int c = 0; c < N; ++c)
+        {
+            real near_t = t_min, far_t = t_max;
+            for (int a = 0; a < 3; ++a)
+            {
+                real t0 = (bbox_min[a][c] - o[a]) * inv[a];
+                real t1 = (bbox_max[a][c] - o[a]) * inv[a];
+                real lo = t0 < t1 ? t0 : t1;
+                real hi = (t0 > t1 ? t0 : t1) * kScale;
+                near_t = lo > near_t ? lo : near_t;
+                far_t = hi < far_t ? hi : far_t;
+            }
+            t_near[c] = near_t;
+            if (near_t <= far_t)
+                mask |= 1u << c;
+        }
+        return mask;
+    }
+
+    // 光线分量为0时t0、t1可能为NaN，SSE的min/max在有NaN时返回第二个操作数，令NaN不影响结果
+    static uint slab_hit_sse(const float (&bbox_min)[3][N], const float (&bbox_max)[3][N],
+        const float o[3], const float inv[3], float t_min, float t_max, float* t_near)
+    {
+        const float kScale = far_scale();
+        uint mask = 0;
+
+        // 每次处理4个子节点
+        for (int g = 0; g < N; g += 4)
+        {
+            __m128 near_t = _mm_set1_ps(t_min);
+            __m128 far_t = _mm_set1_ps(t_max);
+            for (int a = 0; a < 3; ++a)
+            {
+                __m128 origin = _mm_set1_ps(o[a]);
+                __m128 inv_dir = _mm_set1_ps(inv[a]);
+                __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(bbox_min[a] + g), origin), inv_dir);
+                __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(bbox_max[a] + g), origin), inv_dir);
+                near_t = _mm_max_ps(_mm_min_ps(t0, t1), near_t);
+                far_t = _mm_min_ps(_mm_mul_ps(_mm_max_ps(t0, t1), _mm_set1_ps(kScale)), far_t);
+            }
+            _mm_store_ps(t_near + g, near_t);
+            mask |= static_cast<uint>(_mm_movemask_ps(_mm_cmple_ps(near_t, far_t))) << g;
+        }
+        return mask;
+    }
+
+    // 8个子节点一次测试，运算与SSE实现逐条对应，结果相同
+    SIMD_AVX2
+    static uint slab_hit_avx2(const float (&bbox_min)[3][N], const float (&bbox_max)[3][N],
+        const float o[3], const float inv[3], float t_min, float t_max, float* t_near)
+    {
+        const float kScale = far_scale();
+        __m256 near_t = _mm256_set1_ps(t_min);
+        __m256 far_t = _mm256_set1_ps(t_max);
+        for (int a = 0; a < 3; ++a)
+        {
+            __m256 origin = _mm256_set1_ps(o[a]);
+            __m256 inv_dir = _mm256_set1_ps(inv[a]);
+            __m256 t0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(bbox_min[a]), origin), inv_dir);
+            __m256 t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(bbox_max[a]), origin), inv_dir);
+            near_t = _mm256_max_ps(_mm256_min_ps(t0, t1), near_t);
+            far_t = _mm256_min_ps(_mm256_mul_ps(_mm256_max_ps(t0, t1), _mm256_set1_ps(kScale)), far_t);
+        }
+        _mm256_store_ps(t_near, near_t);
+        return static_cast<uint>(_mm256_movemask_ps(_mm256_cmp_ps(near_t, far_t, _CMP_LE_OQ)));
+    }
+};
+
+#endif // !WIDE_BVH_H
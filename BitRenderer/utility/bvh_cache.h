@@ -0,0 +1,20 @@
+/*
+ * BVH磁盘缓存
+ * 以网格内容哈希和构建参数为键，将构建结果（节点数组和图元索引）写入带版本号的二进制文件，
+ * 再次构建相同网格时直接读入节点和索引数组，不再重新构建；读入的树结构不合法时视为未命中
+ * 缓存目录只保留最新写入的若干个文件
+ */
+#ifndef BVH_CACHE_H
+#define BVH_CACHE_H
+
+#include "common.h"
+
+struct BVHBuildNode;
+
+// 读取键为key的缓存，图元数、格式不符或树结构不合法时返回false
+bool load_bvh_cache(ullong key, size_t primitive_count, std::vector<BVHBuildNode>& nodes, std::vector<uint>& indices);
+
+// 写入键为key的缓存，先写临时文件再改名，避免留下不完整的缓存；随后删除超出数量上限的旧缓存
+void save_bvh_cache(ullong key, size_t primitive_count, const std::vector<BVHBuildNode>& nodes, const std::vector<uint>& indices);
+
+#endif // !BVH_CACHE_H
@@ -1,128 +1,203 @@
-/*
- * 公共常量和函数
- */
-#ifndef COMMON_H
-#define COMMON_H
-
-#include <algorithm>
-#include <cassert>
-#include <chrono>
-#include <cmath>
-#include <deque>
-#include <filesystem>
-#include <iostream>
-#include <limits>
-#include <memory>
-#include <mutex>
-#include <new>
-#include <regex>
-#include <sstream>
-#include <string>
-#include <thread>
-#include <vector>
-
-using std::make_shared;
-using std::shared_ptr;
-using std::unique_ptr;
-using std::chrono::steady_clock;
-using std::chrono::system_clock;
-using std::chrono::duration_cast;
-using std::chrono::minutes;
-using std::chrono::seconds;
-using std::chrono::milliseconds;
-using std::chrono::microseconds;
-using std::chrono::nanoseconds;
-namespace fs = std::filesystem;
-
-using uint   = unsigned int;
-using ulong  = unsigned long;
-using ullong = unsigned long long;
-using llong  = long long;
-
-extern const double kInfinitDouble;
-extern const double kPI;
-extern const double kEpsilon;    // 比较浮点数的阈值
-extern const char*  kLoadPath;   // 加载文件的位置
-extern const char*  kOutputPath; // 保存输出的位置
-
-extern std::atomic_ullong hit_count;      // 击中次数统计
-extern std::atomic_ullong sample_count;   // 采样次数统计
-extern std::atomic_bool   tracing;        // 标志是否正在渲染
-extern std::atomic_bool   stop_rastering; // 标志是否需要停止光栅化，光追过程中和光追完成但没有Clear结果时需要停止光栅化
-
-// 返回dir目录下（含递归目录）所有文件名满足rule的文件的路径
-std::vector<fs::path> traverse_path(std::string dir, std::regex rule);
-
-enum RasteringModeFlags // 光栅化模式
-{
-    RasteringModeFlags_None = 0,
-    RasteringModeFlags_Coordinate_System = 1 << 0,
-    RasteringModeFlags_Wireframe = 1 << 1,
-    RasteringModeFlags_Depth = 1 << 2,
-    RasteringModeFlags_Shade = 1 << 3,
-};
-
-enum MaterialTypeFlags // 材质类型
-{
-    MaterialTypeFlags_None = 0,
-    MaterialTypeFlags_Lambert = 1 << 0,
-    MaterialTypeFlags_Microfacet = 1 << 2,
-};
-
-#define BASE_COLOR_DEFAULT make_shared<SolidColor>(Color3(0, 1, 0))
-#define METALLIC_DEFAULT   make_shared<SolidColor>(Color3(0, 0, 0))
-#define ROUGHNESS_DEFAULT  make_shared<SolidColor>(Color3(.2, .2, .2))
-#define NORMAL_DEFAULT     make_shared<SolidColor>(Color3(.5, .5, 1))
-
-#define CHOOSE_MATERIAL(material)                      \
-shared_ptr<Material> material;                         \
-if (material_type & MaterialTypeFlags_Lambert)         \
-{                                                      \
-    material = material_lambert;                       \
-}                                                      \
-else if (material_type & MaterialTypeFlags_Microfacet) \
-{                                                      \
-    if (use_single_metallic_value)                     \
-        material_microfacet->set_metallic(make_shared<SolidColor>(Color3(metallic_value, metallic_value, metallic_value))); \
-    if (use_single_roughness_value)                    \
-        material_microfacet->set_roughness(make_shared<SolidColor>(Color3(roughness_value, roughness_value, roughness_value))); \
-    material = material_microfacet;                    \
-}
-
-#define ARRAY3_ASSIGN(array3, x, y, z)                    \
-static_assert((sizeof(array3) / sizeof(array3[0])) == 3); \
-array3[0] = x, array3[1] = y, array3[2] = z
-
-double degrees_to_radians(double degrees);
-
-double random_double();
-double random_double(double min, double max);
-int    random_int(int min, int max);
-
-// 给输出数字加入千位分隔符
-std::string operator ""_sep(ullong num);
-std::string format_num(ullong num);
-
-// 避免minwindef.h中宏max和std::max的冲突
-#undef max
-#undef min
-
-inline double max3(double x, double y, double z)
-{
-    return std::max(x, std::max(y, z));
-}
-
-inline double min3(double x, double y, double z)
-{
-    return std::min(x, std::min(y, z));
-}
-
-#define STR(x) std::to_string(x)
-
-std::string operator ""_str(const char*, size_t);
-
-void add_info(std::string new_info);
-const char* get_info(ullong i);
-ullong get_info_size();
-
+/*
+ * 公共常量和函数
+ */
+#ifndef COMMON_H
+#define COMMON_H
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using std::make_shared;
+using std::shared_ptr;
+using std::unique_ptr;
+using std::chrono::steady_clock;
+using std::chrono::system_clock;
+using std::chrono::duration_cast;
+using std::chrono::minutes;
+using std::chrono::seconds;
+using std::chrono::milliseconds;
+using std::chrono::microseconds;
+using std::chrono::nanoseconds;
+namespace fs = std::filesystem;
+
+using schar  = signed char;
+using uchar  = unsigned char;
+using ushort = unsigned short;
+using uint   = unsigned int;
+using ulong  = unsigned long;
+using ullong = unsigned long long;
+using llong  = long long;
+
+// 几何与遍历核心（向量、光线、区间、包围盒、叶节点顶点、光线包）的标量类型
+// 默认单精度，节点、顶点的存储带宽减半，SIMD一次处理的分量加倍；定义BITRENDERER_DOUBLE_PRECISION时为双精度，作为对照构建
+#ifdef BITRENDERER_DOUBLE_PRECISION
+using real = double;
+#else
+using real = float;
+#endif
+
+// 参见 PBRT 3.9.1 Floating-Point Arithmetic
+// T类型n次运算累积相对误差的上界gamma(n)，默认为real
+template<typename T = real>
+constexpr T error_gamma(int n)
+{
+    constexpr T machine_epsilon = std::numeric_limits<T>::epsilon() * T(.5); // 单位舍入误差
+    return (n * machine_epsilon) / (1 - n * machine_epsilon);
+}
+
+extern const double kInfinitDouble;
+extern const double kPI;
+extern const double kEpsilon;    // 比较浮点数的阈值
+extern const char*  kLoadPath;   // 加载文件的位置
+extern const char*  kOutputPath; // 保存输出的位置
+extern const char*  kCachePath;  // BVH缓存的位置
+
+extern std::atomic_ullong hit_count;      // 击中次数统计
+extern std::atomic_ullong sample_count;   // 采样次数统计
+extern std::atomic_bool   tracing;        // 标志是否正在渲染
+extern std::atomic_bool   stop_rastering; // 标志是否需要停止光栅化，光追过程中和光追完成但没有Clear结果时需要停止光栅化
+
+// 当前线程的加速结构遍历统计，热力图模式对每条主光线清零后读取
+struct TraversalStats
+{
+    ullong box_tests = 0;       // 访问的BVH节点数
+    ullong primitive_tests = 0; // 叶节点中求交的图元数
+};
+
+extern std::atomic_ullong node_visit_count; // BVH节点访问次数统计
+extern thread_local TraversalStats traversal_stats;
+
+// 一次遍历结束时累计到当前线程的统计，不访问原子变量
+inline void record_traversal(ullong box_tests, ullong primitive_tests)
+{
+    traversal_stats.box_tests += box_tests;
+    traversal_stats.primitive_tests += primitive_tests;
+}
+
+// 当前线程的节点访问数并入全局统计后清零，渲染循环每个像素或分块调用一次
+inline void flush_traversal_stats()
+{
+    node_visit_count += traversal_stats.box_tests;
+    traversal_stats = TraversalStats();
+}
+
+// 返回dir目录下（含递归目录）所有文件名满足rule的文件的路径
+std::vector<fs::path> traverse_path(std::string dir, std::regex rule);
+
+enum RasteringModeFlags // 光栅化模式
+{
+    RasteringModeFlags_None = 0,
+    RasteringModeFlags_Coordinate_System = 1 << 0,
+    RasteringModeFlags_Wireframe = 1 << 1,
+    RasteringModeFlags_Depth = 1 << 2,
+    RasteringModeFlags_Shade = 1 << 3,
+};
+
+enum MaterialTypeFlags // 材质类型
+{
+    MaterialTypeFlags_None = 0,
+    MaterialTypeFlags_Lambert = 1 << 0,
+    MaterialTypeFlags_Microfacet = 1 << 2,
+};
+
+enum BVHBuildFlags // BVH构建方式
+{
+    BVHBuildFlags_None = 0,
+    BVHBuildFlags_Median = 1 << 0, // 质心范围最大轴中位数划分
+    BVHBuildFlags_SAH = 1 << 1,    // 分桶表面积启发式（Surface Area Heuristic）
+    BVHBuildFlags_LBVH = 1 << 2,   // Morton码排序线性构建（Linear BVH）
+};
+
+enum AcceleratorFlags // 光线追踪加速结构
+{
+    AcceleratorFlags_BVH = 1 << 0,
+    AcceleratorFlags_KdTree = 1 << 1, // SAH kd树
+    AcceleratorFlags_Grid = 1 << 2,   // 均匀网格，可选哈希稀疏存储
+};
+
+enum HeatmapModeFlags // 光线追踪遍历代价热力图
+{
+    HeatmapModeFlags_None = 0,
+    HeatmapModeFlags_Box = 1 << 0,       // 每条主光线的包围盒测试次数
+    HeatmapModeFlags_Primitive = 1 << 1, // 每条主光线的图元求交次数
+};
+
+#define BASE_COLOR_DEFAULT make_shared<SolidColor>(Color3(0, 1, 0))
+#define METALLIC_DEFAULT   make_shared<SolidColor>(Color3(0, 0, 0))
+#define ROUGHNESS_DEFAULT  make_shared<SolidColor>(Color3(.2, .2, .2))
+#define NORMAL_DEFAULT     make_shared<SolidColor>(Color3(.5, .5, 1))
+
+#define CHOOSE_MATERIAL(material)                      \
+shared_ptr<Material> material;                         \
+if (material_type & MaterialTypeFlags_Lambert)         \
+{                                                      \
+    material = material_lambert;                       \
+}                                                      \
+else if (material_type & MaterialTypeFlags_Microfacet) \
+{                                                      \
+    if (use_single_metallic_value)                     \
+        material_microfacet->set_metallic(make_shared<SolidColor>(Color3(metallic_value, metallic_value, metallic_value))); \
+    if (use_single_roughness_value)                    \
+        material_microfacet->set_roughness(make_shared<SolidColor>(Color3(roughness_value, roughness_value, roughness_value))); \
+    material = material_microfacet;                    \
+}
+
+#define ARRAY3_ASSIGN(array3, x, y, z)                    \
+static_assert((sizeof(array3) / sizeof(array3[0])) == 3); \
+array3[0] = x, array3[1] = y, array3[2] = z
+
+double degrees_to_radians(double degrees);
+
+double random_double();
+double random_double(double min, double max);
+int    random_int(int min, int max);
+
+// 给输出数字加入千位分隔符
+std::string operator ""_sep(ullong num);
+std::string format_num(ullong num);
+
+// FNV-1a 64位哈希，seed可传入前一段数据的哈希值以连续计算
+ullong hash_bytes(const void* data, size_t size, ullong seed = 14695981039346656037ull);
+
+// 避免minwindef.h中宏max和std::max的冲突
+#undef max
+#undef min
+
+inline double max3(double x, double y, double z)
+{
+    return std::max(x, std::max(y, z));
+}
+
+inline double min3(double x, double y, double z)
+{
+    return std::min(x, std::min(y, z));
+}
+
+#define STR(x) std::to_string(x)
+
+std::string operator ""_str(const char*, size_t);
+
+void add_info(std::string new_info);
+const char* get_info(ullong i);
+ullong get_info_size();
+
 #endif // !COMMON_H
\ No newline at end of file